@@ -27,6 +27,13 @@ class Client final : public QObject {
   Client &operator=(const Client &) = delete;
   ~Client() final;
 
+  // While launches are held, a new client starts its server only when they
+  // are released, so building and painting the window never waits for a
+  // process. Otherwise the server starts once the event loop runs. Requests
+  // made before the server runs are sent when it is up.
+  static void HoldLaunches();
+  static void ReleaseLaunches();
+
   // request messages to send to server specified by lsp protocol
 
   RequestType Initialize(DocumentUri root = {});
@@ -41,6 +48,19 @@ class Client final : public QObject {
                          CodeActionContext context);
   RequestType Completion(DocumentUri uri, Position position,
                          CompletionContext context = {});
+  // item must be passed exactly as received from the server, clangd keeps
+  // its own bookkeeping in the "data" field
+  RequestType CompletionResolve(json item);
+  RequestType WorkspaceSymbol(std::string query);
+  RequestType Hover(DocumentUri uri, Position position);
+  RequestType SignatureHelp(DocumentUri uri, Position position);
+  RequestType Definition(DocumentUri uri, Position position);
+  // Results may come in $/progress notifications for the token before the
+  // response brings the rest
+  RequestType References(DocumentUri uri, Position position,
+                         const std::string &partial_result_token);
+  // Asks the server to drop a request, it answers it with an error then
+  void Cancel(const RequestType &id);
 
   // common(more highly abstract than general notificator) notification messages
   // specified by LSP-protocol
@@ -48,6 +68,7 @@ class Client final : public QObject {
   void Initialized();
   void DidOpen(DocumentUri uri, std::string code);
   void DidClose(DocumentUri uri);
+  void DidSave(DocumentUri uri);
   void DidChange(DocumentUri uri,
                  std::vector<TextDocumentContentChangeEvent> changes,
                  bool wantDiagnostics = true);
@@ -67,6 +88,8 @@ class Client final : public QObject {
   void NewStderr(const std::string &content);
 
  private slots:
+  void Start();
+  void OnClientStarted();
   void OnClientReadyReadStdout();
   void OnClientReadyReadStderr();
   void OnClientError(QProcess::ProcessError error);
@@ -75,8 +98,13 @@ class Client final : public QObject {
  private:
   std::unique_ptr<QProcess> process_;
   std::vector<std::string> send_to_server_buffer_;
+  std::string read_buffer_;
   bool is_initialized_ = false;
+  // for the startup trace
+  qint64 launched_at_ = 0;
+  qint64 started_at_ = 0;
 
+  void ProcessMessage(const std::string &payload);
   void WriteToServer(const std::string &);
   void NotifyImpl(std::string, json params);
   void RequestImpl(std::string method, json params, RequestType type);
@@ -140,5 +140,13 @@ enum class FoldingRangeKind {
   Imports,
   Region,
 };
+// lower values are more severe
+enum class DiagnosticSeverity {
+  Missing = 0,
+  Error = 1,
+  Warning = 2,
+  Information = 3,
+  Hint = 4,
+};
 }  // namespace lsp
 #endif  // BATON_ENUMS_H
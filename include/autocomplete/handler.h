@@ -5,6 +5,7 @@
 #include <QProcess>
 #include <QTimer>
 #include <iostream>  // debug
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -23,34 +24,106 @@ class LSPHandler final : public QObject {
   LSPHandler &operator=(LSPHandler &&) = delete;
   LSPHandler &operator=(LSPHandler &) = delete;
 
+  // file_name is an absolute path
   LSPHandler(const std::string &root, const std::string &file_name,
              const std::string &content);
 
   ~LSPHandler() final;
 
  signals:
-  void DoneCompletion(const std::vector<std::string> &);
+  void DoneCompletion(const std::vector<lsp::CompletionItem> &);
+  void DoneCompletionResolve(std::size_t, const lsp::CompletionItem &);
   void DoneDiagnostic(const std::vector<lsp::DiagnosticsResponse> &);
+  void DoneWorkspaceSymbol(const std::string &query,
+                           const std::vector<lsp::SymbolInformation> &);
+  // completionProvider.triggerCharacters of the server
+  void DoneTriggerCharacters(const std::vector<std::string> &);
+  // text is empty when there is nothing to show at the position
+  void DoneHover(std::size_t line, std::size_t col, const std::string &text);
+  void DoneSignatureHelp(std::size_t line, std::size_t col,
+                         const lsp::SignatureHelp &);
+  void DoneDefinition(const std::vector<lsp::Location> &);
+  // References come in batches, the last one has finished set
+  void DoneReferences(const std::vector<lsp::Location> &, bool finished);
 
  public slots:
   // from LSP client, connected inside
   void GetNotify(const std::string &s, json);
   void GetResponse(json, json);
   void GetRequest(const std::string &, json, json) {}
-  void GetError(json, json) {}
+  void GetError(json, json);
   void GetServerError(QProcess::ProcessError) {}
   void GetServerFinished(int, QProcess::ExitStatus) {}
   void GetStderrOutput(const std::string &) {}
 
   // from user
-  void RequestCompletion(std::size_t, std::size_t);
+  // trigger is the character sequence typed before the position, empty when
+  // completion was invoked by the user or by typing an identifier
+  void RequestCompletion(std::size_t line, std::size_t col,
+                         const std::string &trigger);
+  // The last list was cut short, typing more of the identifier has to ask
+  // again instead of filtering it
+  bool CompletionIncomplete() const;
+  // index is a position in the last list emitted by DoneCompletion
+  void ResolveCompletion(std::size_t index);
   void FileChanged(const std::string &new_content);
+  // range is in the text as it was before the change
+  void ContentChanged(const Range &range, const std::string &text);
+  // the file on disk now has the content last passed to FileChanged
+  void FileSaved();
+  // The document is closed under its old name and opened again under
+  // file_name, an absolute path, with the whole content
+  void FileRenamed(const std::string &file_name, const std::string &content);
+  void RequestWorkspaceSymbol(const std::string &query);
+  // Only one hover and one signature help are in flight. Asking for another
+  // position cancels the one in flight and of the positions asked for
+  // meanwhile only the last one is sent.
+  void RequestHover(std::size_t line, std::size_t col);
+  void CancelHover();
+  void RequestSignatureHelp(std::size_t line, std::size_t col);
+  void CancelSignatureHelp();
+  void RequestDefinition(std::size_t line, std::size_t col);
+  // A new search drops the batches still coming for the previous one. It is
+  // sent once the previous search answered, both share the request id.
+  void RequestReferences(std::size_t line, std::size_t col);
 
  private:
+  struct PositionRequest {
+    std::string (Client::*send)(DocumentUri, Position);
+    std::string id;
+    std::optional<Position> in_flight;
+    std::optional<Position> pending;
+    // the answer to the request in flight is dropped
+    bool cancelled = false;
+  };
+
   std::string root_;
   std::string file_;
+  std::string uri_;
   Client client_;
+  // raw items of the last completion list, needed as is by resolve
+  std::vector<json> completion_items_;
+  bool completion_incomplete_ = false;
+  std::optional<std::size_t> resolving_;
+  std::optional<std::size_t> pending_resolve_;
+  std::optional<std::string> symbol_query_;
+  std::optional<std::string> pending_symbol_query_;
+  // token of the references search whose results are shown
+  std::string references_token_;
+  int references_searches_ = 0;
+  bool references_in_flight_ = false;
+  std::optional<Position> pending_references_;
+  PositionRequest hover_{&Client::Hover, "textDocument/hover"};
+  PositionRequest signature_help_{&Client::SignatureHelp,
+                                  "textDocument/signatureHelp"};
   void set_connections();
+  void ProcessCompletion(json result);
+  void ResolveFinished();
+  void WorkspaceSymbolFinished();
+  void SendPositionRequest(PositionRequest *request, Position position);
+  void CancelPositionRequest(PositionRequest *request);
+  void PositionRequestFinished(PositionRequest *request);
+  void ReferencesFinished(const std::vector<Location> &batch);
 };
 }  // namespace lsp
 #endif
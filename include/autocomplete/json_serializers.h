@@ -113,6 +113,9 @@ void from_json(const json &, DidOpenTextDocumentParams &);
 void to_json(json &j, const DidCloseTextDocumentParams &value);
 void from_json(const json &, DidCloseTextDocumentParams &);
 
+void to_json(json &j, const DidSaveTextDocumentParams &value);
+void from_json(const json &, DidSaveTextDocumentParams &);
+
 void to_json(json &j, const TextDocumentContentChangeEvent &value);
 void from_json(const json &, TextDocumentContentChangeEvent &);
 
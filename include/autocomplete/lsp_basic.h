@@ -124,7 +124,8 @@ struct ClientCapabilities {
   std::vector<CompletionItemKind> CompletionItemKinds;
 
   bool CodeActionStructure = true;
-  std::vector<OffsetEncoding> offsetEncoding = {OffsetEncoding::UTF8};
+  // columns are counted in UTF-16 units, as QTextDocument does
+  std::vector<OffsetEncoding> offsetEncoding = {OffsetEncoding::UTF16};
   std::vector<MarkupKind> HoverContentFormat = {MarkupKind::PlainText};
 
   bool ApplyEdit = false;
@@ -173,8 +174,12 @@ struct DidOpenTextDocumentParams {
 struct DidCloseTextDocumentParams {
   TextDocumentIdentifier textDocument;
 };
+struct DidSaveTextDocumentParams {
+  TextDocumentIdentifier textDocument;
+};
 struct TextDocumentContentChangeEvent {
-  //  std::optional<Range> range = Range{};
+  // without a range the text replaces the whole document
+  std::optional<Range> range;
 
   //  std::optional<uinteger> rangeLength;
   std::string text;
@@ -354,9 +359,10 @@ struct CompletionList {
   std::vector<CompletionItem> items;
 };
 struct ParameterInformation {
+  // the label is either given as a string or, with labelOffsetSupport, as
+  // the UTF-16 offsets of the parameter in the label of its signature
   std::string labelString;
-  std::optional<std::pair<unsigned, unsigned>> labelOffsets =
-      std::pair<unsigned, unsigned>{};  // clangd specific
+  std::optional<std::pair<unsigned, unsigned>> labelOffsets;
   std::string documentation;
 };
 struct SignatureInformation {
@@ -403,6 +409,7 @@ struct DiagnosticsResponse {
   std::string category;
   std::string message;
   Range range;
+  DiagnosticSeverity severity = DiagnosticSeverity::Missing;
 };
 
 }  // namespace lsp
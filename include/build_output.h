@@ -0,0 +1,48 @@
+#ifndef BUILD_OUTPUT_H
+#define BUILD_OUTPUT_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <vector>
+
+// Recognizes the messages of compilers in the output of a build
+namespace build_output {
+
+enum class Severity { Error, Warning, Note };
+
+struct Diagnostic {
+  QString file;  // absolute
+  int line = 0;  // zero-based
+  int column = 0;  // zero-based
+  Severity severity = Severity::Error;
+  QString message;
+};
+
+// Splits output into lines as it streams and picks out the messages written
+// as "file:line:column: error: text" by gcc, clang and most other tools.
+// Relative file names are resolved against the directory make reports
+// entering, or else the directory of the build.
+class Parser {
+ public:
+  explicit Parser(const QString &directory);
+
+  // Appends the complete lines of data to lines and the messages among them
+  // to diagnostics, an incomplete last line waits for the next data
+  void feed(const QByteArray &data, QStringList *lines,
+            std::vector<Diagnostic> *diagnostics);
+  // Takes the last line when the output did not end with a line break
+  void finish(QStringList *lines, std::vector<Diagnostic> *diagnostics);
+
+ private:
+  QString directory_;
+  QByteArray partial_;
+
+  void takeLine(const char *begin, const char *end, QStringList *lines,
+                std::vector<Diagnostic> *diagnostics);
+  bool parseLine(const QString &line, Diagnostic *diagnostic);
+};
+
+}  // namespace build_output
+
+#endif  // BUILD_OUTPUT_H
@@ -0,0 +1,59 @@
+#ifndef BUILD_PANEL_H
+#define BUILD_PANEL_H
+
+#include <QHash>
+#include <QLabel>
+#include <QListWidget>
+#include <QPlainTextEdit>
+#include <QString>
+#include <QWidget>
+#include <vector>
+
+#include "build_output.h"
+#include "build_runner.h"
+
+// Panel showing the output of a build next to the errors and warnings found
+// in it, which are listed while the build is running. The log keeps the
+// last MAX_LOG_LINES lines.
+class BuildPanel : public QWidget {
+  Q_OBJECT
+
+ public:
+  explicit BuildPanel(QWidget *parent = nullptr);
+
+  void build(const QString &command, const QString &directory);
+  void stop();
+  bool isRunning() const;
+  // Files the last build has messages about
+  QStringList files() const;
+  // Messages of the last build about the file
+  std::vector<build_output::Diagnostic> diagnosticsOf(
+      const QString &fileName) const;
+  // Moves the selection in the list of problems by step, wrapping around,
+  // and goes to the problem
+  void goToProblem(int step);
+
+ signals:
+  // line and column are zero-based
+  void locationChosen(const QString &path, int line, int column);
+  void diagnosticsChanged();
+
+ private slots:
+  void addOutput(const QStringList &lines,
+                 const std::vector<build_output::Diagnostic> &diagnostics);
+  void buildFinished(int exitCode, bool crashed);
+  void choose(QListWidgetItem *item);
+
+ private:
+  BuildRunner *runner_;
+  QPlainTextEdit *log_;
+  QListWidget *problems_;
+  QLabel *status_;
+  QHash<QString, std::vector<build_output::Diagnostic>> by_file_;
+  int errors_ = 0;
+  int warnings_ = 0;
+
+  void showStatus(const QString &state);
+};
+
+#endif  // BUILD_PANEL_H
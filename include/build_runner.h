@@ -0,0 +1,50 @@
+#ifndef BUILD_RUNNER_H
+#define BUILD_RUNNER_H
+
+#include <QObject>
+#include <QProcess>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+#include <memory>
+#include <vector>
+
+#include "build_output.h"
+
+// Runs a build command in the background. Its output is parsed while it
+// streams, in batches of at most one per FLUSH_MS and a few milliseconds of
+// work each, so a build writing megabytes never stalls the window.
+class BuildRunner : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit BuildRunner(QObject *parent = nullptr);
+  ~BuildRunner();
+
+  // Runs command with sh in directory, a running build is stopped first
+  void start(const QString &command, const QString &directory);
+  // Kills the command together with every process it started
+  void stop();
+  bool isRunning() const;
+
+ signals:
+  void output(const QStringList &lines,
+              const std::vector<build_output::Diagnostic> &diagnostics);
+  // After the last output of the build
+  void finished(int exitCode, bool crashed);
+
+ private slots:
+  void flush();
+  void processFinished(int exitCode, QProcess::ExitStatus status);
+
+ private:
+  QProcess *process_ = nullptr;
+  std::unique_ptr<build_output::Parser> parser_;
+  QTimer flush_timer_;
+  // the output left after the exit is still flushed in batches
+  bool exited_ = false;
+  int exit_code_ = 0;
+  bool crashed_ = false;
+};
+
+#endif  // BUILD_RUNNER_H
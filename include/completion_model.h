@@ -0,0 +1,44 @@
+#ifndef COMPLETION_MODEL_H
+#define COMPLETION_MODEL_H
+
+#include <QAbstractListModel>
+#include <QString>
+#include <QVariant>
+#include <vector>
+
+#include "lsp_basic.h"
+
+// Model behind the completion popup. Rows keep the whole CompletionItem,
+// documentation is filled later by completionItem/resolve for the rows the
+// user actually looks at.
+class CompletionModel : public QAbstractListModel {
+  Q_OBJECT
+
+ public:
+  enum Roles {
+    KindRole = Qt::UserRole + 1,
+    DetailRole,
+    DocumentationRole,
+    ResolvedRole
+  };
+
+  explicit CompletionModel(QObject *parent = nullptr);
+
+  int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex &index,
+                int role = Qt::DisplayRole) const override;
+
+  void setItems(std::vector<lsp::CompletionItem> items);
+  void setResolved(std::size_t row, const lsp::CompletionItem &item);
+  bool isResolved(std::size_t row) const;
+
+ private:
+  struct Row {
+    lsp::CompletionItem item;
+    QString display;
+    bool resolved = false;
+  };
+  std::vector<Row> rows_;
+};
+
+#endif  // COMPLETION_MODEL_H
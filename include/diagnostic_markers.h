@@ -0,0 +1,51 @@
+#ifndef DIAGNOSTIC_MARKERS_H
+#define DIAGNOSTIC_MARKERS_H
+
+#include <QObject>
+#include <QPointer>
+#include <QTextDocument>
+#include <vector>
+
+#include "lsp_basic.h"
+
+// Ranges of a document the server published diagnostics for, underlined by
+// the editors showing it.
+//
+// The ranges are kept as positions in the document sorted by their start.
+// Edits shift the ranges after them, so the marks stay on their text until
+// the server publishes again. Painting asks only for the ranges of the
+// visible blocks, found by a binary search bounded by the longest range.
+class DiagnosticMarkers : public QObject {
+  Q_OBJECT
+
+ public:
+  struct Marker {
+    int start;
+    int end;
+    lsp::DiagnosticSeverity severity;
+  };
+
+  explicit DiagnosticMarkers(QTextDocument *document,
+                             QObject *parent = nullptr);
+
+  QTextDocument *document() const;
+  void setDiagnostics(const std::vector<lsp::DiagnosticsResponse> &diagnostics);
+  // Markers overlapping the positions from up to to, ordered by start
+  void markersIn(int from, int to, std::vector<Marker> *markers) const;
+
+ signals:
+  void markersChanged();
+
+ private slots:
+  void contentsChange(int position, int removed, int added);
+
+ private:
+  QPointer<QTextDocument> document_;
+  std::vector<Marker> markers_;
+  // no marker is longer, ranges starting further before a position cannot
+  // reach it
+  int longest_ = 0;
+  int revision_;
+};
+
+#endif  // DIAGNOSTIC_MARKERS_H
@@ -0,0 +1,81 @@
+#ifndef DIAGNOSTICS_MODEL_H
+#define DIAGNOSTICS_MODEL_H
+
+#include <QAbstractItemModel>
+#include <QIcon>
+#include <QString>
+#include <QVariant>
+#include <vector>
+
+#include "lsp_basic.h"
+
+// Model behind the problems panel: the diagnostics of every open file,
+// grouped under a row per file.
+//
+// The server publishes the whole list of a file after every edit, while
+// usually only a few entries changed. The new list is compared with the
+// shown one by message, ignoring the positions an edit moves. Only the rows
+// between the unchanged head and tail are replaced, the moved ones are
+// updated in place, so views keep their selection and scroll position and
+// long lists cost little to refresh.
+class DiagnosticsModel : public QAbstractItemModel {
+  Q_OBJECT
+
+ public:
+  enum Roles { PathRole = Qt::UserRole + 1, LineRole, ColumnRole, KeyRole };
+
+  explicit DiagnosticsModel(QObject *parent = nullptr);
+
+  QModelIndex index(int row, int column,
+                    const QModelIndex &parent = QModelIndex()) const override;
+  QModelIndex parent(const QModelIndex &index) const override;
+  int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+  int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex &index,
+                int role = Qt::DisplayRole) const override;
+
+  // The list of the file known by key, which stays the same when the file is
+  // renamed and tells apart untitled files. An empty list removes the file.
+  // The source names where a list comes from other than the server, such as
+  // a build, and is shown with the file.
+  void setDiagnostics(const QString &key, const QString &path,
+                      const std::vector<lsp::DiagnosticsResponse> &diagnostics,
+                      const QString &source = QString());
+  void removeFile(const QString &key);
+
+ private:
+  struct Entry {
+    int line;
+    int column;
+    lsp::DiagnosticSeverity severity;
+    QString message;
+    QString category;
+
+    bool operator==(const Entry &other) const;
+    // the same diagnostic, possibly moved by an edit
+    bool sameAs(const Entry &other) const;
+  };
+  struct File {
+    // internal id of the rows of the entries, stays the same while rows of
+    // other files come and go
+    quintptr id;
+    QString key;
+    QString path;
+    QString source;
+    std::vector<Entry> entries;
+    int errors = 0;
+    int warnings = 0;
+  };
+
+  std::vector<File> files_;
+  quintptr next_id_ = 1;
+  QIcon error_icon_;
+  QIcon warning_icon_;
+  QIcon information_icon_;
+
+  int rowOf(const QString &key) const;
+  int rowOf(quintptr id) const;
+  void count(File *file);
+};
+
+#endif  // DIAGNOSTICS_MODEL_H
@@ -1,6 +1,5 @@
 #ifndef DIRECTORY_TREE_H
 #define DIRECTORY_TREE_H
-#include <QFileSystemModel>
 #include <QString>
 #include <QWidget>
 #include <QtCore/QVariant>
@@ -10,6 +9,8 @@
 #include <QtWidgets/QTreeView>
 #include <QtWidgets/QWidget>
 #include <string>
+
+#include "lazy_dir_model.h"
 QT_BEGIN_NAMESPACE
 
 class Ui_Directory_tree {
@@ -54,8 +55,10 @@ class Directory_tree : public QWidget {
   QTreeView tree;
   explicit Directory_tree(QWidget *parent = nullptr);
   void set_root_path();
+  // Root chosen in .batonrc or with set_root_path, empty when there is none
+  QString root_path() const;
   virtual ~Directory_tree();
-  QFileSystemModel model;
+  LazyDirModel model;
   Ui::Directory_tree *ui;
   QString dir_name;
 
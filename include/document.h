@@ -0,0 +1,93 @@
+#ifndef DOCUMENT_H
+#define DOCUMENT_H
+
+#include <QObject>
+#include <QString>
+#include <QTextDocument>
+#include <vector>
+
+#include "diagnostic_markers.h"
+#include "edit_journal.h"
+#include "file_view.h"
+#include "syntax_highlighter.h"
+#include "text_diff.h"
+#include "text_format.h"
+
+// One open file: the text, its highlighting and the language server session.
+// Every editor pane showing the file shares this object, the panes only own
+// their cursor, selection and scroll position.
+class Document : public QObject {
+  Q_OBJECT
+
+ public:
+  // An empty file name makes an untitled document
+  explicit Document(const QString &fileName, QObject *parent = nullptr);
+  ~Document();
+
+  QTextDocument *textDocument() const;
+  FileView *fileView() const;
+
+  const QString &fileName() const;
+  void setFileName(const QString &fileName);
+  // Grows with every change of the text, tells whether a saved snapshot is
+  // still what the document holds
+  quint64 revision() const;
+
+  // Called once the file text is loaded: the server gets the whole text,
+  // every following edit is sent to it as a change and journaled
+  void textLoaded();
+  // A snapshot of the given revision and length was written to disk, digest
+  // is its text_diff::Digest
+  void saved(quint64 revision, int length, const QByteArray &digest);
+
+  // Encoding and line endings the file is saved with
+  const text_format::Format &format() const;
+  void setFormat(const text_format::Format &format);
+
+  // Digest of the file text the document was last loaded from or saved to
+  const QByteArray &diskDigest() const;
+  void setDiskDigest(const QByteArray &digest);
+  // Brings the document to the text the file now holds. Only the changed
+  // parts are replaced, in one undoable step, so cursors and highlighting
+  // of the rest survive.
+  void applyDiskChange(const std::vector<text_diff::Edit> &edits,
+                       const QByteArray &digest);
+  // Replays the edits of a crashed session, false when the text they were
+  // made on is not what the document holds
+  bool recover(const EditJournal::Recovery &recovery);
+
+  // Last diagnostics published by the server, shown again when the document
+  // comes back to the front
+  const std::vector<lsp::DiagnosticsResponse> &diagnostics() const;
+  // The same diagnostics as ranges of the text, following its edits
+  DiagnosticMarkers *markers() const;
+  // Lines the last build complained about, following the edits made since
+  DiagnosticMarkers *buildMarkers() const;
+
+ private slots:
+  void contentsChanged();
+  void recordChange(int position, int removed, int added);
+  void diagnosticsChanged(const std::vector<lsp::DiagnosticsResponse> &);
+
+ private:
+  QTextDocument *text_;
+  Highlighter *highlighter_;
+  DiagnosticMarkers *markers_;
+  DiagnosticMarkers *build_markers_;
+  FileView *file_view_;
+  QString file_name_;
+  quint64 revision_ = 0;
+  text_format::Format format_;
+  QByteArray disk_digest_;
+  EditJournal journal_;
+  bool loaded_ = false;
+  // set while a change from disk is applied, its parts are sent to the
+  // server one by one
+  bool applying_disk_change_ = false;
+  int text_revision_ = 0;
+  std::vector<lsp::DiagnosticsResponse> diagnostics_;
+
+  void uploadChange(int position, int removed, const QString &added);
+};
+
+#endif  // DOCUMENT_H
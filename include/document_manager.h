@@ -0,0 +1,120 @@
+#ifndef DOCUMENT_MANAGER_H
+#define DOCUMENT_MANAGER_H
+
+#include <QByteArray>
+#include <QFileSystemWatcher>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+#include <QTimer>
+#include <vector>
+
+#include "document.h"
+#include "text_diff.h"
+#include "text_format.h"
+
+// Documents of the open tabs.
+//
+// A tab is dormant until it is activated: it holds the file name, the UTF-8
+// text and the cursor state, nothing else. Activation materializes the
+// Document with its highlighter and clangd session. Only a few documents are
+// kept alive, when there are more the least recently used unmodified ones
+// are turned back into dormant tabs.
+//
+// The files of the tabs are watched. A dormant tab simply forgets its text,
+// a live document is compared with the new file text on a worker thread and
+// only the differing lines are replaced. A modified document is left alone
+// and reported by changedOnDisk.
+class DocumentManager : public QObject {
+  Q_OBJECT
+
+ public:
+  // Cursor and scroll position of a tab, kept while the tab is dormant
+  struct ViewState {
+    int position = 0;
+    int anchor = 0;
+    int scroll = 0;
+  };
+
+  explicit DocumentManager(QObject *parent = nullptr);
+  ~DocumentManager();
+
+  int count() const;
+  // Index of the tab of the file or -1
+  int indexOf(const QString &fileName) const;
+  int indexOf(const Document *document) const;
+  // Adds a dormant tab, the file is read on the first activation. An empty
+  // name adds an untitled tab.
+  int add(const QString &fileName);
+  void remove(int index);
+
+  QString fileName(int index) const;
+  void setFileName(int index, const QString &fileName);
+  bool isModified(int index) const;
+  // nullptr while the tab is dormant
+  Document *document(int index) const;
+
+  const ViewState &viewState(int index) const;
+  void setViewState(int index, const ViewState &state);
+
+  // Brings the tab to life and marks it as the most recently used one. Returns
+  // nullptr and fills error when the file cannot be read.
+  Document *materialize(int index, QString *error);
+  // Turns the least recently used documents back into dormant tabs when too
+  // many are alive. Called once the activated document is on screen.
+  void releaseUnused();
+
+  // Replaces the text of a live document with the file text even when the
+  // document is modified, the replacement can be undone
+  void reload(int index);
+
+ signals:
+  void materialized(Document *document);
+  // The file of a modified document was changed by another program
+  void changedOnDisk(int index);
+
+ private slots:
+  void fileChanged(const QString &path);
+  void directoryChanged(const QString &path);
+  void checkChanged();
+
+ private:
+  struct Tab {
+    QString file_name;
+    // text of a dormant tab, only unmodified documents are released so the
+    // undo history is never lost
+    QByteArray buffer;
+    bool loaded = false;
+    ViewState view;
+    // digest of the file text held by the buffer
+    QByteArray digest;
+    text_format::Format format;
+    Document *document = nullptr;
+    quint64 last_used = 0;
+    // the reload in flight, 0 when there is none
+    int reload_job = 0;
+    // the file changed again while it was being read
+    bool reload_again = false;
+  };
+
+  std::vector<Tab> tabs_;
+  quint64 clock_ = 0;
+  QFileSystemWatcher watcher_;
+  // a checkout touches many files at once, they are looked at together
+  QTimer change_timer_;
+  QSet<QString> changed_;
+  QThreadPool pool_;
+  int next_job_ = 0;
+
+  void release(Tab *tab);
+  void watch(const QString &fileName);
+  void unwatch(const QString &fileName);
+  void startReload(int index, bool force);
+  void finishReload(int job, bool force, quint64 revision, bool read,
+                    const text_format::Format &format,
+                    const QByteArray &digest,
+                    const std::vector<text_diff::Edit> &edits);
+};
+
+#endif  // DOCUMENT_MANAGER_H
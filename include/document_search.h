@@ -0,0 +1,71 @@
+#ifndef DOCUMENT_SEARCH_H
+#define DOCUMENT_SEARCH_H
+
+#include <QObject>
+#include <QPointer>
+#include <QRegularExpression>
+#include <QString>
+#include <QTextDocument>
+#include <QTimer>
+#include <vector>
+
+// All matches of a query in one document. The text is taken as a single
+// snapshot after every edit and searched as a whole, the matches are kept
+// sorted by position.
+class DocumentSearch : public QObject {
+  Q_OBJECT
+
+ public:
+  struct Match {
+    int position;
+    int length;
+  };
+
+  explicit DocumentSearch(QObject *parent = nullptr);
+
+  void setDocument(QTextDocument *document);
+  QTextDocument *document() const;
+
+  // Returns false and fills error when the regular expression is invalid
+  bool setQuery(const QString &query, bool regex, bool case_sensitive,
+                QString *error = nullptr);
+  void clear();
+
+  // Possibly a few milliseconds behind the last edit, good for painting
+  const std::vector<Match> &matches() const;
+  // Index of the first match starting at or after position, wraps around.
+  // -1 when there are no matches.
+  int nextMatch(int position);
+  // Index of the last match starting before position, wraps around
+  int previousMatch(int position);
+  int matchAt(int position, int length);
+
+  // Text replacing the match, \1 to \9 refer to the captured groups of a
+  // regular expression
+  QString replacementFor(int index, const QString &replacement);
+  // All matches are replaced in one edit block, so they are undone at once
+  // and the document reports a single change
+  int replaceAll(const QString &replacement);
+
+ signals:
+  void matchesChanged();
+
+ private slots:
+  void documentChanged();
+
+ private:
+  QPointer<QTextDocument> document_;
+  QString query_;
+  bool regex_mode_ = false;
+  bool case_sensitive_ = false;
+  QRegularExpression regex_;
+  QString snapshot_;
+  std::vector<Match> matches_;
+  QTimer refresh_timer_;
+
+  void refresh();
+  // Matches are recomputed lazily after edits, this brings them up to date
+  void ensureFresh();
+};
+
+#endif  // DOCUMENT_SEARCH_H
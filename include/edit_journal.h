@@ -0,0 +1,72 @@
+#ifndef EDIT_JOURNAL_H
+#define EDIT_JOURNAL_H
+
+#include <QFile>
+#include <QLockFile>
+#include <QString>
+#include <QStringList>
+#include <memory>
+#include <vector>
+
+// Append-only record of the edits made to a document since it was loaded or
+// last saved, kept so that a crash does not lose unsaved work.
+//
+// The journal is a memory mapped file in the application data directory.
+// Every edit appends one record holding the replaced range and the new text,
+// so its cost depends on the size of the edit only. Records carry a checksum
+// and replay stops at the first damaged one. A lock file marks the journal
+// as owned by a running session, journals whose lock is stale are left
+// behind by a crash and are offered for recovery on the next start. When
+// the records outgrow the text, the journal is compacted into a single
+// record holding the whole text.
+class EditJournal {
+ public:
+  struct Edit {
+    int position;
+    int removed;
+    QString added;
+  };
+  struct Recovery {
+    // empty for an untitled document
+    QString file_name;
+    // length of the file text the edits apply to
+    int base_length = 0;
+    std::vector<Edit> edits;
+  };
+
+  EditJournal() = default;
+  EditJournal(const EditJournal &) = delete;
+  EditJournal &operator=(const EditJournal &) = delete;
+  // A journal closed normally is removed
+  ~EditJournal();
+
+  // Starts over for a file whose text on disk has base_length characters.
+  // The journal file is created with the first edit.
+  void reset(const QString &fileName, int base_length);
+  void append(int position, int removed, const QString &added);
+  // True when the records take much more room than the text they describe
+  bool needsCompaction(int length) const;
+  void compact(const QString &text);
+
+  // Journals of sessions that did not exit cleanly
+  static QStringList abandoned();
+  static bool read(const QString &path, Recovery *recovery);
+  static void discard(const QString &path);
+
+ private:
+  QString file_name_;
+  int base_length_ = 0;
+  QFile file_;
+  std::unique_ptr<QLockFile> lock_;
+  uchar *data_ = nullptr;
+  qint64 capacity_ = 0;
+  qint64 end_ = 0;
+  qint64 records_begin_ = 0;
+
+  bool open();
+  bool reserve(qint64 size);
+  // Closes the journal, the file is removed unless keep is set
+  void close(bool keep);
+};
+
+#endif  // EDIT_JOURNAL_H
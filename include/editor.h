@@ -1,18 +1,27 @@
 #ifndef Editor_H
 #define Editor_H
 #include <QCompleter>
+#include <QColor>
 #include <QFontMetrics>
+#include <QHash>
+#include <QLabel>
 #include <QMap>
 #include <QPlainTextEdit>
 #include <QPointer>
+#include <QTimer>
 #include <QToolBar>
 #include <iostream>
 #include <string>
 
+#include "diagnostic_markers.h"
+#include "document_search.h"
+#include "lsp_basic.h"
 #include "syntax_highlighter.h"
 
 QT_BEGIN_NAMESPACE
 class QPaintEvent;
+class QPainter;
+class QTextBlock;
 class QResizeEvent;
 class QSize;
 class QWidget;
@@ -29,47 +38,139 @@ class Editor : public QPlainTextEdit {
  public:
   explicit Editor(std::size_t fontSize = DEFAULT_FONT_SIZE,
                   QWidget *parent = nullptr);
+  // Pane over a document shared with other editors, the document brings its
+  // own highlighter
+  explicit Editor(QTextDocument *document,
+                  std::size_t fontSize = DEFAULT_FONT_SIZE,
+                  QWidget *parent = nullptr);
 
   void lineNumberAreaPaintEvent(QPaintEvent *event);
   int lineNumberAreaWidth();
-  QString curFile;
   std::size_t curIndent;
   bool newLine;
   std::size_t fontSize;
   void setCompleter(QCompleter *c);
   QCompleter *completer() const;
+  // Matches of the search are highlighted, only the visible ones are looked
+  // up when painting
+  void setSearch(DocumentSearch *search);
+  // Diagnostics are underlined with a wavy line, painted over the text of
+  // the visible blocks only
+  void setMarkers(DiagnosticMarkers *markers);
+  // Colored marks in the gutter next to the lines the markers touch, errors
+  // win over warnings
+  void setLineMarkers(DiagnosticMarkers *markers);
+  // Characters the server completes after, as announced in its
+  // completionProvider. ':' and '>' only count as "::" and "->", '<', '"' and
+  // '/' only in #include lines.
+  void setTriggerCharacters(const QStringList &characters);
+  // Shows the completer, filtered by the identifier before the cursor, when
+  // completion still applies at the cursor
+  void showCompletions();
+  // Answers to hoverRequested and signatureHelpRequested, shown only while
+  // the mouse or the cursor are still where they were asked for
+  void showHover(int line, int col, const QString &text);
+  void showSignatureHelp(int line, int col, const lsp::SignatureHelp &help);
 
   virtual ~Editor() {}
 
  protected:
   void resizeEvent(QResizeEvent *event) override;
+  void paintEvent(QPaintEvent *event) override;
   void keyPressEvent(QKeyEvent *e) override;
   void focusInEvent(QFocusEvent *e) override;
+  void focusOutEvent(QFocusEvent *e) override;
+  void mouseMoveEvent(QMouseEvent *e) override;
+  void leaveEvent(QEvent *e) override;
 
  signals:
-  void changeCursor(int new_line, int new_col);
-  void changeContent(const std::string &new_cont);
+  // Asks for a completion list at the zero-based line and UTF-16 column,
+  // see FileView::RequestCompletion
+  void completionRequested(int line, int col, const QString &trigger,
+                           bool extending);
+  // Hover is asked for at the start of the word the mouse rests on, so
+  // hovering anywhere over the word is answered from the cache
+  void hoverRequested(int line, int col);
+  // The mouse left the word before the answer came
+  void hoverCancelled();
+  // Parameter hints, asked for after '(' and ','
+  void signatureHelpRequested(int line, int col);
+  void signatureHelpCancelled();
  private slots:
   void updateLineNumberAreaWidth(int newBlockCount);
-  void highlightCurrentLine(QList<QTextEdit::ExtraSelection> *extraSelection);
+  void updateCurrentLine();
+  void updateBracketMatch();
   void updateLineNumberArea(const QRect &rect, int dy);
   void insertCompletion(const QString &completion);
+  void requestHover();
+  void followSignatureHelp();
 
  private:
   Highlighter *highlighter;
   QWidget *lineNumberArea;
   QCompleter *c = nullptr;
+  QPointer<DocumentSearch> search_;
+  QPointer<DiagnosticMarkers> line_markers_;
+  QPointer<DiagnosticMarkers> markers_;
 
   QString textUnderCursor() const;
   int getIndentationSpaces() const;
 
   QString tab_replace_ = "    ";
   QChar charUnderCursor(int offset = 0) const;
-  QString wordUnderCursor() const;
   bool procCompleterStart(QKeyEvent *e);
   void procCompleterFinish(QKeyEvent *e);
-  void highlightParenthesis(QList<QTextEdit::ExtraSelection> *extraSelection);
-  void updateExtraSelection();
+  // Decides from the typed key and the text of the line alone whether a new
+  // list is needed, most keys only filter the one shown
+  void requestCompletion(QKeyEvent *e);
+  // The identifier characters before the cursor
+  QString identifierPrefix() const;
+  // Trigger sequence ending at the position of the cursor's block, empty
+  // when there is none
+  QString triggerBefore(int positionInBlock) const;
+  QStringList trigger_sequences_ = {".", "->", "::"};
+  // the user asked for completion with Ctrl+Space, short prefixes show the
+  // popup too
+  bool invoked_ = false;
+
+  // the mouse has to rest this long before hover is asked for
+  QTimer hover_timer_;
+  QPoint hover_point_;
+  // start of the word hover was asked for, -1 when none
+  int hover_position_ = -1;
+  QLabel *signature_label_;
+  // position signature help was asked for and start of its argument list,
+  // -1 when none
+  int signature_position_ = -1;
+  int signature_start_ = -1;
+  // Start of the identifier under the point of the viewport, -1 when the
+  // point is not over one
+  int wordStartAt(const QPoint &point) const;
+  void cancelHover();
+  void requestSignatureHelp(QKeyEvent *e);
+  void hideSignatureHelp();
+  // Position of the bracket at the cursor and of its match, -1 when there
+  // is none
+  int bracket_[2] = {-1, -1};
+  // where the current line was painted
+  QRect current_line_rect_;
+  // Position of the bracket matching the one at position, -1 when it is not
+  // found close enough
+  int matchingBracket(int position, QChar active, QChar counter,
+                      int direction) const;
+  // Rectangles covered by the characters from start up to end of the block,
+  // one per line of a wrapped block. Empty ranges get the width of a
+  // character.
+  QVector<QRectF> rangeRects(const QTextBlock &block, int start,
+                             int end) const;
+  template <typename Paint>
+  void forVisibleBlocks(const QRect &area, Paint paint) const;
+  // Decorations are painted in layers, each finding what is visible on its
+  // own instead of going through extra selections
+  void paintCurrentLine(QPainter *painter, const QRect &area);
+  void paintSearchMatches(QPainter *painter, const QRect &area);
+  void paintBracketMatch(QPainter *painter, const QRect &area);
+  void paintMarkers(QPainter *painter, const QRect &area);
 
   static constexpr int DEFAULT_FONT_SIZE = 11;
 };
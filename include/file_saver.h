@@ -0,0 +1,70 @@
+#ifndef FILE_SAVER_H
+#define FILE_SAVER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+
+#include "text_format.h"
+
+// Writes files on worker threads so saving never blocks typing.
+//
+// The caller hands over a snapshot of the text, encoding it into the format
+// of the file and writing happen off the GUI thread. A file is replaced
+// atomically: the text goes to a temporary file in the same directory, which
+// is optionally synced and then renamed over the original, keeping its
+// permissions. Different files are written in parallel. For one file only
+// one write is in flight, a newer snapshot waits for it and replaces any
+// older snapshot still waiting.
+class FileSaver : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit FileSaver(QObject *parent = nullptr);
+  ~FileSaver();
+
+  // Without sync a crash of the system may lose the last saves, but saving
+  // does not wait for the disk
+  void setSync(bool sync);
+
+  // Returns the ticket reported by saved
+  int save(const QString &fileName, const QString &text,
+           const text_format::Format &format = text_format::Format());
+  bool isBusy() const;
+  // Blocks until every write is done and its saved signal was emitted
+  void waitForDone();
+  // Blocks until the writes of the file, including the ones waiting, are
+  // done and their saved signals were emitted
+  void waitForFile(const QString &fileName);
+
+ signals:
+  // error is empty when the file was written, digest is the
+  // text_diff::Digest of the text
+  void saved(int ticket, const QString &fileName, const QString &error,
+             const QByteArray &digest);
+
+ private:
+  struct Job {
+    QString file_name;
+    QString text;
+    text_format::Format format;
+    QList<int> tickets;
+  };
+
+  QThreadPool pool_;
+  // snapshots waiting for the write in flight to the same file
+  QHash<QString, Job> queued_;
+  QSet<QString> writing_;
+  int next_ticket_ = 0;
+  bool sync_ = true;
+  unsigned create_mode_;
+
+  void start(Job job);
+  void finish(const Job &job, const QString &error, const QByteArray &digest);
+};
+
+#endif  // FILE_SAVER_H
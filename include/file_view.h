@@ -2,7 +2,9 @@
 #define FILE_VIEW_H
 
 #include <QWidget>
+#include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "editor.h"
@@ -17,23 +19,69 @@ class FileView : public QWidget {
   virtual ~FileView();
   void SetValidity(bool);
  signals:
-  void DoneCompletion(const std::vector<std::string>&);
+  void DoneCompletion(const std::vector<lsp::CompletionItem>&);
+  void DoneCompletionResolve(std::size_t, const lsp::CompletionItem&);
   void DoneDiagnostic(const std::vector<lsp::DiagnosticsResponse>&);
+  void DoneWorkspaceSymbol(const std::string& query,
+                           const std::vector<lsp::SymbolInformation>&);
+  void DoneTriggerCharacters(const std::vector<std::string>&);
+  void DoneHover(int line, int col, const std::string& text);
+  void DoneSignatureHelp(int line, int col, const lsp::SignatureHelp&);
+  void DoneDefinition(const std::vector<lsp::Location>&);
+  void DoneReferences(const std::vector<lsp::Location>&, bool finished);
  public slots:
   void UploadContent(const std::string& s);
-  void ChangeCursor(int new_line, int new_col);
+  // Sends the replacement of removed UTF-16 units from line and col on.
+  // Returns false when the position is past the text sent so far, the whole
+  // text has to be uploaded then.
+  bool UploadChange(int line, int col, int removed, const std::string& added);
+  void NotifySaved();
+  // The server is told the document has the new name and the whole content,
+  // the content is only kept for a valid C++ file
+  void Rename(const std::string& filename, const std::string& content,
+              bool valid);
+  // extending is set when the user typed more of an identifier a list was
+  // already asked for, which is only asked again when that list was
+  // incomplete
+  void RequestCompletion(int line, int col, const std::string& trigger,
+                         bool extending);
+  void ResolveCompletion(std::size_t index);
+  void RequestWorkspaceSymbol(const std::string& query);
+  // Answers for a position of the current text are kept, asking again is
+  // answered at once
+  void RequestHover(int line, int col);
+  void CancelHover();
+  void RequestSignatureHelp(int line, int col);
+  void CancelSignatureHelp();
+  void RequestDefinition(int line, int col);
+  void RequestReferences(int line, int col);
 
  private slots:
-  void GetCompletion(const std::vector<std::string>&);
+  void GetCompletion(const std::vector<lsp::CompletionItem>&);
+  void GetCompletionResolve(std::size_t, const lsp::CompletionItem&);
   void GetDiagnostic(const std::vector<lsp::DiagnosticsResponse>&);
+  void GetHover(std::size_t line, std::size_t col, const std::string& text);
+  void GetSignatureHelp(std::size_t line, std::size_t col,
+                        const lsp::SignatureHelp& help);
 
  private:
   lsp::LSPHandler handler_;
   std::string content_;
-  int carriage_line_;
-  int carriage_col_;
-  bool completion_required_;
+  // byte offset in content_ of the start of every line
+  std::vector<std::size_t> line_starts_;
   bool valid_cpp_;
+  // grows with every upload, answers asked for an older text are not kept
+  int version_ = 0;
+  int hover_version_ = 0;
+  int signature_help_version_ = 0;
+  std::map<std::pair<int, int>, std::string> hover_cache_;
+  std::map<std::pair<int, int>, lsp::SignatureHelp> signature_help_cache_;
+
+  void IndexLines();
+  void TextChanged();
+  // Byte offset of the UTF-16 column col of line, npos when the position is
+  // past the text or inside a line break
+  std::size_t Offset(int line, int col) const;
 };
 
 #endif  // FILE_VIEW_H
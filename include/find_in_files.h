@@ -0,0 +1,66 @@
+#ifndef FIND_IN_FILES_H
+#define FIND_IN_FILES_H
+
+#include <QCheckBox>
+#include <QLabel>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QString>
+#include <QThreadPool>
+#include <QTimer>
+#include <QWidget>
+#include <memory>
+#include <vector>
+
+struct SearchMatch {
+  QString path;
+  int line = 0;  // zero-based
+  QString preview;
+};
+
+struct SearchJob;
+
+// Panel searching all files under the root directory. Files are scanned by
+// a thread pool, matches are appended to the list in batches while the
+// search is running. Editing the query cancels the running search.
+class FindInFiles : public QWidget {
+  Q_OBJECT
+
+ public:
+  explicit FindInFiles(QWidget *parent = nullptr);
+  FindInFiles(const FindInFiles &) = delete;
+  FindInFiles &operator=(const FindInFiles &) = delete;
+  ~FindInFiles();
+
+  void setRoot(const QString &root);
+  // Focuses the query, the text under the editor's cursor is proposed
+  void activate(const QString &text = {});
+
+ signals:
+  void locationChosen(const QString &path, int line);
+
+ private slots:
+  void restart();
+  void choose(QListWidgetItem *item);
+
+ private:
+  QString root_;
+  QLineEdit *query_;
+  QCheckBox *regex_;
+  QCheckBox *case_sensitive_;
+  QLabel *status_;
+  QListWidget *results_;
+  QTimer restart_timer_;
+  QThreadPool pool_;
+  std::shared_ptr<SearchJob> job_;
+  int match_count_ = 0;
+
+  void cancel();
+  // Runs on the pool: takes files until none is left and reports matches
+  void runSearch(std::shared_ptr<SearchJob> job);
+  void addMatches(const std::shared_ptr<SearchJob> &job,
+                  const std::vector<SearchMatch> &matches);
+  void searchFinished(const std::shared_ptr<SearchJob> &job);
+};
+
+#endif  // FIND_IN_FILES_H
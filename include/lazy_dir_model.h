@@ -0,0 +1,106 @@
+#ifndef LAZY_DIR_MODEL_H
+#define LAZY_DIR_MODEL_H
+
+#include <QAbstractItemModel>
+#include <QFileSystemWatcher>
+#include <QIcon>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+#include <QTimer>
+#include <memory>
+#include <vector>
+
+// File tree under a root directory that never blocks the GUI thread.
+//
+// A directory is listed the first time it is expanded: a worker reads it
+// with readdir, which reports the entry types without a stat call for each
+// entry on most file systems, sorts it and hands the entries over in
+// batches, so the view stays responsive while a directory with hundreds of
+// thousands of entries fills in. Listed directories are watched, a change
+// lists them again and only the entries that came or went are inserted or
+// removed, so expanded subdirectories and the selection stay. VCS metadata,
+// build trees and hidden directories are left out. Rows have a single column
+// and a uniform height, the view only lays out the visible ones.
+class LazyDirModel : public QAbstractItemModel {
+  Q_OBJECT
+
+ public:
+  explicit LazyDirModel(QObject *parent = nullptr);
+  LazyDirModel(const LazyDirModel &) = delete;
+  LazyDirModel &operator=(const LazyDirModel &) = delete;
+  ~LazyDirModel();
+
+  void setRootPath(const QString &path);
+  QString rootPath() const;
+  QString filePath(const QModelIndex &index) const;
+  bool isDir(const QModelIndex &index) const;
+
+  QModelIndex index(int row, int column,
+                    const QModelIndex &parent = QModelIndex()) const override;
+  QModelIndex parent(const QModelIndex &index) const override;
+  int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+  int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+  bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex &index,
+                int role = Qt::DisplayRole) const override;
+  QVariant headerData(int section, Qt::Orientation orientation,
+                      int role = Qt::DisplayRole) const override;
+  bool canFetchMore(const QModelIndex &parent) const override;
+  void fetchMore(const QModelIndex &parent) override;
+
+  // What the workers report for a directory entry
+  struct Entry {
+    QString name;
+    bool is_dir = false;
+  };
+
+ private:
+  struct Node {
+    enum class State { Unlisted, Listing, Listed };
+
+    QString name;
+    bool is_dir = false;
+    State state = State::Unlisted;
+    // only the results of the latest listing of the directory are taken
+    int listing = 0;
+    Node *parent = nullptr;
+    int row = 0;
+    std::vector<std::unique_ptr<Node>> children;
+  };
+
+  std::unique_ptr<Node> root_;
+  QString root_path_;
+  // numbers every listing, those started for an earlier root or replaced by
+  // a newer one are dropped when they arrive
+  int listings_ = 0;
+  QFileSystemWatcher watcher_;
+  // directories changed on disk, listed again together
+  QSet<QString> changed_;
+  QTimer relist_timer_;
+  // when the root was set, for the startup trace
+  qint64 listing_started_ = 0;
+  QThreadPool pool_;
+  QIcon dir_icon_;
+  QIcon file_icon_;
+
+  Node *nodeOf(const QModelIndex &index) const;
+  QModelIndex indexOf(Node *node) const;
+  QString pathOf(const Node *node) const;
+  // The listed directory at path, nullptr when it is not in the tree
+  Node *nodeAt(const QString &path) const;
+  void list(Node *node);
+  void appendEntries(const QString &path, int listing,
+                     const std::vector<Entry> &entries, bool last);
+  void directoryChanged(const QString &path);
+  void relistChanged();
+  void relist(Node *node);
+  // Replaces the children of the directory by the entries, keeping the
+  // nodes of the entries that stayed
+  void mergeEntries(const QString &path, int listing,
+                    const std::vector<Entry> &entries);
+  // Stops watching the directories listed under node and node itself
+  void unwatch(const Node *node);
+};
+
+#endif  // LAZY_DIR_MODEL_H
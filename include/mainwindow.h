@@ -2,8 +2,13 @@
 #define MAINWINDOW_H
 
 #include <QAbstractItemModel>
+#include <QHash>
+#include <QLabel>
+#include <QPointer>
+#include <QSet>
 #include <QGridLayout>
 #include <QSplitter>
+#include <QTabBar>
 #include <QTimer>
 #include <QtCore/QVariant>
 #include <QtWidgets/QApplication>
@@ -15,10 +20,23 @@
 #include <vector>
 
 #include "autocomplete/handler.h"
+#include "build_panel.h"
+#include "diagnostics_model.h"
 #include "directory_tree.h"
+#include "document.h"
+#include "document_manager.h"
+#include "file_saver.h"
 #include "editor.h"
 #include "file_view.h"
+#include "find_in_files.h"
+#include "path_index.h"
+#include "quick_open.h"
+#include "references_panel.h"
+#include "search_bar.h"
+#include "symbol_index.h"
+#include "symbol_palette.h"
 #include "terminal.h"
+#include "workspace_files.h"
 
 QT_BEGIN_NAMESPACE
 class QAction;
@@ -26,6 +44,8 @@ class QMenu;
 class QPlainTextEdit;
 class QSessionManager;
 class QComboBox;
+class QDockWidget;
+class QTreeView;
 
 class QSyntaxStyle;
 class QStyleSyntaxHighlighter;
@@ -66,21 +86,45 @@ class MainWindow : public QMainWindow {
 
  protected:
   void closeEvent(QCloseEvent *event) override;
+  bool eventFilter(QObject *watched, QEvent *event) override;
 
  private slots:
   void newFile();
   void open();
   bool save();
   bool saveAs();
+  void saveAll();
+  void saveFinished(int ticket, const QString &fileName,
+                    const QString &error, const QByteArray &digest);
+  void fileChangedOnDisk(int index);
   void choose_directory();
   void split();
-  void documentWasModified();
+  void closePane();
+  void tabChanged(int index);
+  void closeTab(int index);
+  void connectDocument(Document *doc);
+  void recoverJournals();
+  // Launches the shell and the language servers, once the window is painted
+  void startServices();
   void textSize(const QString &p);
   void mergeFormatOnWordOrSelection(const QTextCharFormat &format);
   void currentCharFormatChanged(const QTextCharFormat &format);
-  void showCursorPosition();
-  void showCursorPositionOnSplitted();
   void tree_clicked(const QModelIndex &index);
+  void find();
+  void replace();
+  void goToSymbol();
+  void goToFile();
+  void findInFiles();
+  void goToDefinition();
+  void findReferences();
+  void openLocation(const QString &fileName, int line);
+  // line and column are zero-based
+  void goToLocation(const QString &fileName, int line, int column);
+  void build();
+  void setBuildCommand();
+  // Lists the messages of the last build with the problems and marks their
+  // lines in the open documents
+  void showBuildDiagnostics();
 
  private:
   Ui::MainWindow *ui;
@@ -89,14 +133,48 @@ class MainWindow : public QMainWindow {
   void readSettings();
   void writeSettings();
   bool maybeSave();
-  bool saveFile(const QString &fileName, Editor *editArea);
-  void setCurrentFile(const QString &fileName, Editor *editArea);
+  // Without wait only the write is started. With wait it is committed before
+  // returning, the result tells whether the file was written.
+  bool saveFile(const QString &fileName, bool wait = false);
+  // Empty when the user cancelled
+  QString askFileName();
+  // Writes the document to fileName, which becomes its name once the write
+  // is committed
+  void startSave(Document *doc, const QString &fileName);
+  // Runs the build command in the root directory
+  void startBuild();
+  // Marks the lines of the document the last build complained about
+  void setBuildMarkers(Document *doc);
+  void setCurrentFile(const QString &fileName);
   void fontChanged(const QFont &f);
   QString strippedName(const QString &fullFileName);
-
-  Editor *textEdit;
-  Editor *splittedTextEdit;
-  QString curFile;
+  Editor *activeEditor();
+  // New pane over the document, starting at the cursor and scroll position of
+  // source when it is given
+  Editor *createPane(Editor *source);
+  void showCursorPosition(Editor *pane);
+  QCompleter *createCompleter();
+  void updateTab(int index);
+  // Puts the cursor of the active pane at the zero-based line and column of
+  // the current document
+  void showLocation(int line, int column);
+
+  DocumentManager *documents;
+  QTabBar *tab_bar;
+  // document of the current tab, shown by every pane
+  Document *document = nullptr;
+  int current_tab = -1;
+  QList<Editor *> panes;
+  struct PendingSave {
+    QPointer<Document> document;
+    quint64 revision;
+    int length;
+  };
+  FileSaver *saver;
+  // encoding and line endings of the current document
+  QLabel *format_label;
+  QHash<int, PendingSave> pending_saves;
+  int failed_saves = 0;
   QComboBox *comboSize;
   QToolBar *tb;
   QWidget *central_widget;
@@ -104,20 +182,42 @@ class MainWindow : public QMainWindow {
   QSplitter *splitter;
   Terminal *terminal;
   Directory_tree directory_tree;
-  bool splitted;
   lsp::LSPHandler *lsp_handler;
   QTimer *timer;
-  FileView *fv = nullptr;
   QAbstractItemModel *model;
   QCompleter *completer = nullptr;
-  QCompleter *splittedCompleter = nullptr;
-  FileView *fv_split = nullptr;
-  QPlainTextEdit *display_failure_log;
+  DiagnosticsModel *diagnostics_model;
+  QTreeView *diagnostics_view;
+  // directory watches shared by the indices of the root
+  workspace::Watcher *workspace_watcher;
+  SymbolIndex *symbol_index;
+  SymbolPalette *symbol_palette;
+  PathIndex *path_index;
+  QuickOpen *quick_open;
+  FindInFiles *find_in_files;
+  QDockWidget *find_dock;
+  BuildPanel *build_panel;
+  QDockWidget *build_dock;
+  // the build waits for the saves it started to be committed
+  bool build_pending = false;
+  // listed with the problems by the last build
+  QSet<QString> build_files;
+  ReferencesPanel *references_panel;
+  QDockWidget *references_dock;
+  // document whose search fills the references panel
+  Document *references_document = nullptr;
+  SearchBar *search_bar;
   QFont *font;
   QFontMetrics *metrics;
+  // announced by the language server, shared by every document
+  QStringList trigger_characters;
+  bool services_started = false;
+  // the first key press ends the startup trace
+  bool typed = false;
  private slots:
-  void displayAutocompleteOptions(const std::vector<std::string> &);
-  void displayAutocompleteOptionsSplit(const std::vector<std::string> &);
-  void display_failure(const std::vector<lsp::DiagnosticsResponse> &);
+  void displayAutocompleteOptions(const std::vector<lsp::CompletionItem> &);
+  void showDiagnostics(Document *doc,
+                       const std::vector<lsp::DiagnosticsResponse> &);
+  void diagnosticActivated(const QModelIndex &index);
 };
 #endif  // MAINWINDOW_H
@@ -0,0 +1,92 @@
+#ifndef PATH_INDEX_H
+#define PATH_INDEX_H
+
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QThreadPool>
+#include <QTimer>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "workspace_files.h"
+
+// Relative paths of all files under the workspace root, for quick open.
+//
+// The list is built on a background thread and saved in the cache
+// directory, the next session starts from the saved list while it is
+// refreshed. Directories are watched, a change lists only the changed
+// directories again. The paths are kept in one contiguous buffer, a query
+// scores them in parallel chunks and narrows the candidates of the previous
+// query when the new one extends it.
+class PathIndex : public QObject {
+  Q_OBJECT
+
+ public:
+  struct Match {
+    QString path;  // relative to the root
+    int score;
+  };
+
+  explicit PathIndex(workspace::Watcher *watcher, QObject *parent = nullptr);
+  PathIndex(const PathIndex &) = delete;
+  PathIndex &operator=(const PathIndex &) = delete;
+  ~PathIndex();
+
+  void setRoot(const QString &root);
+  QString root() const;
+  int count() const;
+
+  // Paths holding the characters of the query in order, best first. Matches
+  // at the start of path components and words, runs of consecutive
+  // characters and matches inside the file name score higher.
+  // total_matches gets the number of matches before the limit.
+  std::vector<Match> find(const QString &query, std::size_t limit,
+                          std::size_t *total_matches = nullptr);
+
+  // The paths in one buffer, shared with the workers
+  struct Paths {
+    std::string text;
+    // ASCII folded to lower case, same offsets as text
+    std::string folded;
+    // start of every path in text, one more at the end
+    std::vector<uint32_t> offsets;
+  };
+
+ signals:
+  void updated();
+
+ private slots:
+  void directoryChanged(const QString &path);
+  void startRebuild();
+
+ private:
+  QString root_;
+  QString cache_path_;
+  std::shared_ptr<const Paths> paths_;
+
+  workspace::Watcher *watcher_;
+  // directories walked so far, the watcher is shared with other indices
+  QSet<QString> directories_;
+  QTimer rebuild_timer_;
+  QStringList dirty_dirs_;
+  bool full_rebuild_ = false;
+  QPointer<QThread> worker_;
+  std::shared_ptr<std::atomic<bool>> cancelled_;
+
+  QThreadPool pool_;
+  // paths matching last_query_, a longer query only looks at these
+  std::string last_query_;
+  std::vector<uint32_t> candidates_;
+
+  void stopWorker();
+  void rebuildFinished(std::shared_ptr<const Paths> paths,
+                       const QStringList &directories, bool full);
+};
+
+#endif  // PATH_INDEX_H
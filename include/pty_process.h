@@ -0,0 +1,55 @@
+#ifndef PTY_PROCESS_H
+#define PTY_PROCESS_H
+
+#include <sys/types.h>
+
+#include <QByteArray>
+#include <QObject>
+#include <QSocketNotifier>
+#include <QString>
+#include <QStringList>
+
+// A program running on a pseudo terminal, so it sees a terminal as its
+// standard streams: shells are interactive, programs keep their colors and
+// the output of stdout and stderr arrives in the order it was written.
+class PtyProcess : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit PtyProcess(QObject *parent = nullptr);
+  // Kills the program
+  ~PtyProcess();
+
+  // The program is searched in PATH, TERM tells it what it talks to
+  bool start(const QString &program, const QStringList &arguments, int rows,
+             int columns);
+  bool isRunning() const;
+  void write(const QByteArray &data);
+  // Also sends SIGWINCH to the program
+  void resize(int rows, int columns);
+  // Takes at most max bytes of what the program wrote. Once enough is
+  // buffered the output is no longer read, so a program writing faster than
+  // it is shown blocks on the full terminal until the buffer drains.
+  QByteArray read(int max);
+  int bytesAvailable() const;
+
+ signals:
+  void readyRead();
+  void finished(int exitCode);
+
+ private slots:
+  void readOutput();
+  void writeInput();
+
+ private:
+  int master_ = -1;
+  pid_t pid_ = -1;
+  QSocketNotifier *read_notifier_ = nullptr;
+  QSocketNotifier *write_notifier_ = nullptr;
+  QByteArray output_;
+  QByteArray input_;
+
+  void finish();
+};
+
+#endif  // PTY_PROCESS_H
@@ -0,0 +1,38 @@
+#ifndef QUICK_OPEN_H
+#define QUICK_OPEN_H
+
+#include <QDialog>
+#include <QLabel>
+#include <QLineEdit>
+#include <QListWidget>
+
+#include "path_index.h"
+
+// Go to file popup, fuzzy matches the typed characters against the paths
+// under the workspace root
+class QuickOpen : public QDialog {
+  Q_OBJECT
+
+ public:
+  explicit QuickOpen(PathIndex *index, QWidget *parent = nullptr);
+
+  void popup();
+
+ signals:
+  void fileChosen(const QString &path);
+
+ protected:
+  bool eventFilter(QObject *watched, QEvent *event) override;
+
+ private slots:
+  void search();
+  void choose();
+
+ private:
+  PathIndex *index_;
+  QLineEdit *input_;
+  QListWidget *results_;
+  QLabel *status_;
+};
+
+#endif  // QUICK_OPEN_H
@@ -0,0 +1,51 @@
+#ifndef REFERENCES_PANEL_H
+#define REFERENCES_PANEL_H
+
+#include <QLabel>
+#include <QListView>
+#include <QString>
+#include <QWidget>
+#include <vector>
+
+#include "lsp_basic.h"
+
+class DocumentManager;
+class ReferencesModel;
+
+// Panel listing the places a symbol is used, or its definitions when there
+// are several. A search in a big project finds tens of thousands of them,
+// which arrive in batches while the server is still searching. Rows are
+// appended to a model behind a view of uniform rows, so only the visible
+// ones are laid out. The line shown next to a reference is taken from the
+// open document when there is one, so it shows unsaved edits, otherwise a
+// worker reads it from disk while the batch is already listed.
+class ReferencesPanel : public QWidget {
+  Q_OBJECT
+
+ public:
+  explicit ReferencesPanel(QWidget *parent = nullptr);
+
+  // Paths are shown relative to root
+  void setRoot(const QString &root);
+  // Open documents the lines of the references are taken from
+  void setDocuments(const DocumentManager *documents);
+  // Clears the list for the locations of what
+  void start(const QString &what);
+  void addLocations(const std::vector<lsp::Location> &locations,
+                    bool finished);
+
+ signals:
+  // line and column are zero-based
+  void locationChosen(const QString &path, int line, int column);
+
+ private slots:
+  void choose(const QModelIndex &index);
+
+ private:
+  ReferencesModel *model_;
+  QListView *list_;
+  QLabel *status_;
+  QString what_;
+};
+
+#endif  // REFERENCES_PANEL_H
@@ -0,0 +1,51 @@
+#ifndef SEARCH_BAR_H
+#define SEARCH_BAR_H
+
+#include <QCheckBox>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPointer>
+#include <QWidget>
+
+#include "document_search.h"
+#include "editor.h"
+
+// Find and replace bar shown under the editors
+class SearchBar : public QWidget {
+  Q_OBJECT
+
+ public:
+  explicit SearchBar(QWidget *parent = nullptr);
+
+  // Attaches the bar to the editor and focuses the query, with replace the
+  // replacement row is shown as well
+  void activate(Editor *editor, bool replace);
+
+ public slots:
+  void findNext();
+  void findPrevious();
+  void closeBar();
+
+ protected:
+  void keyPressEvent(QKeyEvent *event) override;
+
+ private slots:
+  void queryChanged();
+  void replaceOne();
+  void replaceAll();
+  void updateStatus();
+
+ private:
+  QPointer<Editor> editor_;
+  DocumentSearch search_;
+  QLineEdit *find_;
+  QLineEdit *replace_;
+  QCheckBox *regex_;
+  QCheckBox *case_sensitive_;
+  QLabel *status_;
+  QWidget *replace_row_;
+
+  void select(int index);
+};
+
+#endif  // SEARCH_BAR_H
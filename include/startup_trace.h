@@ -0,0 +1,48 @@
+#ifndef STARTUP_TRACE_H
+#define STARTUP_TRACE_H
+
+#include <QString>
+#include <QtGlobal>
+#include <functional>
+
+// Wall-clock timings of a cold start. The trace is on with --profile-startup
+// or when the BATON_STARTUP_TRACE environment variable is set, every phase
+// is printed to stderr as it ends and kept for the report. Only the first
+// occurrence of a phase is kept, so per document phases count for the first
+// document. Only used on the GUI thread.
+namespace startup_trace {
+
+// Starts the clock, called first in main
+void Start();
+void Enable();
+bool IsEnabled();
+// Milliseconds since Start
+qint64 Now();
+
+// A moment, e.g. the first paint
+void Mark(const char *phase);
+// A phase which began at start, a value of Now, and ends now
+void Record(const char *phase, qint64 start);
+// Calls done once the phase is recorded
+void WhenRecorded(const char *phase, std::function<void()> done);
+
+// Records the lifetime of the object as a phase
+class Phase {
+ public:
+  explicit Phase(const char *name);
+  ~Phase();
+  Phase(const Phase &) = delete;
+  Phase &operator=(const Phase &) = delete;
+
+ private:
+  const char *name_;
+  qint64 start_;
+};
+
+// One line per phase: name, start and duration in milliseconds, separated
+// by tabs
+bool WriteReport(const QString &fileName, QString *error);
+
+}  // namespace startup_trace
+
+#endif  // STARTUP_TRACE_H
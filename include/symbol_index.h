@@ -0,0 +1,83 @@
+#ifndef SYMBOL_INDEX_H
+#define SYMBOL_INDEX_H
+
+#include <QFile>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QTimer>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "lsp_basic.h"
+#include "workspace_files.h"
+
+struct IndexedSymbol {
+  QString name;
+  QString container;
+  QString path;
+  int line = 0;  // zero-based
+  lsp::SymbolKind kind = lsp::SymbolKind::Function;
+};
+
+// Project wide index of C++ declarations under the workspace root.
+//
+// The index lives in a single file in the cache directory and is memory
+// mapped for queries. It is rebuilt on a background thread: files whose size
+// and mtime did not change are copied from the previous index, so after the
+// first run only edited files are tokenized again. Directories are watched
+// and a change schedules a rebuild limited to the changed directories. Files
+// written in place do not change their directory, a periodic rebuild finds
+// them by their size and mtime.
+class SymbolIndex : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit SymbolIndex(workspace::Watcher *watcher, QObject *parent = nullptr);
+  SymbolIndex(const SymbolIndex &) = delete;
+  SymbolIndex &operator=(const SymbolIndex &) = delete;
+  ~SymbolIndex();
+
+  void setRoot(const QString &root);
+  QString root() const;
+
+  // Case-insensitive substring search, exact and prefix matches go first
+  std::vector<IndexedSymbol> find(const QString &query,
+                                  std::size_t limit) const;
+
+ signals:
+  void updated();
+
+ private slots:
+  void directoryChanged(const QString &path);
+  void startRebuild();
+
+ private:
+  QString root_;
+  QString index_path_;
+  QFile index_file_;
+  uchar *data_ = nullptr;
+  qint64 size_ = 0;
+
+  workspace::Watcher *watcher_;
+  // directories walked so far, the watcher is shared with other indices
+  QSet<QString> directories_;
+  QTimer rebuild_timer_;
+  QTimer rescan_timer_;
+  QStringList dirty_dirs_;
+  bool full_rebuild_ = false;
+
+  QPointer<QThread> worker_;
+  std::shared_ptr<std::atomic<bool>> cancelled_;
+
+  void mapIndex();
+  void unmapIndex();
+  void stopWorker();
+  void rebuildFinished(const QStringList &directories, bool full);
+};
+
+#endif  // SYMBOL_INDEX_H
@@ -0,0 +1,62 @@
+#ifndef SYMBOL_PALETTE_H
+#define SYMBOL_PALETTE_H
+
+#include <QDialog>
+#include <QHash>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QPointer>
+#include <QSet>
+#include <QString>
+#include <QTimer>
+#include <string>
+#include <vector>
+
+#include "file_view.h"
+#include "symbol_index.h"
+
+// Go to symbol popup. The local index answers on every keystroke, clangd's
+// workspace/symbol results are merged in when they arrive. Server answers
+// are cached per query, a complete answer for a prefix of the query is
+// filtered locally instead of asking the server again.
+class SymbolPalette : public QDialog {
+  Q_OBJECT
+
+ public:
+  SymbolPalette(SymbolIndex *index, FileView *server,
+                QWidget *parent = nullptr);
+
+  // The server follows the active document, it may be null while no
+  // document is open
+  void setServer(FileView *server);
+  void popup();
+
+ signals:
+  void symbolChosen(const QString &path, int line);
+
+ protected:
+  bool eventFilter(QObject *watched, QEvent *event) override;
+
+ private slots:
+  void search();
+  void choose();
+  void requestServer();
+  void serverAnswered(const std::string &query,
+                      const std::vector<lsp::SymbolInformation> &symbols);
+
+ private:
+  SymbolIndex *index_;
+  QPointer<FileView> server_;
+  QLineEdit *input_;
+  QListWidget *results_;
+  QTimer request_timer_;
+  QHash<QString, std::vector<IndexedSymbol>> server_cache_;
+  QSet<QString> requested_;
+
+  // Best cached server answer for the query, complete is set when asking
+  // the server again cannot bring anything new
+  std::vector<IndexedSymbol> cachedSymbols(const QString &query,
+                                           bool *complete) const;
+};
+
+#endif  // SYMBOL_PALETTE_H
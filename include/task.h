@@ -0,0 +1,19 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include <QRunnable>
+#include <functional>
+#include <utility>
+
+// Runs a function on a QThreadPool, which deletes the task when it is done
+class Task : public QRunnable {
+ public:
+  explicit Task(std::function<void()> function)
+      : function_(std::move(function)) {}
+  void run() override { function_(); }
+
+ private:
+  std::function<void()> function_;
+};
+
+#endif  // TASK_H
@@ -1,28 +1,65 @@
 #ifndef TERMINAL_H
 #define TERMINAL_H
 
-#include <QWidget>
+#include <QAbstractScrollArea>
+#include <QAction>
+#include <QFont>
+#include <QTimer>
 #include <QtCore>
 
-namespace Ui {
-class Terminal;
-}
+#include "pty_process.h"
+#include "terminal_screen.h"
 
-class Terminal : public QWidget {
+// Shell on a pseudo terminal. Its output is collected and parsed into the
+// screen once per frame, and only the lines which changed are painted again.
+// Parsing takes at most a part of each frame, a flood of output waits in the
+// pseudo terminal meanwhile, so the window stays responsive.
+//
+// With follow tail on, output brings the newest line into view, and the lines
+// which scroll past within a frame are never painted. Otherwise the view
+// stays where it was scrolled to. Shift+PageUp and Shift+PageDown page through
+// the scrollback, Ctrl+Shift+V pastes.
+class Terminal : public QAbstractScrollArea {
   Q_OBJECT
 
  public:
   explicit Terminal(QWidget *parent = nullptr);
   ~Terminal();
+  // Launches the shell, which is not done by the constructor so the window
+  // can be shown first
+  void start();
 
- public slots:
-  void readStandardOutput();
-  void readStandardError();
-  void command();
+ protected:
+  void paintEvent(QPaintEvent *event) override;
+  void resizeEvent(QResizeEvent *event) override;
+  void keyPressEvent(QKeyEvent *event) override;
+  void contextMenuEvent(QContextMenuEvent *event) override;
+  void scrollContentsBy(int dx, int dy) override;
+  // Tab goes to the shell
+  bool focusNextPrevChild(bool next) override;
+
+ private slots:
+  void outputReady();
+  void renderFrame();
+  void shellFinished(int exitCode);
 
  private:
-  Ui::Terminal *ui;
-  QProcess *process;
+  PtyProcess *process_;
+  TerminalScreen screen_;
+  QTimer frame_timer_;
+  QAction *follow_tail_;
+  // shown once the output before it was parsed
+  QByteArray exit_message_;
+  QFont bold_font_;
+  int cell_width_;
+  int line_height_;
+  int ascent_;
+  // line of the cursor when it was last painted
+  int painted_cursor_ = -1;
+
+  void paste();
+  void resizeScreen();
+  void updateLine(int index);
 };
 
 #endif  // TERMINAL_H
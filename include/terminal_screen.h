@@ -0,0 +1,130 @@
+#ifndef TERMINAL_SCREEN_H
+#define TERMINAL_SCREEN_H
+
+#include <QByteArray>
+#include <QtGlobal>
+#include <memory>
+#include <vector>
+
+class QTextDecoder;
+
+// Character grid of a terminal, fed with the output of the program running
+// in it. Understands the xterm control sequences programs commonly use:
+// cursor movement, erasing, scroll regions, colors and attributes and the
+// alternate screen. Other sequences are skipped.
+//
+// Lines leaving the top of the screen go to a scrollback of fixed capacity,
+// a ring whose oldest line is reused for the next one, so a long running
+// build costs no more memory than a short one.
+class TerminalScreen {
+ public:
+  // Colors are indices into the xterm palette of 256 colors
+  static constexpr quint16 DEFAULT_COLOR = 256;
+  enum Attribute : quint8 { BOLD = 1, UNDERLINE = 2, INVERSE = 4 };
+
+  struct Cell {
+    char16_t character = ' ';
+    quint16 foreground = DEFAULT_COLOR;
+    quint16 background = DEFAULT_COLOR;
+    quint8 attributes = 0;
+  };
+  using Line = std::vector<Cell>;
+
+  // What changed since the last takeDamage
+  struct Damage {
+    // rows of the screen to repaint, counted after the scrolling
+    std::vector<int> rows;
+    // lines the whole screen moved up
+    int scrolled = 0;
+    // oldest lines of the scrollback dropped for new ones
+    int dropped = 0;
+    bool all = false;
+  };
+
+  TerminalScreen(int rows, int columns, int scrollback_capacity);
+  ~TerminalScreen();
+
+  int rows() const { return rows_; }
+  int columns() const { return columns_; }
+  void resize(int rows, int columns);
+
+  void feed(const QByteArray &data);
+  // Answers to queries of the program, to be written back to it
+  QByteArray takeReplies();
+  Damage takeDamage();
+
+  // Lines of the scrollback, the oldest first, followed by the rows of the
+  // screen
+  int lineCount() const;
+  int scrollbackCount() const;
+  const Line &line(int index) const;
+
+  int cursorRow() const { return row_; }
+  int cursorColumn() const { return qMin(column_, columns_ - 1); }
+  bool cursorVisible() const { return cursor_visible_; }
+  // Cursor keys send ESC O instead of ESC [
+  bool applicationCursorKeys() const { return application_cursor_keys_; }
+
+ private:
+  enum class State { Ground, Escape, Charset, Csi, Osc, OscEscape };
+
+  int rows_;
+  int columns_;
+  std::vector<Line> main_;
+  std::vector<Line> alternate_;
+  bool alternate_active_ = false;
+  std::vector<Line> scrollback_;
+  std::size_t scrollback_capacity_;
+  std::size_t scrollback_start_ = 0;
+
+  int row_ = 0;
+  int column_ = 0;
+  // a character written into the last column wraps the next one
+  bool wrap_pending_ = false;
+  Cell pen_;
+  int saved_row_ = 0;
+  int saved_column_ = 0;
+  Cell saved_pen_;
+  // scroll region, inclusive
+  int top_ = 0;
+  int bottom_;
+  bool autowrap_ = true;
+  bool cursor_visible_ = true;
+  bool application_cursor_keys_ = false;
+
+  State state_ = State::Ground;
+  std::vector<int> parameters_;
+  char16_t marker_ = 0;
+  std::unique_ptr<QTextDecoder> decoder_;
+  QByteArray replies_;
+
+  std::vector<char> dirty_;
+  int scrolled_ = 0;
+  int dropped_ = 0;
+  bool all_dirty_ = true;
+
+  std::vector<Line> &screen();
+  Line blankLine() const;
+  void clearCells(Line *line, int from, int to);
+  void process(char16_t c);
+  void put(char16_t c);
+  void lineFeed();
+  void reverseLineFeed();
+  // save moves the lines leaving the top into the scrollback
+  void scrollUp(int top, int count, bool save);
+  void scrollDown(int top, int count);
+  void pushScrollback(Line *line);
+  void executeEscape(char16_t c);
+  void executeCsi(char16_t final);
+  void setMode(int mode, bool enable);
+  void selectGraphicRendition();
+  void eraseDisplay(int mode);
+  void eraseLine(int mode);
+  void moveCursor(int row, int column);
+  int parameter(std::size_t index, int fallback) const;
+  void touch(int row);
+  void touchAll();
+  void reset();
+};
+
+#endif  // TERMINAL_SCREEN_H
@@ -0,0 +1,31 @@
+#ifndef TEXT_DIFF_H
+#define TEXT_DIFF_H
+
+#include <QByteArray>
+#include <QString>
+#include <vector>
+
+// Differences between two versions of a text, used to bring a document up
+// to date with its file without replacing the whole text
+namespace text_diff {
+
+struct Edit {
+  int position;
+  int removed;
+  QString added;
+};
+
+// Edits turning before into after, ordered by position. Positions refer to
+// before, so the edits are applied from the last one. Lines are compared
+// with Myers' algorithm, when more than max_cost lines differ the changed
+// region is replaced as a whole.
+std::vector<Edit> Diff(const QString &before, const QString &after,
+                       int max_cost = 1000);
+
+// Short fingerprint of a text, tells whether a file still holds the text
+// that was last read from or written to it
+QByteArray Digest(const QString &text);
+
+}  // namespace text_diff
+
+#endif  // TEXT_DIFF_H
@@ -0,0 +1,48 @@
+#ifndef TEXT_FORMAT_H
+#define TEXT_FORMAT_H
+
+#include <QByteArray>
+#include <QString>
+
+// Encoding and line endings of a file. A file is decoded into text with '\n'
+// line breaks and encoded back into the same format on save, so opening and
+// saving a file changes only what was edited, with three exceptions:
+// - a file mixing line endings gets the more common one on every line,
+// - a UTF-16 file with an odd number of bytes gets its last byte back as
+//   U+FFFD, the character it is shown as,
+// - a Latin-1 file holding a character Latin-1 lacks is written as UTF-8,
+//   see EncodedAs.
+namespace text_format {
+
+enum class Encoding {
+  Utf8,
+  Utf8WithBom,
+  Utf16LE,
+  Utf16BE,
+  // bytes that are not valid UTF-8, every byte maps to one character and
+  // back, so nothing is lost
+  Latin1,
+};
+
+struct Format {
+  Encoding encoding = Encoding::Utf8;
+  bool crlf = false;
+};
+
+// Looks at the byte order mark, checks whether the data is valid UTF-8 and
+// counts the line endings. Files mixing both line endings get the more
+// common one. Uses SSE2 when available.
+Format Detect(const QByteArray &data);
+
+QString Decode(const QByteArray &data, const Format &format);
+// The format Encode writes the text in, which is format unless the text
+// does not fit the encoding
+Format EncodedAs(const QString &text, const Format &format);
+QByteArray Encode(const QString &text, const Format &format);
+
+// Short description for the status bar, like "UTF-8 CRLF"
+QString Describe(const Format &format);
+
+}  // namespace text_format
+
+#endif  // TEXT_FORMAT_H
@@ -0,0 +1,27 @@
+#ifndef TEXT_SEARCH_H
+#define TEXT_SEARCH_H
+
+#include <QString>
+#include <string>
+
+// Byte level helpers shared by the searches over files and documents
+namespace text_search {
+
+// First occurrence of needle in [begin, end) or nullptr. Case folding is
+// ASCII only, callers check non-ASCII matches with a regular expression.
+// Uses AVX2 or SSE2 when the CPU has them.
+const char *FindLiteral(const char *begin, const char *end,
+                        const std::string &needle, bool case_sensitive);
+
+// Same for UTF-16 text as stored by QString
+const ushort *FindText(const ushort *begin, const ushort *end,
+                       const ushort *needle, int size, bool case_sensitive);
+
+// Longest literal that every match of the regular expression contains,
+// empty when no such literal is found. Used to skip the regex engine on
+// text that cannot match.
+QString RequiredLiteral(const QString &pattern);
+
+}  // namespace text_search
+
+#endif  // TEXT_SEARCH_H
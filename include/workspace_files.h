@@ -0,0 +1,61 @@
+#ifndef WORKSPACE_FILES_H
+#define WORKSPACE_FILES_H
+
+#include <QFileSystemWatcher>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+
+// Helpers to walk the workspace root from background threads, and the watch
+// over its directories shared by the indices
+namespace workspace {
+
+// VCS metadata, build trees and hidden directories are never descended into
+bool IsIgnoredDirectory(const QString &name);
+
+bool IsSourceFile(const QString &file_name);
+
+// Recursively collects regular files under root. Entries matched by the
+// .gitignore files met on the way are skipped. Every visited directory is
+// appended to directories when it is not null. The walk stops early once
+// cancelled becomes true.
+QStringList ListFiles(const QString &root, QStringList *directories = nullptr,
+                      const std::atomic<bool> *cancelled = nullptr);
+
+// Lists the files of one directory under root again after it changed, with
+// the .gitignore files of root and of every directory down to it applied.
+// Subdirectories missing from known_dirs are new and walked like ListFiles
+// does, their directories are appended to directories.
+QStringList ListDirectory(const QString &root, const QString &directory,
+                          const QSet<QString> &known_dirs,
+                          QStringList *directories = nullptr,
+                          const std::atomic<bool> *cancelled = nullptr);
+
+// Watches the directories of the workspace root found by the walks of the
+// indices, which all hear about every change. inotify watches are a limited
+// resource, huge trees are watched partially.
+class Watcher : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit Watcher(QObject *parent = nullptr);
+
+  // Drops the watches of the previous root
+  void setRoot(const QString &root);
+  void watch(const QStringList &directories);
+
+ signals:
+  // Entries of the directory were added, removed or renamed
+  void directoryChanged(const QString &path);
+
+ private:
+  QString root_;
+  QFileSystemWatcher watcher_;
+  QSet<QString> watched_;
+};
+
+}  // namespace workspace
+
+#endif  // WORKSPACE_FILES_H
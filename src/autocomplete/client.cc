@@ -4,32 +4,73 @@
 #include <QCoreApplication>
 #include <QJsonDocument>
 #include <QJsonObject>
-#include <cstring>
+#include <QPointer>
+#include <QTimer>
+#include <cstdlib>
 #include <iostream>
 #include <memory>
+#include <string>
 
 #include "json_serializers.h"
 #include "nlohmann/json.hpp"
+#include "startup_trace.h"
 
 namespace lsp {
+namespace {
+
+bool launches_held = false;
+
+// clients created while launches are held
+std::vector<QPointer<Client>> &heldClients() {
+  static std::vector<QPointer<Client>> clients;
+  return clients;
+}
+
+}  // namespace
+
 Client::Client(const QString &path, const QStringList &args)
     : process_(new QProcess()) {
   process_->setProgram(path);
   process_->setArguments(args);
   SetConnections();
 
-  process_->start();
-  process_->waitForStarted();
+  if (launches_held) {
+    heldClients().push_back(this);
+  } else {
+    QTimer::singleShot(0, this, &Client::Start);
+  }
 }
 
-Client::~Client() {
-  if (process_) {
-    const int WAITING_TIME = -1;
-    process_->waitForFinished(WAITING_TIME);
+void Client::HoldLaunches() { launches_held = true; }
+
+void Client::ReleaseLaunches() {
+  launches_held = false;
+  std::vector<QPointer<Client>> clients;
+  clients.swap(heldClients());
+  for (const QPointer<Client> &client : clients) {
+    if (client) client->Start();
   }
 }
 
+Client::~Client() {
+  if (!process_ || process_->state() == QProcess::NotRunning) return;
+  // Clients go away whenever a document is evicted, so the server is left
+  // to exit on its own instead of blocking the caller. A server still
+  // running after the timeout is killed.
+  const int EXIT_TIMEOUT_MS = 5000;
+  QProcess *process = process_.release();
+  process->disconnect(this);
+  process->closeWriteChannel();
+  connect(process,
+          QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
+          process, &QObject::deleteLater);
+  QTimer::singleShot(EXIT_TIMEOUT_MS, process, [process]() {
+    process->kill();
+  });
+}
+
 void Client::SetConnections() {
+  connect(process_.get(), &QProcess::started, this, &Client::OnClientStarted);
   connect(process_.get(), &QProcess::errorOccurred, this,
           &Client::OnClientError);
   connect(process_.get(), &QProcess::readyReadStandardOutput, this,
@@ -45,57 +86,73 @@ void Client::SetConnections() {
 }
 
 // private slots
+void Client::Start() {
+  if (process_->state() != QProcess::NotRunning) return;
+  launched_at_ = startup_trace::Now();
+  process_->start();
+}
+
+void Client::OnClientStarted() {
+  started_at_ = startup_trace::Now();
+  startup_trace::Record("clangd launch", launched_at_);
+  for (const auto &row : send_to_server_buffer_) {
+    process_->write(row.c_str());
+  }
+  send_to_server_buffer_.clear();
+}
+
 void Client::OnClientReadyReadStdout() {
-  static std::string buff{};
-  static unsigned msg_size = 0;
+  // stdout is a stream: one read may contain a part of a message as well as
+  // several messages at once, so everything is accumulated and cut by headers
+  read_buffer_ += process_->readAllStandardOutput().toStdString();
 
-  QByteArray cur_buffer = process_->readAllStandardOutput();
+  const std::string HEADER_END = "\r\n\r\n";
+  const std::string CONTENT_LENGTH = "Content-Length: ";
 
+  while (true) {
+    std::size_t header_end = read_buffer_.find(HEADER_END);
+    if (header_end == std::string::npos) {
+      return;
+    }
+    std::size_t msg_start = header_end + HEADER_END.size();
+    std::size_t len_start = read_buffer_.find(CONTENT_LENGTH);
+    if (len_start == std::string::npos || len_start > header_end) {
+      // broken header, skip it
+      read_buffer_.erase(0, msg_start);
+      continue;
+    }
+    len_start += CONTENT_LENGTH.size();
+    std::size_t content_length = std::strtoul(
+        read_buffer_.substr(len_start, header_end - len_start).c_str(),
+        nullptr, 10);
+    if (read_buffer_.size() < msg_start + content_length) {
+      return;  // the middle of the message
+    }
+    std::string payload = read_buffer_.substr(msg_start, content_length);
+    read_buffer_.erase(0, msg_start + content_length);
+    ProcessMessage(payload);
+  }
+}
+
+void Client::ProcessMessage(const std::string &payload) {
   try {
-    auto process_message = [&]() {
-      json msg = json::parse(buff);
-
-      if (msg.contains("id")) {
-        if (msg.contains("method")) {
-          emit OnRequest(msg["method"].get<std::string>(), msg["params"],
-                         msg["id"]);
-        } else if (msg.contains("result")) {
-          emit OnResponse(msg["id"], msg["result"]);
-        } else if (msg.contains("error")) {
-          emit OnError(msg["id"], msg["error"]);
-        }
-      } else if (msg.contains("method")) {
-        if (msg.contains("params")) {
-          emit OnNotify(msg["method"].get<std::string>(), msg["params"]);
+    json msg = json::parse(payload);
+
+    if (msg.contains("id")) {
+      if (msg.contains("method")) {
+        emit OnRequest(msg["method"].get<std::string>(), msg["params"],
+                       msg["id"]);
+      } else if (msg.contains("result")) {
+        if (msg["id"] == "initialize") {
+          startup_trace::Record("clangd initialize", started_at_);
         }
-      } else {
-      }
-
-      buff.clear();
-      msg_size = 0;
-    };
-
-    if (cur_buffer.indexOf("\r\n\r\n") == -1) {  // the middle of the message
-      for (const auto ch : cur_buffer.toStdString()) {
-        buff.push_back(ch);
-      }
-      if (buff.size() == msg_size) {
-        process_message();
+        emit OnResponse(msg["id"], msg["result"]);
+      } else if (msg.contains("error")) {
+        emit OnError(msg["id"], msg["error"]);
       }
-    } else {  // the start of the message
-      int msg_start = cur_buffer.indexOf("\r\n\r\n") +
-                      static_cast<int>(std::strlen("\r\n\r\n"));
-      int len_start = cur_buffer.indexOf("Content-Length: ") +
-                      static_cast<int>(std::strlen("Content-Length: "));
-      int len_end = cur_buffer.indexOf("\r\n");
-      bool ok = false;
-      [[maybe_unused]] int content_length =
-          cur_buffer.mid(len_start, len_end - len_start).toInt(&ok);
-      QByteArray payload = cur_buffer.mid(msg_start);
-      msg_size = payload.size();
-      buff = payload.toStdString();
-      if (payload.size() == content_length) {
-        process_message();
+    } else if (msg.contains("method")) {
+      if (msg.contains("params")) {
+        emit OnNotify(msg["method"].get<std::string>(), msg["params"]);
       }
     }
   } catch (...) {
@@ -172,6 +229,43 @@ Client::RequestType Client::Completion(DocumentUri uri, Position position,
   return SendRequest("textDocument/completion", params);
 }
 
+Client::RequestType Client::CompletionResolve(json item) {
+  return SendRequest("completionItem/resolve", std::move(item));
+}
+
+Client::RequestType Client::WorkspaceSymbol(std::string query) {
+  return SendRequest("workspace/symbol",
+                     WorkspaceSymbolParams{std::move(query)});
+}
+
+Client::RequestType Client::Hover(DocumentUri uri, Position position) {
+  return SendRequest("textDocument/hover",
+                     TextDocumentPositionParams{{std::move(uri)}, position});
+}
+
+Client::RequestType Client::SignatureHelp(DocumentUri uri, Position position) {
+  return SendRequest("textDocument/signatureHelp",
+                     TextDocumentPositionParams{{std::move(uri)}, position});
+}
+
+Client::RequestType Client::Definition(DocumentUri uri, Position position) {
+  return SendRequest("textDocument/definition",
+                     TextDocumentPositionParams{{std::move(uri)}, position});
+}
+
+Client::RequestType Client::References(
+    DocumentUri uri, Position position,
+    const std::string &partial_result_token) {
+  json params = TextDocumentPositionParams{{std::move(uri)}, position};
+  params["context"] = {{"includeDeclaration", true}};
+  params["partialResultToken"] = partial_result_token;
+  return SendRequest("textDocument/references", std::move(params));
+}
+
+void Client::Cancel(const RequestType &id) {
+  SendNotification("$/cancelRequest", {{"id", id}});
+}
+
 // common notification messages
 
 void Client::Exit() { SendNotification("exit", {}); }
@@ -190,6 +284,10 @@ void Client::DidClose(DocumentUri uri) {
   SendNotification("textDocument/didClose", DidCloseTextDocumentParams{uri});
 }
 
+void Client::DidSave(DocumentUri uri) {
+  SendNotification("textDocument/didSave", DidSaveTextDocumentParams{uri});
+}
+
 void Client::DidChange(DocumentUri uri,
                        std::vector<TextDocumentContentChangeEvent> changes,
                        bool wantDiagnostics) {
@@ -221,7 +319,6 @@ void Client::WriteToServer(const std::string &dump) {
     }
     send_to_server_buffer_.clear();
   }
-  process_->waitForReadyRead(10);
 }
 
 void Client::NotifyImpl(std::string method, json params) {
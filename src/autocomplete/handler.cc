@@ -4,14 +4,20 @@
 
 #include <QObject>
 #include <QString>
+#include <algorithm>
 #include <iostream>  // debug
+#include <tuple>
+#include <utility>
 
 namespace lsp {
 LSPHandler::LSPHandler(const std::string& root, const std::string& file_name,
                        const std::string& content)
-    : root_(root), file_(file_name), client_(QString("clangd"), {}) {
+    : root_(root),
+      file_(file_name),
+      uri_("file://" + file_name),
+      client_(QString("clangd"), {}) {
   client_.Initialize("file://" + root_);
-  client_.DidOpen("file:///" + file_, content);
+  client_.DidOpen(uri_, content);
   set_connections();
 }
 void LSPHandler::set_connections() {
@@ -34,70 +40,379 @@ void LSPHandler::set_connections() {
 void LSPHandler::GetResponse(json id, json result) {
   std::string id_str = id.get<std::string>();
 
-  const unsigned MAX_COMPLETION_ITEMS = 13;
-
   if (id_str == "textDocument/completion") {
-    auto is_valid = [&](const std::string& s) {
-      assert(s.size() > 0);
-      if (s.size() == 0) return false;
-      if (s.size() == 1) return true;
-      bool resp =
-          !(s[0] == '_' && (s[1] == '_' || (s[1] >= 'A' && s[1] <= 'Z')));
-      const std::size_t sz = std::string("std::__").size();
-      if (s.size() >= sz) {
-        resp &= std::string(s.begin(), std::next(s.begin(), sz)) != "std::__";
+    ProcessCompletion(std::move(result));
+  } else if (id_str == "initialize") {
+    std::vector<std::string> triggers;
+    json provider =
+        result.value("capabilities", json::object())
+            .value("completionProvider", json::object());
+    for (const auto& trigger :
+         provider.value("triggerCharacters", json::array())) {
+      if (trigger.is_string()) triggers.push_back(trigger.get<std::string>());
+    }
+    emit DoneTriggerCharacters(triggers);
+  } else if (id_str == "completionItem/resolve") {
+    if (resolving_.has_value()) {
+      // ids are not unique, so a late answer for a dropped list is told
+      // apart by its label
+      if (result.value("label", "") !=
+          completion_items_[*resolving_].value("label", "")) {
+        return;
+      }
+      CompletionItem item;
+      from_json(result, item);
+      emit DoneCompletionResolve(*resolving_, item);
+    }
+    ResolveFinished();
+  } else if (id_str == hover_.id) {
+    if (hover_.in_flight.has_value() && !hover_.cancelled) {
+      Hover hover;
+      if (result.is_object()) from_json(result, hover);
+      emit DoneHover(hover_.in_flight->line, hover_.in_flight->character,
+                     hover.contents.value);
+    }
+    PositionRequestFinished(&hover_);
+  } else if (id_str == signature_help_.id) {
+    if (signature_help_.in_flight.has_value() && !signature_help_.cancelled) {
+      SignatureHelp help;
+      if (result.is_object()) from_json(result, help);
+      emit DoneSignatureHelp(signature_help_.in_flight->line,
+                             signature_help_.in_flight->character, help);
+    }
+    PositionRequestFinished(&signature_help_);
+  } else if (id_str == "textDocument/definition") {
+    // a single Location, an array of them or an array of LocationLinks
+    std::vector<Location> locations;
+    if (result.is_object()) result = json::array({result});
+    if (result.is_array()) {
+      for (const auto& raw : result) {
+        Location location;
+        if (raw.contains("targetUri")) {
+          raw.at("targetUri").get_to(location.uri);
+          from_json(raw.value("targetSelectionRange", json::object()),
+                    location.range);
+        } else {
+          from_json(raw, location);
+        }
+        locations.push_back(std::move(location));
+      }
+    }
+    emit DoneDefinition(locations);
+  } else if (id_str == "textDocument/references") {
+    std::vector<Location> batch;
+    // the answer of a search replaced meanwhile is dropped
+    if (result.is_array() && !pending_references_.has_value()) {
+      batch.reserve(result.size());
+      for (const auto& raw : result) {
+        Location location;
+        from_json(raw, location);
+        batch.push_back(std::move(location));
+      }
+    }
+    ReferencesFinished(batch);
+  } else if (id_str == "workspace/symbol") {
+    if (symbol_query_.has_value() && result.is_array()) {
+      std::vector<SymbolInformation> symbols;
+      symbols.reserve(result.size());
+      for (const auto& raw : result) {
+        SymbolInformation symbol;
+        from_json(raw, symbol);
+        symbols.push_back(std::move(symbol));
       }
-      return resp;
-    };
-
-    constexpr char stop_symbols[] = {'<', '(', '$', ' ', '{'};
-    std::vector<std::string> resp;
-    for (auto item : result["items"]) {
-      std::string s = item["insertText"].get<std::string>();
-      if (!is_valid(s)) continue;
-      s = std::string(s.begin(), std::find_if(s.begin(), s.end(), [&](char ch) {
-                        return std::find(std::begin(stop_symbols),
-                                         std::end(stop_symbols),
-                                         ch) != std::end(stop_symbols);
-                      }));
-      resp.push_back(s);
+      emit DoneWorkspaceSymbol(*symbol_query_, symbols);
     }
-    std::sort(resp.begin(), resp.end());
-    resp.erase(std::unique(resp.begin(), resp.end()), resp.end());
-    if (resp.size() > MAX_COMPLETION_ITEMS) resp.clear();
-    emit DoneCompletion(resp);
+    WorkspaceSymbolFinished();
   } else {
     std::cerr << "Response from server: not a completion\n" << std::endl;
   }
 }
 
+void LSPHandler::GetError(json id, json) {
+  if (!id.is_string()) return;
+  // a failed request must not block the ones queued after it
+  std::string id_str = id.get<std::string>();
+  if (id_str == "completionItem/resolve") {
+    ResolveFinished();
+  } else if (id_str == "workspace/symbol") {
+    WorkspaceSymbolFinished();
+  } else if (id_str == hover_.id) {
+    PositionRequestFinished(&hover_);
+  } else if (id_str == signature_help_.id) {
+    PositionRequestFinished(&signature_help_);
+  } else if (id_str == "textDocument/references") {
+    ReferencesFinished({});
+  }
+}
+
+void LSPHandler::ResolveFinished() {
+  resolving_.reset();
+  if (pending_resolve_.has_value()) {
+    std::size_t index = *pending_resolve_;
+    pending_resolve_.reset();
+    ResolveCompletion(index);
+  }
+}
+
+void LSPHandler::WorkspaceSymbolFinished() {
+  symbol_query_.reset();
+  if (pending_symbol_query_.has_value()) {
+    std::string query = std::move(*pending_symbol_query_);
+    pending_symbol_query_.reset();
+    RequestWorkspaceSymbol(query);
+  }
+}
+
+void LSPHandler::SendPositionRequest(PositionRequest* request,
+                                     Position position) {
+  if (request->in_flight.has_value()) {
+    // the answer for the old position is of no use any more
+    CancelPositionRequest(request);
+    request->pending = position;
+    return;
+  }
+  request->in_flight = position;
+  request->cancelled = false;
+  (client_.*request->send)(uri_, position);
+}
+
+void LSPHandler::CancelPositionRequest(PositionRequest* request) {
+  request->pending.reset();
+  if (request->in_flight.has_value() && !request->cancelled) {
+    request->cancelled = true;
+    client_.Cancel(request->id);
+  }
+}
+
+void LSPHandler::PositionRequestFinished(PositionRequest* request) {
+  request->in_flight.reset();
+  if (request->pending.has_value()) {
+    Position position = *request->pending;
+    request->pending.reset();
+    SendPositionRequest(request, position);
+  }
+}
+
+void LSPHandler::ReferencesFinished(const std::vector<Location>& batch) {
+  if (!references_in_flight_) return;
+  references_in_flight_ = false;
+  if (pending_references_.has_value()) {
+    Position position = *pending_references_;
+    pending_references_.reset();
+    references_in_flight_ = true;
+    client_.References(uri_, position, references_token_);
+    return;
+  }
+  references_token_.clear();
+  emit DoneReferences(batch, true);
+}
+
+void LSPHandler::ProcessCompletion(json result) {
+  const unsigned MAX_COMPLETION_ITEMS = 100;
+
+  auto is_valid = [&](const std::string& s) {
+    if (s.size() == 0) return false;
+    if (s.size() == 1) return true;
+    bool resp =
+        !(s[0] == '_' && (s[1] == '_' || (s[1] >= 'A' && s[1] <= 'Z')));
+    const std::size_t sz = std::string("std::__").size();
+    if (s.size() >= sz) {
+      resp &= std::string(s.begin(), std::next(s.begin(), sz)) != "std::__";
+    }
+    return resp;
+  };
+
+  // snippets are not supported by the editor, so everything starting from
+  // the first placeholder or argument list is cut from the inserted text
+  constexpr char stop_symbols[] = {'<', '(', '$', ' ', '{'};
+  auto insertion = [&](const CompletionItem& item) {
+    std::string s = item.label;
+    if (!item.textEdit.newText.empty()) {
+      s = item.textEdit.newText;
+    } else if (!item.insertText.empty()) {
+      s = item.insertText;
+    }
+    s.erase(std::find_if(s.begin(), s.end(),
+                         [&](char ch) {
+                           return std::find(std::begin(stop_symbols),
+                                            std::end(stop_symbols),
+                                            ch) != std::end(stop_symbols);
+                         }),
+            s.end());
+    return s;
+  };
+
+  json& items = result.is_array() ? result : result["items"];
+  completion_incomplete_ =
+      result.is_object() && result.value("isIncomplete", false);
+  std::vector<std::pair<CompletionItem, json>> parsed;
+  for (auto& raw : items) {
+    CompletionItem item;
+    from_json(raw, item);
+    item.insertText = insertion(item);
+    if (!is_valid(item.insertText)) continue;
+    parsed.emplace_back(std::move(item), std::move(raw));
+  }
+
+  // overloads share the inserted text, only the best ranked one is kept
+  std::stable_sort(parsed.begin(), parsed.end(),
+                   [](const auto& l, const auto& r) {
+                     return std::tie(l.first.insertText, l.first.sortText) <
+                            std::tie(r.first.insertText, r.first.sortText);
+                   });
+  parsed.erase(std::unique(parsed.begin(), parsed.end(),
+                           [](const auto& l, const auto& r) {
+                             return l.first.insertText == r.first.insertText;
+                           }),
+               parsed.end());
+  std::stable_sort(parsed.begin(), parsed.end(),
+                   [](const auto& l, const auto& r) {
+                     return std::tie(l.first.sortText, l.first.label) <
+                            std::tie(r.first.sortText, r.first.label);
+                   });
+  if (parsed.size() > MAX_COMPLETION_ITEMS) {
+    parsed.resize(MAX_COMPLETION_ITEMS);
+    completion_incomplete_ = true;
+  }
+
+  std::vector<CompletionItem> resp;
+  completion_items_.clear();
+  resp.reserve(parsed.size());
+  completion_items_.reserve(parsed.size());
+  for (auto& [item, raw] : parsed) {
+    resp.push_back(std::move(item));
+    completion_items_.push_back(std::move(raw));
+  }
+  // a resolve in flight belongs to the previous list
+  resolving_.reset();
+  pending_resolve_.reset();
+  emit DoneCompletion(resp);
+}
+
 void LSPHandler::GetNotify(const std::string& id, json result) {
   if (id == "textDocument/publishDiagnostics") {
     std::vector<lsp::DiagnosticsResponse> resp;
     for (const auto& item : result["diagnostics"]) {
       Range rng;
       from_json(item["range"], rng);
-      resp.emplace_back(
-          lsp::DiagnosticsResponse{item["category"], item["message"], rng});
+      resp.emplace_back(lsp::DiagnosticsResponse{
+          item.value("category", ""), item["message"], rng,
+          static_cast<DiagnosticSeverity>(item.value("severity", 0))});
     }
     emit DoneDiagnostic(resp);
+  } else if (id == "$/progress") {
+    if (references_token_.empty() ||
+        result.value("token", json()) != references_token_ ||
+        !result.contains("value") || !result["value"].is_array()) {
+      return;
+    }
+    std::vector<Location> batch;
+    batch.reserve(result["value"].size());
+    for (const auto& raw : result["value"]) {
+      Location location;
+      from_json(raw, location);
+      batch.push_back(std::move(location));
+    }
+    emit DoneReferences(batch, false);
   } else {
     std::cerr << "Notification from server: not a diagnostics\n";
   }
 }
 
-void LSPHandler::RequestCompletion(std::size_t line, std::size_t col) {
-  client_.Completion("file:///" + file_, Position{line, col});
+void LSPHandler::RequestCompletion(std::size_t line, std::size_t col,
+                                   const std::string& trigger) {
+  CompletionContext context;
+  if (!trigger.empty()) {
+    // the protocol sends the last character of a sequence like "->"
+    context.triggerKind = CompletionTriggerKind::TriggerCharacter;
+    context.triggerCharacter = trigger.substr(trigger.size() - 1);
+  }
+  client_.Completion(uri_, Position{line, col}, context);
+}
+
+bool LSPHandler::CompletionIncomplete() const { return completion_incomplete_; }
+
+void LSPHandler::ResolveCompletion(std::size_t index) {
+  if (index >= completion_items_.size()) return;
+  // only one resolve is kept in flight, while it is running the user may
+  // scroll through many rows and only the last highlighted one is resolved
+  if (resolving_.has_value()) {
+    pending_resolve_ = index;
+    return;
+  }
+  resolving_ = index;
+  client_.CompletionResolve(completion_items_[index]);
 }
 
 void LSPHandler::FileChanged(const std::string& new_content) {
-  client_.DidChange(
-      "file:///" + file_,
-      std::vector<lsp::TextDocumentContentChangeEvent>{{new_content}}, true);
+  lsp::TextDocumentContentChangeEvent change;
+  change.text = new_content;
+  client_.DidChange(uri_, {std::move(change)}, true);
+}
+
+void LSPHandler::ContentChanged(const Range& range, const std::string& text) {
+  lsp::TextDocumentContentChangeEvent change;
+  change.range = range;
+  change.text = text;
+  client_.DidChange(uri_, {std::move(change)}, true);
+}
+
+void LSPHandler::FileSaved() { client_.DidSave(uri_); }
+
+void LSPHandler::FileRenamed(const std::string& file_name,
+                             const std::string& content) {
+  client_.DidClose(uri_);
+  file_ = file_name;
+  uri_ = "file://" + file_name;
+  client_.DidOpen(uri_, content);
+}
+
+void LSPHandler::RequestWorkspaceSymbol(const std::string& query) {
+  // same scheme as for resolve: answers are matched to the query in flight,
+  // and of the queries typed meanwhile only the last one is sent
+  if (symbol_query_.has_value()) {
+    pending_symbol_query_ = query;
+    return;
+  }
+  symbol_query_ = query;
+  client_.WorkspaceSymbol(query);
+}
+
+void LSPHandler::RequestHover(std::size_t line, std::size_t col) {
+  SendPositionRequest(&hover_, Position{line, col});
+}
+
+void LSPHandler::CancelHover() { CancelPositionRequest(&hover_); }
+
+void LSPHandler::RequestSignatureHelp(std::size_t line, std::size_t col) {
+  SendPositionRequest(&signature_help_, Position{line, col});
+}
+
+void LSPHandler::CancelSignatureHelp() {
+  CancelPositionRequest(&signature_help_);
+}
+
+void LSPHandler::RequestDefinition(std::size_t line, std::size_t col) {
+  client_.Definition(uri_, Position{line, col});
+}
+
+void LSPHandler::RequestReferences(std::size_t line, std::size_t col) {
+  // batches of the previous search no longer match
+  references_token_ =
+      "references/" + std::to_string(++references_searches_);
+  if (references_in_flight_) {
+    if (!pending_references_.has_value()) {
+      client_.Cancel("textDocument/references");
+    }
+    pending_references_ = Position{line, col};
+    return;
+  }
+  references_in_flight_ = true;
+  client_.References(uri_, Position{line, col}, references_token_);
 }
 
 LSPHandler::~LSPHandler() {
-  client_.DidClose("file:///" + file_);
+  client_.DidClose(uri_);
   client_.Shutdown();
   client_.Exit();
 }
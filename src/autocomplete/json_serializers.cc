@@ -9,6 +9,25 @@
 // namespace nlohmann
 namespace lsp {
 
+namespace {
+
+// Documentation and hover contents come as a plain string, as MarkupContent
+// or as the deprecated MarkedString, which may also be an array of them
+std::string markup_text(const json &j) {
+  if (j.is_string()) return j.get<std::string>();
+  if (j.is_object()) return j.value("value", "");
+  std::string text;
+  if (j.is_array()) {
+    for (const auto &part : j) {
+      if (!text.empty()) text += "\n\n";
+      text += markup_text(part);
+    }
+  }
+  return text;
+}
+
+}  // namespace
+
 void to_json(json &j, const lsp::URIForFile &uri) { j = uri.str(); }
 void from_json(const json &j, lsp::URIForFile &uri) {
   uri.set_from_encoded(j.get<std::string>());
@@ -157,19 +176,16 @@ void to_json(json &j, const DidCloseTextDocumentParams &value) {
 }
 void from_json(const json &, DidCloseTextDocumentParams &) {}
 
+void to_json(json &j, const DidSaveTextDocumentParams &value) {
+  j = {{"textDocument", value.textDocument}};
+}
+void from_json(const json &, DidSaveTextDocumentParams &) {}
+
 void to_json(json &j, const TextDocumentContentChangeEvent &value) {
-  //    if (value.rangeLength.has_value()) {
-  //      j = {{"range", value.range},
-  //          {"rangeLength", value.rangeLength},
-  //          {"text", value.text}
-  //      };
-  //    }
-  //    else {
-  //      j = {{"range", value.range},
-  //        {"text", value.text}
-  //      };
-  //    }
   j = {{"text", value.text}};
+  if (value.range.has_value()) {
+    j["range"] = *value.range;
+  }
 }
 void from_json(const json &, TextDocumentContentChangeEvent &) {}
 
@@ -413,7 +429,14 @@ void from_json(const json &j, MarkupContent &value) {
 
 void to_json(json &, const Hover &) {}
 void from_json(const json &j, Hover &value) {
-  if (j.contains("contents")) j.at("contents").get_to(value.contents);
+  if (j.contains("contents")) {
+    const json &contents = j.at("contents");
+    if (contents.is_object() && contents.contains("kind")) {
+      contents.get_to(value.contents);
+    } else {
+      value.contents.value = markup_text(contents);
+    }
+  }
 
   if (j.contains("range")) j.at("range").get_to(value.range);
 }
@@ -426,8 +449,10 @@ void from_json(const json &j, CompletionItem &value) {
 
   if (j.contains("detail")) j.at("detail").get_to(value.detail);
 
-  if (j.contains("documentation"))
-    j.at("documentation").get_to(value.documentation);
+  // documentation is either a plain string or MarkupContent
+  if (j.contains("documentation")) {
+    value.documentation = markup_text(j.at("documentation"));
+  }
 
   if (j.contains("sortText")) j.at("sortText").get_to(value.sortText);
 
@@ -453,13 +478,18 @@ void from_json(const json &j, CompletionList &value) {
 }
 void to_json(json &, const ParameterInformation &) {}
 void from_json(const json &j, ParameterInformation &value) {
-  if (j.contains("labelString")) j.at("labelString").get_to(value.labelString);
-
-  if (j.contains("labelOffsets"))
-    j.at("labelOffsets").get_to(value.labelOffsets);
+  if (j.contains("label")) {
+    const json &label = j.at("label");
+    if (label.is_array() && label.size() == 2) {
+      value.labelOffsets = std::make_pair(label[0].get<unsigned>(),
+                                          label[1].get<unsigned>());
+    } else if (label.is_string()) {
+      label.get_to(value.labelString);
+    }
+  }
 
   if (j.contains("documentation"))
-    j.at("documentation").get_to(value.documentation);
+    value.documentation = markup_text(j.at("documentation"));
 }
 
 void to_json(json &, const SignatureInformation &) {}
@@ -467,7 +497,7 @@ void from_json(const json &j, SignatureInformation &value) {
   if (j.contains("label")) j.at("label").get_to(value.label);
 
   if (j.contains("documentation"))
-    j.at("documentation").get_to(value.documentation);
+    value.documentation = markup_text(j.at("documentation"));
 
   if (j.contains("parameters")) j.at("parameters").get_to(value.parameters);
 }
@@ -476,6 +506,9 @@ void to_json(json &, const SignatureHelp &) {}
 void from_json(const json &j, SignatureHelp &value) {
   if (j.contains("signatures")) j.at("signatures").get_to(value.signatures);
 
+  if (j.contains("activeSignature"))
+    j.at("activeSignature").get_to(value.activeSignature);
+
   if (j.contains("activeParameter"))
     j.at("activeParameter").get_to(value.activeParameter);
 
@@ -0,0 +1,144 @@
+#include "build_output.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <cstring>
+
+namespace build_output {
+
+namespace {
+
+// a line without a line break is not waited for forever
+const int MAX_LINE_BYTES = 64 * 1024;
+
+struct Marker {
+  const char *text;
+  Severity severity;
+};
+
+const Marker MARKERS[] = {{": fatal error: ", Severity::Error},
+                          {": error: ", Severity::Error},
+                          {": warning: ", Severity::Warning},
+                          {": note: ", Severity::Note}};
+
+// Tools forced to color their output still give readable lines
+QString withoutEscapes(const QString &line) {
+  QString result;
+  result.reserve(line.size());
+  for (int i = 0; i < line.size(); ++i) {
+    if (line[i] != QChar(0x1b)) {
+      result += line[i];
+      continue;
+    }
+    // ESC [ parameters final
+    if (i + 1 < line.size() && line[i + 1] == '[') {
+      i += 2;
+      while (i < line.size() && (line[i] < QChar(0x40) || line[i] > '~')) {
+        ++i;
+      }
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+Parser::Parser(const QString &directory) : directory_(directory) {}
+
+void Parser::feed(const QByteArray &data, QStringList *lines,
+                  std::vector<Diagnostic> *diagnostics) {
+  partial_ += data;
+  const char *begin = partial_.constData();
+  const char *end = begin + partial_.size();
+  const char *line = begin;
+  for (;;) {
+    const char *newline = static_cast<const char *>(
+        std::memchr(line, '\n', end - line));
+    if (newline == nullptr) break;
+    takeLine(line, newline, lines, diagnostics);
+    line = newline + 1;
+  }
+  if (end - line > MAX_LINE_BYTES) {
+    takeLine(line, end, lines, diagnostics);
+    line = end;
+  }
+  partial_.remove(0, static_cast<int>(line - begin));
+}
+
+void Parser::finish(QStringList *lines, std::vector<Diagnostic> *diagnostics) {
+  if (partial_.isEmpty()) return;
+  takeLine(partial_.constData(), partial_.constData() + partial_.size(),
+           lines, diagnostics);
+  partial_.clear();
+}
+
+void Parser::takeLine(const char *begin, const char *end, QStringList *lines,
+                      std::vector<Diagnostic> *diagnostics) {
+  if (end > begin && end[-1] == '\r') --end;
+  QString line = QString::fromLocal8Bit(begin, static_cast<int>(end - begin));
+  if (line.contains(QChar(0x1b))) line = withoutEscapes(line);
+  Diagnostic diagnostic;
+  if (parseLine(line, &diagnostic)) {
+    diagnostics->push_back(std::move(diagnostic));
+  }
+  lines->append(line);
+}
+
+bool Parser::parseLine(const QString &line, Diagnostic *diagnostic) {
+  // make[1]: Entering directory '/path'
+  const QString ENTERING = "Entering directory ";
+  int entering = line.indexOf(ENTERING);
+  if (entering >= 0 && line.startsWith("make")) {
+    // the name is quoted
+    QString directory = line.mid(entering + ENTERING.size());
+    if (directory.size() >= 2) {
+      directory_ = directory.mid(1, directory.size() - 2);
+    }
+    return false;
+  }
+
+  int position = -1;
+  const Marker *found = nullptr;
+  for (const Marker &marker : MARKERS) {
+    int at = line.indexOf(QLatin1String(marker.text));
+    if (at > 0 && (position < 0 || at < position)) {
+      position = at;
+      found = &marker;
+    }
+  }
+  if (found == nullptr) return false;
+
+  // file:line:column or file:line
+  QString location = line.left(position);
+  int last_colon = location.lastIndexOf(':');
+  if (last_colon <= 0) return false;
+  bool ok = false;
+  int last = location.mid(last_colon + 1).toInt(&ok);
+  if (!ok) return false;
+  int file_end = last_colon;
+  int line_number = last;
+  int column = 1;
+  int colon = location.lastIndexOf(':', last_colon - 1);
+  if (colon > 0) {
+    int number = location.mid(colon + 1, last_colon - colon - 1).toInt(&ok);
+    if (ok) {
+      file_end = colon;
+      line_number = number;
+      column = last;
+    }
+  }
+  QString file = location.left(file_end).trimmed();
+  if (file.isEmpty()) return false;
+
+  diagnostic->file = QDir::cleanPath(
+      QFileInfo(file).isAbsolute() ? file
+                                   : QDir(directory_).absoluteFilePath(file));
+  diagnostic->line = qMax(0, line_number - 1);
+  diagnostic->column = qMax(0, column - 1);
+  diagnostic->severity = found->severity;
+  diagnostic->message =
+      line.mid(position + static_cast<int>(std::strlen(found->text)));
+  return true;
+}
+
+}  // namespace build_output
@@ -0,0 +1,138 @@
+#include "build_panel.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QSplitter>
+#include <QStyle>
+#include <QVBoxLayout>
+
+namespace {
+
+const int PATH_ROLE = Qt::UserRole + 1;
+const int LINE_ROLE = Qt::UserRole + 2;
+const int COLUMN_ROLE = Qt::UserRole + 3;
+const int MAX_LOG_LINES = 10000;
+
+}  // namespace
+
+BuildPanel::BuildPanel(QWidget *parent)
+    : QWidget(parent),
+      runner_(new BuildRunner(this)),
+      log_(new QPlainTextEdit),
+      problems_(new QListWidget),
+      status_(new QLabel) {
+  log_->setReadOnly(true);
+  log_->setUndoRedoEnabled(false);
+  log_->setLineWrapMode(QPlainTextEdit::NoWrap);
+  log_->setMaximumBlockCount(MAX_LOG_LINES);
+  QFont font("Monospace");
+  font.setStyleHint(QFont::TypeWriter);
+  log_->setFont(font);
+  problems_->setUniformItemSizes(true);
+
+  QSplitter *splitter = new QSplitter;
+  splitter->addWidget(problems_);
+  splitter->addWidget(log_);
+  QVBoxLayout *layout = new QVBoxLayout(this);
+  layout->setContentsMargins(0, 0, 0, 0);
+  layout->addWidget(splitter);
+  layout->addWidget(status_);
+
+  connect(runner_, &BuildRunner::output, this, &BuildPanel::addOutput);
+  connect(runner_, &BuildRunner::finished, this, &BuildPanel::buildFinished);
+  connect(problems_, &QListWidget::itemActivated, this, &BuildPanel::choose);
+}
+
+void BuildPanel::build(const QString &command, const QString &directory) {
+  log_->clear();
+  problems_->clear();
+  by_file_.clear();
+  errors_ = 0;
+  warnings_ = 0;
+  emit diagnosticsChanged();
+  log_->appendPlainText(QString("$ cd %1 && %2")
+                            .arg(QDir::toNativeSeparators(directory), command));
+  runner_->start(command, directory);
+  showStatus(tr("Building..."));
+}
+
+void BuildPanel::stop() {
+  if (!runner_->isRunning()) return;
+  runner_->stop();
+  showStatus(tr("Stopped"));
+}
+
+bool BuildPanel::isRunning() const { return runner_->isRunning(); }
+
+QStringList BuildPanel::files() const { return by_file_.keys(); }
+
+std::vector<build_output::Diagnostic> BuildPanel::diagnosticsOf(
+    const QString &fileName) const {
+  return by_file_.value(fileName);
+}
+
+void BuildPanel::goToProblem(int step) {
+  int count = problems_->count();
+  if (count == 0) return;
+  int row = problems_->currentRow();
+  row = row < 0 ? (step > 0 ? 0 : count - 1) : (row + step + count) % count;
+  problems_->setCurrentRow(row);
+  choose(problems_->item(row));
+}
+
+void BuildPanel::addOutput(
+    const QStringList &lines,
+    const std::vector<build_output::Diagnostic> &diagnostics) {
+  // one layout of the log per batch
+  log_->appendPlainText(lines.join('\n'));
+
+  for (const build_output::Diagnostic &diagnostic : diagnostics) {
+    QStyle::StandardPixmap icon = QStyle::SP_MessageBoxInformation;
+    if (diagnostic.severity == build_output::Severity::Error) {
+      icon = QStyle::SP_MessageBoxCritical;
+      ++errors_;
+    } else if (diagnostic.severity == build_output::Severity::Warning) {
+      icon = QStyle::SP_MessageBoxWarning;
+      ++warnings_;
+    }
+    QListWidgetItem *item = new QListWidgetItem(
+        style()->standardIcon(icon),
+        QString("%1:%2: %3")
+            .arg(QFileInfo(diagnostic.file).fileName())
+            .arg(diagnostic.line + 1)
+            .arg(diagnostic.message),
+        problems_);
+    item->setToolTip(diagnostic.file);
+    item->setData(PATH_ROLE, diagnostic.file);
+    item->setData(LINE_ROLE, diagnostic.line);
+    item->setData(COLUMN_ROLE, diagnostic.column);
+    by_file_[diagnostic.file].push_back(diagnostic);
+  }
+  if (!diagnostics.empty()) {
+    showStatus(tr("Building..."));
+    emit diagnosticsChanged();
+  }
+}
+
+void BuildPanel::buildFinished(int exitCode, bool crashed) {
+  if (crashed) {
+    showStatus(tr("Build failed to run"));
+  } else if (exitCode == 0) {
+    showStatus(tr("Build succeeded"));
+  } else {
+    showStatus(tr("Build failed with code %1").arg(exitCode));
+  }
+}
+
+void BuildPanel::choose(QListWidgetItem *item) {
+  emit locationChosen(item->data(PATH_ROLE).toString(),
+                      item->data(LINE_ROLE).toInt(),
+                      item->data(COLUMN_ROLE).toInt());
+}
+
+void BuildPanel::showStatus(const QString &state) {
+  status_->setText(tr("%1, %2 errors, %3 warnings")
+                       .arg(state)
+                       .arg(errors_)
+                       .arg(warnings_));
+}
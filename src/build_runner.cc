@@ -0,0 +1,105 @@
+#include "build_runner.h"
+
+#include <signal.h>
+#include <unistd.h>
+
+#include <QElapsedTimer>
+
+namespace {
+
+const int FLUSH_MS = 50;
+const int FLUSH_BUDGET_MS = 8;
+const qint64 READ_CHUNK_BYTES = 64 * 1024;
+
+// Leads a process group of its own, so stopping the build also stops the
+// compilers make started
+class GroupProcess : public QProcess {
+ public:
+  using QProcess::QProcess;
+
+ protected:
+  void setupChildProcess() override { ::setpgid(0, 0); }
+};
+
+}  // namespace
+
+BuildRunner::BuildRunner(QObject *parent) : QObject(parent) {
+  flush_timer_.setSingleShot(true);
+  flush_timer_.setInterval(FLUSH_MS);
+  connect(&flush_timer_, &QTimer::timeout, this, &BuildRunner::flush);
+}
+
+BuildRunner::~BuildRunner() { stop(); }
+
+void BuildRunner::start(const QString &command, const QString &directory) {
+  stop();
+  exited_ = false;
+  parser_ = std::make_unique<build_output::Parser>(directory);
+  process_ = new GroupProcess(this);
+  process_->setWorkingDirectory(directory);
+  // stdout and stderr in the order they were written
+  process_->setProcessChannelMode(QProcess::MergedChannels);
+  connect(process_, &QProcess::readyReadStandardOutput, this, [this]() {
+    if (!flush_timer_.isActive()) flush_timer_.start();
+  });
+  connect(process_,
+          QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this,
+          &BuildRunner::processFinished);
+  connect(process_, &QProcess::errorOccurred, this,
+          [this](QProcess::ProcessError error) {
+            if (error == QProcess::FailedToStart) {
+              processFinished(-1, QProcess::CrashExit);
+            }
+          });
+  process_->start("/bin/sh", {"-c", command});
+}
+
+void BuildRunner::stop() {
+  if (process_ == nullptr) return;
+  QProcess *process = process_;
+  process_ = nullptr;
+  flush_timer_.stop();
+  process->disconnect(this);
+  if (process->state() != QProcess::NotRunning) {
+    ::kill(-static_cast<pid_t>(process->processId()), SIGKILL);
+    process->waitForFinished();
+  }
+  process->deleteLater();
+  parser_.reset();
+}
+
+bool BuildRunner::isRunning() const { return process_ != nullptr; }
+
+void BuildRunner::flush() {
+  if (process_ == nullptr) return;
+  QStringList lines;
+  std::vector<build_output::Diagnostic> diagnostics;
+  QElapsedTimer clock;
+  clock.start();
+  while (process_->bytesAvailable() > 0 &&
+         clock.elapsed() < FLUSH_BUDGET_MS) {
+    parser_->feed(process_->read(READ_CHUNK_BYTES), &lines, &diagnostics);
+  }
+  // the rest waits for the next batch, also once the build is over
+  bool done = exited_ && process_->bytesAvailable() == 0;
+  if (done) {
+    parser_->finish(&lines, &diagnostics);
+  } else if (process_->bytesAvailable() > 0) {
+    flush_timer_.start();
+  }
+  if (!lines.isEmpty()) emit output(lines, diagnostics);
+  if (!done) return;
+
+  process_->deleteLater();
+  process_ = nullptr;
+  parser_.reset();
+  emit finished(exit_code_, crashed_);
+}
+
+void BuildRunner::processFinished(int exitCode, QProcess::ExitStatus status) {
+  if (process_ == nullptr || exited_) return;
+  exited_ = true;
+  exit_code_ = exitCode;
+  crashed_ = status == QProcess::CrashExit;
+  flush_timer_.start();
+}
@@ -0,0 +1,109 @@
+#include "completion_model.h"
+
+#include <utility>
+
+namespace {
+
+QString kindName(lsp::CompletionItemKind kind) {
+  switch (kind) {
+    case lsp::CompletionItemKind::Method:
+    case lsp::CompletionItemKind::Function:
+    case lsp::CompletionItemKind::Constructor:
+      return "fn";
+    case lsp::CompletionItemKind::Field:
+    case lsp::CompletionItemKind::Variable:
+    case lsp::CompletionItemKind::Property:
+      return "var";
+    case lsp::CompletionItemKind::Class:
+    case lsp::CompletionItemKind::Struct:
+    case lsp::CompletionItemKind::Interface:
+      return "type";
+    case lsp::CompletionItemKind::Enum:
+    case lsp::CompletionItemKind::EnumMember:
+    case lsp::CompletionItemKind::Constant:
+      return "enum";
+    case lsp::CompletionItemKind::Module:
+      return "ns";
+    case lsp::CompletionItemKind::Keyword:
+      return "kw";
+    case lsp::CompletionItemKind::TypeParameter:
+      return "tpl";
+    default:
+      return "";
+  }
+}
+
+}  // namespace
+
+CompletionModel::CompletionModel(QObject *parent)
+    : QAbstractListModel(parent) {}
+
+int CompletionModel::rowCount(const QModelIndex &parent) const {
+  if (parent.isValid()) return 0;
+  return static_cast<int>(rows_.size());
+}
+
+QVariant CompletionModel::data(const QModelIndex &index, int role) const {
+  if (!index.isValid() || index.row() >= rowCount()) return {};
+  const Row &row = rows_[index.row()];
+
+  switch (role) {
+    case Qt::DisplayRole:
+      return row.display;
+    case Qt::EditRole:  // matched against the prefix and inserted by QCompleter
+      return QString::fromStdString(row.item.insertText);
+    case Qt::ToolTipRole: {
+      QString tip = QString::fromStdString(row.item.detail);
+      if (!row.item.documentation.empty()) {
+        tip += "\n\n" + QString::fromStdString(row.item.documentation);
+      }
+      return tip;
+    }
+    case KindRole:
+      return static_cast<int>(row.item.kind);
+    case DetailRole:
+      return QString::fromStdString(row.item.detail);
+    case DocumentationRole:
+      return QString::fromStdString(row.item.documentation);
+    case ResolvedRole:
+      return row.resolved;
+    default:
+      return {};
+  }
+}
+
+void CompletionModel::setItems(std::vector<lsp::CompletionItem> items) {
+  beginResetModel();
+  rows_.clear();
+  rows_.reserve(items.size());
+  for (auto &item : items) {
+    Row row;
+    QString kind = kindName(item.kind);
+    row.display = QString::fromStdString(item.label).trimmed();
+    if (!item.detail.empty()) {
+      row.display += "  " + QString::fromStdString(item.detail);
+    }
+    if (!kind.isEmpty()) {
+      row.display = QString("[%1] %2").arg(kind, row.display);
+    }
+    row.item = std::move(item);
+    rows_.push_back(std::move(row));
+  }
+  endResetModel();
+}
+
+void CompletionModel::setResolved(std::size_t row,
+                                  const lsp::CompletionItem &item) {
+  if (row >= rows_.size()) return;
+  // only the lazily provided fields are taken, the rest was normalized by the
+  // handler and must stay as is
+  rows_[row].item.documentation = item.documentation;
+  if (!item.detail.empty()) rows_[row].item.detail = item.detail;
+  rows_[row].resolved = true;
+  QModelIndex changed = index(static_cast<int>(row));
+  emit dataChanged(changed, changed);
+}
+
+bool CompletionModel::isResolved(std::size_t row) const {
+  return row < rows_.size() && rows_[row].resolved;
+}
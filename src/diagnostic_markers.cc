@@ -0,0 +1,81 @@
+#include "diagnostic_markers.h"
+
+#include <QTextBlock>
+#include <algorithm>
+
+DiagnosticMarkers::DiagnosticMarkers(QTextDocument *document, QObject *parent)
+    : QObject(parent), document_(document), revision_(document->revision()) {
+  connect(document, &QTextDocument::contentsChange, this,
+          &DiagnosticMarkers::contentsChange);
+}
+
+QTextDocument *DiagnosticMarkers::document() const { return document_; }
+
+void DiagnosticMarkers::setDiagnostics(
+    const std::vector<lsp::DiagnosticsResponse> &diagnostics) {
+  markers_.clear();
+  longest_ = 0;
+  if (!document_) return;
+  for (const lsp::DiagnosticsResponse &diagnostic : diagnostics) {
+    QTextBlock first =
+        document_->findBlockByNumber(diagnostic.range.start.line);
+    QTextBlock last = document_->findBlockByNumber(diagnostic.range.end.line);
+    // the text moved on since the server looked at it
+    if (!first.isValid()) continue;
+    if (!last.isValid()) last = document_->lastBlock();
+    int start = first.position() +
+                std::min<int>(diagnostic.range.start.character,
+                              first.length() - 1);
+    int end = last.position() + std::min<int>(diagnostic.range.end.character,
+                                              last.length() - 1);
+    end = std::max(end, start);
+    markers_.push_back({start, end, diagnostic.severity});
+    longest_ = std::max(longest_, end - start);
+  }
+  std::sort(markers_.begin(), markers_.end(),
+            [](const Marker &a, const Marker &b) { return a.start < b.start; });
+  emit markersChanged();
+}
+
+void DiagnosticMarkers::markersIn(int from, int to,
+                                  std::vector<Marker> *markers) const {
+  auto it = std::lower_bound(
+      markers_.begin(), markers_.end(), from - longest_,
+      [](const Marker &marker, int position) {
+        return marker.start < position;
+      });
+  for (; it != markers_.end() && it->start < to; ++it) {
+    // empty ranges mark the character at their start
+    if (std::max(it->end, it->start + 1) > from) markers->push_back(*it);
+  }
+}
+
+void DiagnosticMarkers::contentsChange(int position, int removed, int added) {
+  // format changes of the highlighter leave the revision alone
+  int revision = document_->revision();
+  if (revision == revision_) return;
+  revision_ = revision;
+  if (markers_.empty()) return;
+
+  // positions in the removed text move to its start, the mapping keeps the
+  // markers sorted
+  int removed_end = position + removed;
+  auto map = [&](int point) {
+    if (point < position) return point;
+    if (point < removed_end) return position;
+    return point - removed + added;
+  };
+  auto it = std::lower_bound(
+      markers_.begin(), markers_.end(), position - longest_,
+      [](const Marker &marker, int point) { return marker.start < point; });
+  for (; it != markers_.end(); ++it) {
+    it->start = map(it->start);
+    it->end = map(it->end);
+  }
+  // markers in the removed text shrink, the bound has to follow them down
+  longest_ = 0;
+  for (const Marker &marker : markers_) {
+    longest_ = std::max(longest_, marker.end - marker.start);
+  }
+  // the editor repaints the edited text anyway, the marks go with it
+}
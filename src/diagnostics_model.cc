@@ -0,0 +1,233 @@
+#include "diagnostics_model.h"
+
+#include <QApplication>
+#include <QFileInfo>
+#include <QStyle>
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// internal id of the rows of files, the rows of entries have the id of their
+// file
+const quintptr FILE_ID = 0;
+
+}  // namespace
+
+bool DiagnosticsModel::Entry::operator==(const Entry &other) const {
+  return line == other.line && column == other.column &&
+         severity == other.severity && message == other.message &&
+         category == other.category;
+}
+
+bool DiagnosticsModel::Entry::sameAs(const Entry &other) const {
+  return severity == other.severity && message == other.message &&
+         category == other.category;
+}
+
+DiagnosticsModel::DiagnosticsModel(QObject *parent)
+    : QAbstractItemModel(parent),
+      error_icon_(
+          QApplication::style()->standardIcon(QStyle::SP_MessageBoxCritical)),
+      warning_icon_(
+          QApplication::style()->standardIcon(QStyle::SP_MessageBoxWarning)),
+      information_icon_(QApplication::style()->standardIcon(
+          QStyle::SP_MessageBoxInformation)) {}
+
+QModelIndex DiagnosticsModel::index(int row, int column,
+                                    const QModelIndex &parent) const {
+  if (!hasIndex(row, column, parent)) return {};
+  if (!parent.isValid()) return createIndex(row, column, FILE_ID);
+  return createIndex(row, column, files_[parent.row()].id);
+}
+
+QModelIndex DiagnosticsModel::parent(const QModelIndex &index) const {
+  if (!index.isValid() || index.internalId() == FILE_ID) return {};
+  return createIndex(rowOf(index.internalId()), 0, FILE_ID);
+}
+
+int DiagnosticsModel::rowCount(const QModelIndex &parent) const {
+  if (!parent.isValid()) return static_cast<int>(files_.size());
+  if (parent.internalId() != FILE_ID || parent.column() != 0) return 0;
+  return static_cast<int>(files_[parent.row()].entries.size());
+}
+
+int DiagnosticsModel::columnCount(const QModelIndex &) const { return 1; }
+
+QVariant DiagnosticsModel::data(const QModelIndex &index, int role) const {
+  if (!index.isValid()) return {};
+  if (index.internalId() == FILE_ID) {
+    const File &file = files_[index.row()];
+    switch (role) {
+      case Qt::DisplayRole:
+        if (!file.source.isEmpty()) {
+          return tr("%1 (%2, %3 errors, %4 warnings)")
+              .arg(QFileInfo(file.path).fileName(), file.source)
+              .arg(file.errors)
+              .arg(file.warnings);
+        }
+        return tr("%1 (%2 errors, %3 warnings)")
+            .arg(QFileInfo(file.path).fileName())
+            .arg(file.errors)
+            .arg(file.warnings);
+      case Qt::ToolTipRole:
+      case PathRole:
+        return file.path;
+      case KeyRole:
+        return file.key;
+      default:
+        return {};
+    }
+  }
+
+  const File &file = files_[rowOf(index.internalId())];
+  const Entry &entry = file.entries[index.row()];
+  switch (role) {
+    case Qt::DisplayRole:
+      return QString("%1:%2: %3")
+          .arg(entry.line + 1)
+          .arg(entry.column + 1)
+          .arg(entry.message);
+    case Qt::ToolTipRole:
+      return entry.category.isEmpty()
+                 ? entry.message
+                 : entry.category + "\n" + entry.message;
+    case Qt::DecorationRole:
+      switch (entry.severity) {
+        case lsp::DiagnosticSeverity::Error:
+          return error_icon_;
+        case lsp::DiagnosticSeverity::Warning:
+          return warning_icon_;
+        default:
+          return information_icon_;
+      }
+    case PathRole:
+      return file.path;
+    case KeyRole:
+      return file.key;
+    case LineRole:
+      return entry.line;
+    case ColumnRole:
+      return entry.column;
+    default:
+      return {};
+  }
+}
+
+void DiagnosticsModel::setDiagnostics(
+    const QString &key, const QString &path,
+    const std::vector<lsp::DiagnosticsResponse> &diagnostics,
+    const QString &source) {
+  if (diagnostics.empty()) {
+    removeFile(key);
+    return;
+  }
+  std::vector<Entry> entries;
+  entries.reserve(diagnostics.size());
+  for (const lsp::DiagnosticsResponse &diagnostic : diagnostics) {
+    entries.push_back({static_cast<int>(diagnostic.range.start.line),
+                       static_cast<int>(diagnostic.range.start.character),
+                       diagnostic.severity,
+                       QString::fromStdString(diagnostic.message),
+                       QString::fromStdString(diagnostic.category)});
+  }
+
+  int row = rowOf(key);
+  if (row < 0) {
+    row = static_cast<int>(files_.size());
+    beginInsertRows(QModelIndex(), row, row);
+    files_.push_back({next_id_++, key, path, source, std::move(entries)});
+    count(&files_.back());
+    endInsertRows();
+    return;
+  }
+
+  File &file = files_[row];
+  file.path = path;
+  file.source = source;
+  std::vector<Entry> &old = file.entries;
+  QModelIndex parent = index(row, 0);
+  // only the rows between the common head and tail change, a line inserted
+  // above a diagnostic moves it without making it another one
+  std::size_t head = 0;
+  std::size_t common = std::min(old.size(), entries.size());
+  while (head < common && old[head].sameAs(entries[head])) ++head;
+  std::size_t tail = 0;
+  while (tail < common - head && old[old.size() - 1 - tail].sameAs(
+                                     entries[entries.size() - 1 - tail])) {
+    ++tail;
+  }
+  // the positions of the kept rows are updated before rows move, one signal
+  // covers the moved rows of the head and one those of the tail
+  auto update = [&](std::size_t old_first, std::size_t new_first,
+                    std::size_t length) {
+    int changed_first = -1;
+    int changed_last = -1;
+    for (std::size_t i = 0; i < length; ++i) {
+      if (old[old_first + i] == entries[new_first + i]) continue;
+      old[old_first + i] = entries[new_first + i];
+      if (changed_first < 0) changed_first = static_cast<int>(old_first + i);
+      changed_last = static_cast<int>(old_first + i);
+    }
+    if (changed_first < 0) return;
+    emit dataChanged(index(changed_first, 0, parent),
+                     index(changed_last, 0, parent));
+  };
+  update(0, 0, head);
+  update(old.size() - tail, entries.size() - tail, tail);
+  int first = static_cast<int>(head);
+  int old_last = static_cast<int>(old.size() - tail) - 1;
+  int new_last = static_cast<int>(entries.size() - tail) - 1;
+
+  if (old_last == new_last) {
+    if (first <= old_last) {
+      std::move(entries.begin() + first, entries.begin() + new_last + 1,
+                old.begin() + first);
+      emit dataChanged(index(first, 0, parent), index(old_last, 0, parent));
+    }
+  } else {
+    if (first <= old_last) {
+      beginRemoveRows(parent, first, old_last);
+      old.erase(old.begin() + first, old.begin() + old_last + 1);
+      endRemoveRows();
+    }
+    if (first <= new_last) {
+      beginInsertRows(parent, first, new_last);
+      old.insert(old.begin() + first,
+                 std::make_move_iterator(entries.begin() + first),
+                 std::make_move_iterator(entries.begin() + new_last + 1));
+      endInsertRows();
+    }
+  }
+  count(&file);
+  emit dataChanged(parent, parent);
+}
+
+void DiagnosticsModel::removeFile(const QString &key) {
+  int row = rowOf(key);
+  if (row < 0) return;
+  beginRemoveRows(QModelIndex(), row, row);
+  files_.erase(files_.begin() + row);
+  endRemoveRows();
+}
+
+int DiagnosticsModel::rowOf(const QString &key) const {
+  auto found = std::find_if(files_.begin(), files_.end(),
+                            [&](const File &f) { return f.key == key; });
+  return found == files_.end() ? -1 : static_cast<int>(found - files_.begin());
+}
+
+int DiagnosticsModel::rowOf(quintptr id) const {
+  auto found = std::find_if(files_.begin(), files_.end(),
+                            [id](const File &f) { return f.id == id; });
+  return static_cast<int>(found - files_.begin());
+}
+
+void DiagnosticsModel::count(File *file) {
+  file->errors = 0;
+  file->warnings = 0;
+  for (const Entry &entry : file->entries) {
+    if (entry.severity == lsp::DiagnosticSeverity::Error) ++file->errors;
+    if (entry.severity == lsp::DiagnosticSeverity::Warning) ++file->warnings;
+  }
+}
@@ -3,6 +3,7 @@
 #include <stdlib.h>
 
 #include <QCommandLineParser>
+#include <QDir>
 #include <QScreen>
 #include <QScroller>
 #include <QTextStream>
@@ -12,8 +13,10 @@
 #include <string>
 
 #include "mainwindow.h"
+#include "startup_trace.h"
 Directory_tree::Directory_tree(QWidget *parent)
     : QWidget(parent), ui(new Ui::Directory_tree) {
+  startup_trace::Phase phase("directory tree");
   ui->setupUi(this);
   std::string user_name = getenv("USER");
   const std::string CONFIG_FILE_NAME = ".batonrc";
@@ -25,36 +28,28 @@ Directory_tree::Directory_tree(QWidget *parent)
     root = in.readLine();
     file.close();
   }
+  tree.setModel(&model);
   if (root.size() > 0) {
-    model.setRootPath(root);
-    tree.setModel(&model);
-    root = root + "/";
-    QModelIndex rootIndex = model.index(root);
-    tree.setRootIndex(rootIndex);
+    model.setRootPath(QDir::cleanPath(root));
   } else {
-    std::string root_path = "/home/" + user_name + "/";
-    model.setRootPath(QString::fromStdString(root_path));
-    tree.setModel(&model);
-    QModelIndex rootIndex = model.index(QString::fromStdString(root_path));
-    tree.setRootIndex(rootIndex);
+    model.setRootPath(QString::fromStdString("/home/" + user_name));
   }
   tree.setAnimated(true);
   const int DEFAULT_INDENT = 20;
   tree.setIndentation(DEFAULT_INDENT);
-  tree.setSortingEnabled(true);
-  const int MAX_COLUMN = 3;
-  for (int i = 1; i <= MAX_COLUMN; ++i) {
-    tree.setColumnHidden(i, true);
-  }
+  // lets the view lay out only the rows on screen, the model comes sorted
+  tree.setUniformRowHeights(true);
   // Make it flickable on touchscreens
   QScroller::grabGesture(&tree, QScroller::TouchGesture);
-  ui->treeView->setModel(&model);
 }
 
 void Directory_tree::set_root_path() {
-  model.setRootPath(dir_name);
-  tree.setModel(&model);
-  QModelIndex rootIndex = model.index(dir_name);
-  tree.setRootIndex(rootIndex);
+  // the directory dialog was cancelled
+  if (dir_name.isEmpty()) return;
+  root = dir_name;
+  model.setRootPath(QDir::cleanPath(dir_name));
 }
+
+QString Directory_tree::root_path() const { return root; }
+
 Directory_tree::~Directory_tree() { delete ui; }
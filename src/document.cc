@@ -0,0 +1,196 @@
+#include "document.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QPlainTextDocumentLayout>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <algorithm>
+#include <iterator>
+
+#include "startup_trace.h"
+
+namespace {
+
+// clangd is only fed with C and C++ sources
+bool isCpp(const QString &fileName) {
+  static const QString good_suf[] = {"h", "c", "cpp", "hpp", "cc"};
+  QString suffix = QFileInfo(fileName).suffix();
+  return std::any_of(std::begin(good_suf), std::end(good_suf),
+                     [&suffix](const QString &str) { return suffix == str; });
+}
+
+std::string serverPath(const QString &fileName) {
+  if (fileName.isEmpty()) {
+    return QDir::current().absoluteFilePath("untitled.cpp").toStdString();
+  }
+  return QFileInfo(fileName).absoluteFilePath().toStdString();
+}
+
+}  // namespace
+
+Document::Document(const QString &fileName, QObject *parent)
+    : QObject(parent),
+      text_(new QTextDocument(this)),
+      file_view_(new FileView(serverPath(fileName))),
+      file_name_(fileName) {
+  // QPlainTextEdit only accepts documents with the plain text layout
+  text_->setDocumentLayout(new QPlainTextDocumentLayout(text_));
+  // the highlighter reacts to an edit by reporting its format changes from
+  // within the same signal, the journal and the markers have to see the edit
+  // first
+  connect(text_, &QTextDocument::contentsChange, this,
+          &Document::recordChange);
+  markers_ = new DiagnosticMarkers(text_, this);
+  build_markers_ = new DiagnosticMarkers(text_, this);
+  qint64 start = startup_trace::Now();
+  highlighter_ = new Highlighter(text_);
+  startup_trace::Record("highlighter", start);
+  file_view_->SetValidity(fileName.isEmpty() || isCpp(fileName));
+  connect(text_, &QTextDocument::contentsChanged, this,
+          &Document::contentsChanged);
+  connect(file_view_, &FileView::DoneDiagnostic, this,
+          &Document::diagnosticsChanged);
+}
+
+Document::~Document() { delete file_view_; }
+
+QTextDocument *Document::textDocument() const { return text_; }
+
+FileView *Document::fileView() const { return file_view_; }
+
+const QString &Document::fileName() const { return file_name_; }
+
+void Document::setFileName(const QString &fileName) {
+  bool was_valid = file_name_.isEmpty() || isCpp(file_name_);
+  bool valid = fileName.isEmpty() || isCpp(fileName);
+  bool moved = serverPath(fileName) != serverPath(file_name_);
+  file_name_ = fileName;
+  if (!moved && valid == was_valid) return;
+  file_view_->Rename(serverPath(fileName),
+                     text_->toPlainText().toUtf8().toStdString(), valid);
+}
+
+quint64 Document::revision() const { return revision_; }
+
+void Document::textLoaded() {
+  file_view_->UploadContent(text_->toPlainText().toUtf8().toStdString());
+  journal_.reset(file_name_, text_->characterCount() - 1);
+  loaded_ = true;
+  text_revision_ = text_->revision();
+}
+
+void Document::saved(quint64 revision, int length, const QByteArray &digest) {
+  disk_digest_ = digest;
+  journal_.reset(file_name_, length);
+  if (revision == revision_) {
+    text_->setModified(false);
+  } else {
+    // edits made while the file was written are still unsaved
+    journal_.compact(text_->toPlainText());
+  }
+  file_view_->NotifySaved();
+}
+
+bool Document::recover(const EditJournal::Recovery &recovery) {
+  if (text_->characterCount() - 1 != recovery.base_length) return false;
+  QTextCursor cursor(text_);
+  cursor.beginEditBlock();
+  for (const EditJournal::Edit &edit : recovery.edits) {
+    int length = text_->characterCount() - 1;
+    if (edit.position > length) break;
+    cursor.setPosition(edit.position);
+    cursor.setPosition(std::min(edit.position + edit.removed, length),
+                       QTextCursor::KeepAnchor);
+    cursor.insertText(edit.added);
+  }
+  cursor.endEditBlock();
+  return true;
+}
+
+const text_format::Format &Document::format() const { return format_; }
+
+void Document::setFormat(const text_format::Format &format) {
+  format_ = format;
+}
+
+const QByteArray &Document::diskDigest() const { return disk_digest_; }
+
+void Document::setDiskDigest(const QByteArray &digest) {
+  disk_digest_ = digest;
+}
+
+void Document::applyDiskChange(const std::vector<text_diff::Edit> &edits,
+                               const QByteArray &digest) {
+  disk_digest_ = digest;
+  applying_disk_change_ = true;
+  QTextCursor cursor(text_);
+  cursor.beginEditBlock();
+  // from the end, so the text before each edit is still the one the
+  // positions refer to, for the document and for the server alike. The edit
+  // block reports a single change covering every edit, the server gets the
+  // edits themselves.
+  for (auto it = edits.rbegin(); it != edits.rend(); ++it) {
+    cursor.setPosition(it->position);
+    cursor.setPosition(it->position + it->removed, QTextCursor::KeepAnchor);
+    cursor.insertText(it->added);
+    if (loaded_) uploadChange(it->position, it->removed, it->added);
+  }
+  cursor.endEditBlock();
+  applying_disk_change_ = false;
+  text_->setModified(false);
+  if (loaded_) journal_.reset(file_name_, text_->characterCount() - 1);
+}
+
+DiagnosticMarkers *Document::markers() const { return markers_; }
+
+DiagnosticMarkers *Document::buildMarkers() const { return build_markers_; }
+
+const std::vector<lsp::DiagnosticsResponse> &Document::diagnostics() const {
+  return diagnostics_;
+}
+
+void Document::contentsChanged() { ++revision_; }
+
+void Document::diagnosticsChanged(
+    const std::vector<lsp::DiagnosticsResponse> &diagnostics) {
+  diagnostics_ = diagnostics;
+  markers_->setDiagnostics(diagnostics);
+}
+
+void Document::recordChange(int position, int removed, int added) {
+  if (!loaded_) return;
+  // format changes of the highlighter come with equal counts and leave the
+  // revision alone
+  int revision = text_->revision();
+  if (removed == added && revision == text_revision_) return;
+  text_revision_ = revision;
+
+  // changes reaching the end count the final paragraph separator, which is
+  // not part of the text
+  int length = text_->characterCount() - 1;
+  int extra = std::max(0, position + added - length);
+  added -= extra;
+  removed = std::max(0, removed - extra);
+
+  QTextCursor cursor(text_);
+  cursor.setPosition(position);
+  cursor.setPosition(position + added, QTextCursor::KeepAnchor);
+  QString text = cursor.selectedText();
+  // QTextCursor separates selected lines with U+2029
+  text.replace(QChar::ParagraphSeparator, '\n');
+  // the server gets the change once however many panes show the document
+  if (!applying_disk_change_) uploadChange(position, removed, text);
+  journal_.append(position, removed, text);
+  if (journal_.needsCompaction(length)) journal_.compact(text_->toPlainText());
+}
+
+void Document::uploadChange(int position, int removed, const QString &added) {
+  // the text before position is the same before and after the change
+  QTextBlock block = text_->findBlock(position);
+  if (!file_view_->UploadChange(block.blockNumber(),
+                                position - block.position(), removed,
+                                added.toUtf8().toStdString())) {
+    file_view_->UploadContent(text_->toPlainText().toUtf8().toStdString());
+  }
+}
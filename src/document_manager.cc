@@ -0,0 +1,316 @@
+#include "document_manager.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <algorithm>
+#include <utility>
+
+#include "task.h"
+
+namespace {
+
+QString normalized(const QString &fileName) {
+  if (fileName.isEmpty()) return fileName;
+  return QFileInfo(fileName).absoluteFilePath();
+}
+
+// Also used on worker threads
+bool readText(const QString &fileName, QString *text,
+              text_format::Format *format, QString *error) {
+  QFile file(fileName);
+  if (!file.open(QFile::ReadOnly)) {
+    if (error != nullptr) {
+      *error = QCoreApplication::translate("DocumentManager",
+                                           "Cannot read file %1:\n%2.")
+                   .arg(QDir::toNativeSeparators(fileName),
+                        file.errorString());
+    }
+    return false;
+  }
+  QByteArray data = file.readAll();
+  *format = text_format::Detect(data);
+  *text = text_format::Decode(data, *format);
+  return true;
+}
+
+}  // namespace
+
+DocumentManager::DocumentManager(QObject *parent) : QObject(parent) {
+  const int CHANGE_DELAY_MS = 100;
+  change_timer_.setSingleShot(true);
+  change_timer_.setInterval(CHANGE_DELAY_MS);
+  connect(&change_timer_, &QTimer::timeout, this,
+          &DocumentManager::checkChanged);
+  connect(&watcher_, &QFileSystemWatcher::fileChanged, this,
+          &DocumentManager::fileChanged);
+  connect(&watcher_, &QFileSystemWatcher::directoryChanged, this,
+          &DocumentManager::directoryChanged);
+}
+
+DocumentManager::~DocumentManager() {
+  pool_.waitForDone();
+  for (Tab &tab : tabs_) delete tab.document;
+}
+
+int DocumentManager::count() const { return static_cast<int>(tabs_.size()); }
+
+int DocumentManager::indexOf(const QString &fileName) const {
+  if (fileName.isEmpty()) return -1;
+  QString path = normalized(fileName);
+  for (std::size_t i = 0; i < tabs_.size(); ++i) {
+    if (tabs_[i].file_name == path) return static_cast<int>(i);
+  }
+  return -1;
+}
+
+int DocumentManager::indexOf(const Document *document) const {
+  for (std::size_t i = 0; i < tabs_.size(); ++i) {
+    if (tabs_[i].document == document) return static_cast<int>(i);
+  }
+  return -1;
+}
+
+int DocumentManager::add(const QString &fileName) {
+  Tab tab;
+  tab.file_name = normalized(fileName);
+  // there is nothing to read for an untitled tab
+  tab.loaded = fileName.isEmpty();
+  watch(tab.file_name);
+  tabs_.push_back(std::move(tab));
+  return count() - 1;
+}
+
+void DocumentManager::remove(int index) {
+  QString fileName = tabs_[index].file_name;
+  delete tabs_[index].document;
+  tabs_.erase(tabs_.begin() + index);
+  unwatch(fileName);
+}
+
+QString DocumentManager::fileName(int index) const {
+  return tabs_[index].file_name;
+}
+
+void DocumentManager::setFileName(int index, const QString &fileName) {
+  QString previous = tabs_[index].file_name;
+  tabs_[index].file_name = normalized(fileName);
+  unwatch(previous);
+  Tab &tab = tabs_[index];
+  watch(tab.file_name);
+  if (tab.document != nullptr) tab.document->setFileName(tab.file_name);
+}
+
+bool DocumentManager::isModified(int index) const {
+  const Tab &tab = tabs_[index];
+  return tab.document != nullptr && tab.document->textDocument()->isModified();
+}
+
+Document *DocumentManager::document(int index) const {
+  return tabs_[index].document;
+}
+
+const DocumentManager::ViewState &DocumentManager::viewState(int index) const {
+  return tabs_[index].view;
+}
+
+void DocumentManager::setViewState(int index, const ViewState &state) {
+  tabs_[index].view = state;
+}
+
+Document *DocumentManager::materialize(int index, QString *error) {
+  Tab &tab = tabs_[index];
+  tab.last_used = ++clock_;
+  if (tab.document != nullptr) return tab.document;
+
+  QString text;
+  if (tab.loaded) {
+    text = QString::fromUtf8(tab.buffer);
+  } else {
+    if (!readText(tab.file_name, &text, &tab.format, error)) return nullptr;
+    tab.loaded = true;
+    tab.digest = text_diff::Digest(text);
+  }
+  tab.buffer = QByteArray();
+
+  tab.document = new Document(tab.file_name, this);
+  QTextDocument *document = tab.document->textDocument();
+  document->setPlainText(text);
+  document->setModified(false);
+  tab.document->setDiskDigest(tab.digest);
+  tab.document->setFormat(tab.format);
+  tab.document->textLoaded();
+  Document *result = tab.document;
+  emit materialized(result);
+  return result;
+}
+
+void DocumentManager::release(Tab *tab) {
+  tab->buffer = tab->document->textDocument()->toPlainText().toUtf8();
+  tab->digest = tab->document->diskDigest();
+  tab->format = tab->document->format();
+  delete tab->document;
+  tab->document = nullptr;
+  tab->reload_job = 0;
+  tab->reload_again = false;
+}
+
+void DocumentManager::releaseUnused() {
+  // every live document costs a layout, a highlighter and a clangd process
+  const int MAX_LIVE_DOCUMENTS = 8;
+  const int MAX_LIVE_CHARACTERS = 32 << 20;
+
+  for (;;) {
+    int live = 0;
+    int characters = 0;
+    Tab *oldest = nullptr;
+    for (Tab &tab : tabs_) {
+      if (tab.document == nullptr) continue;
+      QTextDocument *document = tab.document->textDocument();
+      ++live;
+      characters += document->characterCount();
+      // the most recently used tab is the one on screen
+      if (tab.last_used == clock_ || document->isModified()) continue;
+      if (oldest == nullptr || tab.last_used < oldest->last_used) {
+        oldest = &tab;
+      }
+    }
+    if (oldest == nullptr ||
+        (live <= MAX_LIVE_DOCUMENTS && characters <= MAX_LIVE_CHARACTERS)) {
+      return;
+    }
+    release(oldest);
+  }
+}
+
+void DocumentManager::reload(int index) {
+  if (tabs_[index].document != nullptr) startReload(index, true);
+}
+
+void DocumentManager::watch(const QString &fileName) {
+  if (fileName.isEmpty()) return;
+  watcher_.addPath(fileName);
+  // a file replaced by a rename or deleted and created again is no longer
+  // watched, its directory tells when it is back
+  watcher_.addPath(QFileInfo(fileName).absolutePath());
+}
+
+void DocumentManager::unwatch(const QString &fileName) {
+  if (fileName.isEmpty()) return;
+  watcher_.removePath(fileName);
+  QString directory = QFileInfo(fileName).absolutePath();
+  for (const Tab &tab : tabs_) {
+    if (!tab.file_name.isEmpty() &&
+        QFileInfo(tab.file_name).absolutePath() == directory) {
+      return;
+    }
+  }
+  watcher_.removePath(directory);
+}
+
+void DocumentManager::fileChanged(const QString &path) {
+  changed_.insert(path);
+  change_timer_.start();
+}
+
+void DocumentManager::directoryChanged(const QString &path) {
+  QStringList watched = watcher_.files();
+  for (const Tab &tab : tabs_) {
+    if (tab.file_name.isEmpty() || watched.contains(tab.file_name) ||
+        QFileInfo(tab.file_name).absolutePath() != path) {
+      continue;
+    }
+    if (QFileInfo::exists(tab.file_name)) fileChanged(tab.file_name);
+  }
+}
+
+void DocumentManager::checkChanged() {
+  QSet<QString> changed;
+  changed.swap(changed_);
+  for (const QString &path : changed) {
+    int index = indexOf(path);
+    if (index < 0) continue;
+    if (!watcher_.files().contains(path)) watcher_.addPath(path);
+    Tab &tab = tabs_[index];
+    if (tab.document == nullptr) {
+      // read again on the next activation
+      if (tab.loaded) {
+        tab.buffer = QByteArray();
+        tab.loaded = false;
+      }
+      continue;
+    }
+    startReload(index, false);
+  }
+}
+
+void DocumentManager::startReload(int index, bool force) {
+  Tab &tab = tabs_[index];
+  if (tab.reload_job != 0) {
+    tab.reload_again = true;
+    return;
+  }
+  tab.reload_job = ++next_job_;
+  int job = tab.reload_job;
+  QString fileName = tab.file_name;
+  QByteArray known = tab.document->diskDigest();
+  quint64 revision = tab.document->revision();
+  QString current = tab.document->textDocument()->toPlainText();
+  pool_.start(new Task([this, job, force, fileName, known, revision,
+                        current]() {
+    QString text;
+    text_format::Format format;
+    bool read = readText(fileName, &text, &format, nullptr);
+    QByteArray digest;
+    std::vector<text_diff::Edit> edits;
+    if (read) {
+      digest = text_diff::Digest(text);
+      if (force || digest != known) edits = text_diff::Diff(current, text);
+    }
+    QMetaObject::invokeMethod(
+        this,
+        [this, job, force, revision, read, format, digest, edits]() {
+          finishReload(job, force, revision, read, format, digest, edits);
+        },
+        Qt::QueuedConnection);
+  }));
+}
+
+void DocumentManager::finishReload(int job, bool force, quint64 revision,
+                                   bool read,
+                                   const text_format::Format &format,
+                                   const QByteArray &digest,
+                                   const std::vector<text_diff::Edit> &edits) {
+  auto it = std::find_if(tabs_.begin(), tabs_.end(), [job](const Tab &tab) {
+    return tab.reload_job == job;
+  });
+  // the tab was closed or released meanwhile
+  if (it == tabs_.end()) return;
+  int index = static_cast<int>(it - tabs_.begin());
+  Tab &tab = *it;
+  tab.reload_job = 0;
+  Document *document = tab.document;
+  // the edits are stale when the document or the file changed meanwhile
+  if (tab.reload_again || (read && document->revision() != revision)) {
+    tab.reload_again = false;
+    startReload(index, force);
+    return;
+  }
+  // a file being rewritten may be missing for a moment, its directory
+  // reports it once it is back
+  if (!read) return;
+  if (!force && digest == document->diskDigest()) {
+    // only the line endings or the encoding may have changed
+    document->setFormat(format);
+    return;
+  }
+  if (!force && document->textDocument()->isModified()) {
+    // asked once per version of the file
+    document->setDiskDigest(digest);
+    emit changedOnDisk(index);
+    return;
+  }
+  document->setFormat(format);
+  document->applyDiskChange(edits, digest);
+}
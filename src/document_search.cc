@@ -0,0 +1,205 @@
+#include "document_search.h"
+
+#include <QRegularExpressionMatchIterator>
+#include <QTextCursor>
+#include <algorithm>
+#include <utility>
+
+#include "text_search.h"
+
+namespace {
+
+bool isAscii(const QString &text) {
+  return std::all_of(text.begin(), text.end(),
+                     [](QChar ch) { return ch.unicode() < 0x80; });
+}
+
+QString expand(const QString &replacement,
+               const QRegularExpressionMatch &match) {
+  QString result;
+  for (int i = 0; i < replacement.size(); ++i) {
+    QChar ch = replacement[i];
+    if (ch == '\\' && i + 1 < replacement.size()) {
+      QChar next = replacement[++i];
+      if (next.isDigit()) {
+        result += match.captured(next.digitValue());
+      } else if (next == 'n') {
+        result += '\n';
+      } else if (next == 't') {
+        result += '\t';
+      } else {
+        result += next;
+      }
+      continue;
+    }
+    result += ch;
+  }
+  return result;
+}
+
+}  // namespace
+
+DocumentSearch::DocumentSearch(QObject *parent) : QObject(parent) {
+  // typing a word does not search the document once per letter
+  const int REFRESH_DELAY_MS = 100;
+  refresh_timer_.setSingleShot(true);
+  refresh_timer_.setInterval(REFRESH_DELAY_MS);
+  connect(&refresh_timer_, &QTimer::timeout, this, &DocumentSearch::refresh);
+}
+
+void DocumentSearch::setDocument(QTextDocument *document) {
+  if (document_ == document) return;
+  if (document_) disconnect(document_, nullptr, this, nullptr);
+  document_ = document;
+  if (document_) {
+    connect(document_, &QTextDocument::contentsChanged, this,
+            &DocumentSearch::documentChanged);
+  }
+  refresh();
+}
+
+QTextDocument *DocumentSearch::document() const { return document_; }
+
+bool DocumentSearch::setQuery(const QString &query, bool regex,
+                              bool case_sensitive, QString *error) {
+  query_ = query;
+  regex_mode_ = regex;
+  case_sensitive_ = case_sensitive;
+  regex_.setPattern(regex ? query : QRegularExpression::escape(query));
+  QRegularExpression::PatternOptions options =
+      QRegularExpression::MultilineOption;
+  if (!case_sensitive) options |= QRegularExpression::CaseInsensitiveOption;
+  regex_.setPatternOptions(options);
+
+  if (!regex_.isValid()) {
+    if (error != nullptr) *error = regex_.errorString();
+    query_.clear();
+    refresh();
+    return false;
+  }
+  refresh();
+  return true;
+}
+
+void DocumentSearch::clear() {
+  query_.clear();
+  refresh();
+}
+
+const std::vector<DocumentSearch::Match> &DocumentSearch::matches() const {
+  return matches_;
+}
+
+int DocumentSearch::nextMatch(int position) {
+  ensureFresh();
+  if (matches_.empty()) return -1;
+  auto it = std::lower_bound(
+      matches_.begin(), matches_.end(), position,
+      [](const Match &match, int pos) { return match.position < pos; });
+  if (it == matches_.end()) return 0;
+  return static_cast<int>(it - matches_.begin());
+}
+
+int DocumentSearch::previousMatch(int position) {
+  ensureFresh();
+  if (matches_.empty()) return -1;
+  auto it = std::lower_bound(
+      matches_.begin(), matches_.end(), position,
+      [](const Match &match, int pos) { return match.position < pos; });
+  if (it == matches_.begin()) return static_cast<int>(matches_.size()) - 1;
+  return static_cast<int>(it - matches_.begin()) - 1;
+}
+
+int DocumentSearch::matchAt(int position, int length) {
+  ensureFresh();
+  int index = nextMatch(position);
+  if (index < 0 || matches_[index].position != position ||
+      matches_[index].length != length) {
+    return -1;
+  }
+  return index;
+}
+
+QString DocumentSearch::replacementFor(int index, const QString &replacement) {
+  ensureFresh();
+  if (!regex_mode_ || index < 0 ||
+      index >= static_cast<int>(matches_.size())) {
+    return replacement;
+  }
+  QRegularExpressionMatch match =
+      regex_.match(snapshot_, matches_[index].position,
+                   QRegularExpression::NormalMatch,
+                   QRegularExpression::AnchoredMatchOption);
+  return expand(replacement, match);
+}
+
+int DocumentSearch::replaceAll(const QString &replacement) {
+  ensureFresh();
+  if (!document_ || matches_.empty()) return 0;
+
+  std::vector<QString> texts;
+  texts.reserve(matches_.size());
+  for (std::size_t i = 0; i < matches_.size(); ++i) {
+    texts.push_back(replacementFor(static_cast<int>(i), replacement));
+  }
+
+  // going from the end keeps the positions of the remaining matches valid
+  QTextCursor cursor(document_);
+  cursor.beginEditBlock();
+  for (std::size_t i = matches_.size(); i-- > 0;) {
+    cursor.setPosition(matches_[i].position);
+    cursor.setPosition(matches_[i].position + matches_[i].length,
+                       QTextCursor::KeepAnchor);
+    cursor.insertText(texts[i]);
+  }
+  cursor.endEditBlock();
+
+  int count = static_cast<int>(texts.size());
+  refresh_timer_.stop();
+  refresh();
+  return count;
+}
+
+void DocumentSearch::documentChanged() {
+  if (!query_.isEmpty()) refresh_timer_.start();
+}
+
+void DocumentSearch::ensureFresh() {
+  if (refresh_timer_.isActive()) {
+    refresh_timer_.stop();
+    refresh();
+  }
+}
+
+void DocumentSearch::refresh() {
+  matches_.clear();
+  if (!document_ || query_.isEmpty()) {
+    snapshot_.clear();
+    emit matchesChanged();
+    return;
+  }
+
+  // one copy of the whole text instead of a QString per block, block
+  // separators become '\n' so offsets are document positions
+  snapshot_ = document_->toPlainText();
+  if (!regex_mode_ && (case_sensitive_ || isAscii(query_))) {
+    const ushort *begin = snapshot_.utf16();
+    const ushort *end = begin + snapshot_.size();
+    const ushort *needle = query_.utf16();
+    const int size = query_.size();
+    for (const ushort *it = begin;
+         (it = text_search::FindText(it, end, needle, size,
+                                     case_sensitive_)) != nullptr;
+         it += size) {
+      matches_.push_back({static_cast<int>(it - begin), size});
+    }
+  } else {
+    QRegularExpressionMatchIterator it = regex_.globalMatch(snapshot_);
+    while (it.hasNext()) {
+      QRegularExpressionMatch match = it.next();
+      if (match.capturedLength() == 0) continue;
+      matches_.push_back({match.capturedStart(), match.capturedLength()});
+    }
+  }
+  emit matchesChanged();
+}
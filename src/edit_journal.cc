@@ -0,0 +1,205 @@
+#include "edit_journal.h"
+
+#include <QDir>
+#include <QStandardPaths>
+#include <QUuid>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const char MAGIC[8] = {'B', 'A', 'T', 'O', 'N', 'J', 'L', '1'};
+
+struct Header {
+  char magic[8];
+  quint32 base_length;
+  quint32 name_length;  // UTF-16 code units of the file name that follows
+};
+
+// followed by added UTF-16 code units, padded to 4 bytes
+struct Record {
+  quint32 checksum;
+  quint32 position;
+  quint32 removed;
+  quint32 added;
+};
+
+qint64 padded(qint64 size) { return (size + 3) & ~qint64(3); }
+
+quint32 fnv(quint32 hash, const void *data, std::size_t size) {
+  const uchar *bytes = static_cast<const uchar *>(data);
+  for (std::size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+quint32 checksum(const Record &record, const QChar *text) {
+  quint32 hash = 2166136261u;
+  hash = fnv(hash, &record.position, sizeof(record.position));
+  hash = fnv(hash, &record.removed, sizeof(record.removed));
+  hash = fnv(hash, &record.added, sizeof(record.added));
+  return fnv(hash, text, record.added * sizeof(QChar));
+}
+
+QString journalDirectory() {
+  return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) +
+         "/journal";
+}
+
+}  // namespace
+
+EditJournal::~EditJournal() { close(false); }
+
+void EditJournal::reset(const QString &fileName, int base_length) {
+  close(false);
+  file_name_ = fileName;
+  base_length_ = base_length;
+}
+
+void EditJournal::append(int position, int removed, const QString &added) {
+  // journaling is best effort, a full disk must not get in the way of editing
+  if (data_ == nullptr && !open()) return;
+  qint64 text_bytes = added.size() * qint64(sizeof(QChar));
+  qint64 size = sizeof(Record) + padded(text_bytes);
+  if (!reserve(end_ + size)) return;
+
+  Record record = {0, quint32(position), quint32(removed),
+                   quint32(added.size())};
+  record.checksum = checksum(record, added.constData());
+  uchar *at = data_ + end_;
+  std::memcpy(at + sizeof(Record), added.constData(), text_bytes);
+  // the header goes last, a record cut short by a crash fails its checksum
+  std::memcpy(at, &record, sizeof(Record));
+  end_ += size;
+}
+
+bool EditJournal::needsCompaction(int length) const {
+  const qint64 MIN_COMPACTION_SIZE = 1 << 20;
+  qint64 records = end_ - records_begin_;
+  return records > MIN_COMPACTION_SIZE &&
+         records > 4 * qint64(length) * qint64(sizeof(QChar));
+}
+
+void EditJournal::compact(const QString &text) {
+  // the old journal stays locked and in place until the new one holds the
+  // whole text
+  QString old_path = file_.fileName();
+  std::unique_ptr<QLockFile> old_lock = std::move(lock_);
+  close(true);
+  append(0, base_length_, text);
+  QFile::remove(old_path);
+}
+
+QStringList EditJournal::abandoned() {
+  QStringList result;
+  QDir directory(journalDirectory());
+  for (const QString &name :
+       directory.entryList(QStringList("*.journal"), QDir::Files)) {
+    QString path = directory.filePath(name);
+    // a running session holds the locks of its journals, the lock of a
+    // crashed one is stale and can be taken
+    QLockFile lock(path + ".lock");
+    if (!lock.tryLock(0)) continue;
+    lock.unlock();
+    result.append(path);
+  }
+  return result;
+}
+
+bool EditJournal::read(const QString &path, Recovery *recovery) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) return false;
+  QByteArray data = file.readAll();
+  const char *begin = data.constData();
+  qint64 size = data.size();
+
+  Header header;
+  if (size < qint64(sizeof(Header))) return false;
+  std::memcpy(&header, begin, sizeof(Header));
+  if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) return false;
+  qint64 offset = sizeof(Header);
+  qint64 name_bytes = header.name_length * qint64(sizeof(QChar));
+  if (offset + name_bytes > size) return false;
+  recovery->file_name = QString(header.name_length, Qt::Uninitialized);
+  std::memcpy(recovery->file_name.data(), begin + offset, name_bytes);
+  recovery->base_length = static_cast<int>(header.base_length);
+  offset += padded(name_bytes);
+
+  recovery->edits.clear();
+  // the file is preallocated with zeros, which fail the checksum as well
+  while (offset + qint64(sizeof(Record)) <= size) {
+    Record record;
+    std::memcpy(&record, begin + offset, sizeof(Record));
+    qint64 text_bytes = record.added * qint64(sizeof(QChar));
+    if (offset + qint64(sizeof(Record)) + text_bytes > size) break;
+    QString added(static_cast<int>(record.added), Qt::Uninitialized);
+    std::memcpy(added.data(), begin + offset + sizeof(Record), text_bytes);
+    if (checksum(record, added.constData()) != record.checksum) break;
+    recovery->edits.push_back({static_cast<int>(record.position),
+                               static_cast<int>(record.removed), added});
+    offset += sizeof(Record) + padded(text_bytes);
+  }
+  return true;
+}
+
+void EditJournal::discard(const QString &path) {
+  QFile::remove(path);
+  QFile::remove(path + ".lock");
+}
+
+bool EditJournal::open() {
+  QString directory = journalDirectory();
+  if (!QDir().mkpath(directory)) return false;
+  QString path = directory + "/" +
+                 QUuid::createUuid().toString(QUuid::WithoutBraces) +
+                 ".journal";
+  lock_ = std::make_unique<QLockFile>(path + ".lock");
+  file_.setFileName(path);
+  if (!lock_->tryLock(0) || !file_.open(QIODevice::ReadWrite)) {
+    close(false);
+    return false;
+  }
+
+  Header header;
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.base_length = quint32(base_length_);
+  header.name_length = quint32(file_name_.size());
+  qint64 name_bytes = file_name_.size() * qint64(sizeof(QChar));
+  records_begin_ = sizeof(Header) + padded(name_bytes);
+  if (!reserve(records_begin_)) return false;
+  std::memcpy(data_, &header, sizeof(Header));
+  std::memcpy(data_ + sizeof(Header), file_name_.constData(), name_bytes);
+  end_ = records_begin_;
+  return true;
+}
+
+bool EditJournal::reserve(qint64 size) {
+  if (size <= capacity_) return true;
+  const qint64 MIN_CAPACITY = 64 << 10;
+  qint64 capacity = std::max({size, capacity_ * 2, MIN_CAPACITY});
+  if (data_ != nullptr) file_.unmap(data_);
+  data_ = nullptr;
+  // the grown part reads as zeros
+  if (file_.resize(capacity)) data_ = file_.map(0, capacity);
+  if (data_ == nullptr) {
+    close(false);
+    return false;
+  }
+  capacity_ = capacity;
+  return true;
+}
+
+void EditJournal::close(bool keep) {
+  if (data_ != nullptr) file_.unmap(data_);
+  data_ = nullptr;
+  if (file_.isOpen()) {
+    file_.close();
+    if (!keep) file_.remove();
+  }
+  capacity_ = 0;
+  end_ = 0;
+  records_begin_ = 0;
+  lock_.reset();
+}
@@ -2,6 +2,7 @@
 
 #include <QAbstractItemView>
 #include <QFont>
+#include <QMouseEvent>
 #include <QPainter>
 #include <QRegularExpression>
 #include <QScrollBar>
@@ -11,6 +12,9 @@
 #include <QTextCharFormat>
 #include <QTextDocument>
 #include <QTextDocumentFragment>
+#include <QTextLayout>
+#include <QToolTip>
+#include <algorithm>
 
 #include "syntax_highlighter.h"
 namespace {
@@ -23,9 +27,34 @@ static const auto &parentheses() {
   return p;
 }
 
+// Pairs the cursor shows the match of. Quotes open and close with the same
+// character and are left out.
+const auto &brackets() {
+  static QVector<QPair<QChar, QChar>> b = {{'(', ')'}, {'{', '}'}, {'[', ']'}};
+  return b;
+}
+
+const int MIN_COMPLETION_PREFIX = 2;
+
+QColor severityColor(lsp::DiagnosticSeverity severity) {
+  switch (severity) {
+    case lsp::DiagnosticSeverity::Error:
+      return Qt::red;
+    case lsp::DiagnosticSeverity::Warning:
+      return QColor(255, 165, 0);
+    default:
+      return Qt::blue;
+  }
+}
+
+bool isIdentifier(QChar c) { return c.isLetterOrNumber() || c == '_'; }
+
 }  // namespace
 
 Editor::Editor(std::size_t fontSize, QWidget *parent)
+    : Editor(nullptr, fontSize, parent) {}
+
+Editor::Editor(QTextDocument *document, std::size_t fontSize, QWidget *parent)
     : QPlainTextEdit(parent),
 
       curIndent(0),
@@ -33,24 +62,38 @@ Editor::Editor(std::size_t fontSize, QWidget *parent)
       newLine(true),
 
       fontSize(fontSize),
-      highlighter(new Highlighter(this->document())) {
+      highlighter(document ? nullptr : new Highlighter(this->document())) {
+  if (document) setDocument(document);
   lineNumberArea = new LineNumberArea(this);
 
   connect(this, &Editor::blockCountChanged, this,
           &Editor::updateLineNumberAreaWidth);
   connect(this, &Editor::updateRequest, this, &Editor::updateLineNumberArea);
 
-  connect(this, &Editor::cursorPositionChanged, this, [&]() {
-    emit changeCursor(this->textCursor().blockNumber(),
-                      this->textCursor().columnNumber());
-  });
-  connect(this, &Editor::textChanged, this, [&]() {
-    emit changeContent(this->toPlainText().toUtf8().toStdString());
-  });
-
-  updateExtraSelection();
+  // each decoration repaints only the area it leaves and the area it moves
+  // to, search matches and diagnostics coming into view are painted with
+  // the rest of the text
   connect(this, &QPlainTextEdit::cursorPositionChanged, this,
-          &Editor::updateExtraSelection);
+          &Editor::updateCurrentLine);
+  connect(this, &QPlainTextEdit::cursorPositionChanged, this,
+          &Editor::updateBracketMatch);
+  connect(verticalScrollBar(), &QScrollBar::valueChanged, this,
+          &Editor::updateCurrentLine);
+
+  const int HOVER_DELAY_MS = 500;
+  hover_timer_.setSingleShot(true);
+  hover_timer_.setInterval(HOVER_DELAY_MS);
+  connect(&hover_timer_, &QTimer::timeout, this, &Editor::requestHover);
+  viewport()->setMouseTracking(true);
+  signature_label_ = new QLabel(this, Qt::ToolTip);
+  signature_label_->setTextFormat(Qt::RichText);
+  signature_label_->setForegroundRole(QPalette::ToolTipText);
+  signature_label_->setBackgroundRole(QPalette::ToolTipBase);
+  signature_label_->setAutoFillBackground(true);
+  signature_label_->setFrameStyle(QFrame::Box);
+  signature_label_->setMargin(2);
+  connect(this, &QPlainTextEdit::cursorPositionChanged, this,
+          &Editor::followSignatureHelp);
   updateLineNumberAreaWidth(0);
 
   QFont font;
@@ -99,26 +142,7 @@ void Editor::resizeEvent(QResizeEvent *e) {
   QRect cr = contentsRect();
   lineNumberArea->setGeometry(
       QRect(cr.left(), cr.top(), lineNumberAreaWidth(), cr.height()));
-}
-
-void Editor::highlightCurrentLine(
-    QList<QTextEdit::ExtraSelection> *extraSelection) {
-  if (!isReadOnly()) {
-    QTextEdit::ExtraSelection selection;
-
-    QColor lineColor = QColor(96, 100, 36, 50);  // transparent yellow
-    selection.format.setBackground(lineColor);
-    selection.format.setProperty(QTextFormat::FullWidthSelection, true);
-    selection.cursor = textCursor();
-    selection.cursor.clearSelection();
-    extraSelection->append(selection);
-  }
-}
-
-QString Editor::wordUnderCursor() const {
-  auto tc = textCursor();
-  tc.select(QTextCursor::WordUnderCursor);
-  return tc.selectedText();
+  updateCurrentLine();
 }
 
 bool Editor::procCompleterStart(QKeyEvent *e) {
@@ -150,14 +174,28 @@ void Editor::procCompleterFinish(QKeyEvent *e) {
     return;
   }
 
-  static QString eow(R"(~!@#$%^&*()_+{}|:"<>?,./;'[]\-=)");
+  static QString eow(R"(~!@#$%^&*()+{}|:"<>?,./;'[]\-=)");
 
   auto isShortcut =
       ((e->modifiers() & Qt::ControlModifier) && e->key() == Qt::Key_Space);
-  auto completionPrefix = wordUnderCursor();
 
-  if (!isShortcut && (e->text().isEmpty() || completionPrefix.length() < 2 ||
-                      eow.contains(e->text().right(1)))) {
+  if (isShortcut) {
+    invoked_ = true;
+  } else if (e->text().isEmpty() || eow.contains(e->text().right(1))) {
+    // a trigger character shows the popup once its list arrives
+    invoked_ = false;
+    completer()->popup()->hide();
+    return;
+  }
+  showCompletions();
+}
+
+void Editor::showCompletions() {
+  if (!completer()) return;
+  QString completionPrefix = identifierPrefix();
+  int start = textCursor().positionInBlock() - completionPrefix.length();
+  if (!invoked_ && completionPrefix.length() < MIN_COMPLETION_PREFIX &&
+      triggerBefore(start).isEmpty()) {
     completer()->popup()->hide();
     return;
   }
@@ -178,7 +216,79 @@ void Editor::procCompleterFinish(QKeyEvent *e) {
   completer()->complete(cursRect);
 }
 
+void Editor::requestCompletion(QKeyEvent *e) {
+  QTextCursor cursor = textCursor();
+  int line = cursor.blockNumber();
+  int col = cursor.positionInBlock();
+  if ((e->modifiers() & Qt::ControlModifier) && e->key() == Qt::Key_Space) {
+    emit completionRequested(line, col, QString(), false);
+    return;
+  }
+  QString typed = e->text();
+  if (typed.isEmpty() || !typed.back().isPrint() || cursor.hasSelection()) {
+    return;
+  }
+
+  QString prefix = identifierPrefix();
+  if (prefix.isEmpty()) {
+    QString trigger = triggerBefore(col);
+    if (!trigger.isEmpty() && trigger.endsWith(typed.back())) {
+      emit completionRequested(line, col, trigger, false);
+    }
+    return;
+  }
+  if (!isIdentifier(typed.back())) return;
+  // members are listed from the trigger on, other identifiers once they are
+  // long enough to narrow the list
+  bool member = !triggerBefore(col - prefix.length()).isEmpty();
+  if (!member && prefix.length() < MIN_COMPLETION_PREFIX) return;
+  bool extending = member || prefix.length() > MIN_COMPLETION_PREFIX;
+  emit completionRequested(line, col, QString(), extending);
+}
+
+QString Editor::identifierPrefix() const {
+  QTextCursor cursor = textCursor();
+  QString text = cursor.block().text();
+  int end = cursor.positionInBlock();
+  int start = end;
+  while (start > 0 && isIdentifier(text[start - 1])) --start;
+  // numbers are not completed
+  if (start < end && text[start].isDigit()) return QString();
+  return text.mid(start, end - start);
+}
+
+QString Editor::triggerBefore(int positionInBlock) const {
+  QString text = textCursor().block().text().left(positionInBlock);
+  for (const QString &trigger : trigger_sequences_) {
+    if (!text.endsWith(trigger)) continue;
+    if (trigger == "<" || trigger == "\"" || trigger == "/") {
+      // header names
+      QString line = text.trimmed();
+      if (!line.startsWith("#include") && !line.startsWith("#import")) {
+        continue;
+      }
+    }
+    return trigger;
+  }
+  return QString();
+}
+
+void Editor::setTriggerCharacters(const QStringList &characters) {
+  trigger_sequences_.clear();
+  for (const QString &character : characters) {
+    if (character == ":") {
+      trigger_sequences_.append("::");
+    } else if (character == ">") {
+      trigger_sequences_.append("->");
+    } else if (character != "*") {
+      // '*' is for comments, which the editor does not complete in
+      trigger_sequences_.append(character);
+    }
+  }
+}
+
 void Editor::keyPressEvent(QKeyEvent *e) {
+  if (e->key() == Qt::Key_Escape) hideSignatureHelp();
   const int defaultIndent =
       tabStopDistance() / fontMetrics().averageCharWidth();
 
@@ -254,92 +364,11 @@ void Editor::keyPressEvent(QKeyEvent *e) {
     }
   }
 
+  requestCompletion(e);
+  requestSignatureHelp(e);
   procCompleterFinish(e);
 }
 
-void Editor::highlightParenthesis(
-    QList<QTextEdit::ExtraSelection> *extraSelection) {
-  auto currentSymbol = charUnderCursor();
-  auto prevSymbol = charUnderCursor(-1);
-
-  for (const auto &pair : parentheses()) {
-    int direction;
-
-    QChar counterSymbol;
-    QChar activeSymbol;
-    auto position = textCursor().position();
-
-    constexpr int RIGHT = 1;
-    constexpr int LEFT = -1;
-    if (pair.first == currentSymbol) {
-      direction = RIGHT;
-      counterSymbol = pair.second[0];
-      activeSymbol = currentSymbol;
-    } else if (pair.second == prevSymbol) {
-      direction = LEFT;
-      counterSymbol = pair.first[0];
-      activeSymbol = prevSymbol;
-      position--;
-    } else {
-      continue;
-    }
-
-    auto counter = 1;
-
-    while (counter != 0 && position > 0 &&
-           position < (document()->characterCount() - 1)) {
-      // Moving position
-      position += direction;
-
-      auto character = document()->characterAt(position);
-      // Checking symbol under position
-      if (character == activeSymbol) {
-        ++counter;
-      } else if (character == counterSymbol) {
-        --counter;
-      }
-    }
-
-    QTextCharFormat format;
-    format.setForeground(Qt::red);
-
-    auto darkSeaGreen = QColor(180, 238, 180);
-    format.setBackground(darkSeaGreen);
-
-    // Found
-    if (counter == 0) {
-      QTextEdit::ExtraSelection selection{};
-
-      auto directionEnum = direction < 0 ? QTextCursor::MoveOperation::Left
-                                         : QTextCursor::MoveOperation::Right;
-
-      selection.format = format;
-      selection.cursor = textCursor();
-      selection.cursor.clearSelection();
-      selection.cursor.movePosition(
-          directionEnum, QTextCursor::MoveMode::MoveAnchor,
-          std::abs(textCursor().position() - position));
-
-      constexpr int MOVE_TIMES = 1;
-
-      selection.cursor.movePosition(QTextCursor::MoveOperation::Right,
-                                    QTextCursor::MoveMode::KeepAnchor,
-                                    MOVE_TIMES);
-
-      extraSelection->append(selection);
-
-      selection.cursor = textCursor();
-      selection.cursor.clearSelection();
-      selection.cursor.movePosition(
-          directionEnum, QTextCursor::MoveMode::KeepAnchor, MOVE_TIMES);
-
-      extraSelection->append(selection);
-    }
-
-    break;
-  }
-}
-
 void Editor::lineNumberAreaPaintEvent(QPaintEvent *event) {
   QPainter painter(lineNumberArea);
   painter.fillRect(event->rect(), Qt::lightGray);
@@ -354,8 +383,27 @@ void Editor::lineNumberAreaPaintEvent(QPaintEvent *event) {
       qRound(blockBoundingGeometry(block).translated(contentOffset()).top());
   int bottom = top + qRound(blockBoundingRect(block).height());
 
+  bool marked = line_markers_ && line_markers_->document() == document();
+  std::vector<DiagnosticMarkers::Marker> markers;
   while (block.isValid() && top <= event->rect().bottom()) {
     if (block.isVisible() && bottom >= event->rect().top()) {
+      // only errors and warnings are marked, the most severe one wins
+      lsp::DiagnosticSeverity severity = lsp::DiagnosticSeverity::Information;
+      markers.clear();
+      if (marked) {
+        line_markers_->markersIn(block.position(),
+                                 block.position() + block.length(), &markers);
+      }
+      for (const DiagnosticMarkers::Marker &marker : markers) {
+        if (marker.severity != lsp::DiagnosticSeverity::Missing) {
+          severity = std::min(severity, marker.severity);
+        }
+      }
+      if (severity < lsp::DiagnosticSeverity::Information) {
+        const int MARKER_WIDTH = 3;
+        painter.fillRect(0, top, MARKER_WIDTH, bottom - top,
+                         severityColor(severity));
+      }
       QString number = QString::number(blockNumber + 1);
       painter.setPen(Qt::black);
 
@@ -370,6 +418,18 @@ void Editor::lineNumberAreaPaintEvent(QPaintEvent *event) {
   }
 }
 
+void Editor::setLineMarkers(DiagnosticMarkers *markers) {
+  if (line_markers_) {
+    disconnect(line_markers_, nullptr, lineNumberArea, nullptr);
+  }
+  line_markers_ = markers;
+  if (line_markers_) {
+    connect(line_markers_, &DiagnosticMarkers::markersChanged, lineNumberArea,
+            QOverload<>::of(&QWidget::update));
+  }
+  lineNumberArea->update();
+}
+
 void Editor::setCompleter(QCompleter *completer) {
   if (c) c->disconnect(this);
 
@@ -386,13 +446,231 @@ void Editor::setCompleter(QCompleter *completer) {
 
 QCompleter *Editor::completer() const { return c; }
 
+void Editor::setSearch(DocumentSearch *search) {
+  if (search_) disconnect(search_, nullptr, this, nullptr);
+  search_ = search;
+  if (search_) {
+    connect(search_, &DocumentSearch::matchesChanged, viewport(),
+            QOverload<>::of(&QWidget::update));
+  }
+  viewport()->update();
+}
+
+void Editor::setMarkers(DiagnosticMarkers *markers) {
+  if (markers_) disconnect(markers_, nullptr, this, nullptr);
+  markers_ = markers;
+  if (markers_) {
+    connect(markers_, &DiagnosticMarkers::markersChanged, viewport(),
+            QOverload<>::of(&QWidget::update));
+  }
+  viewport()->update();
+}
+
+void Editor::paintEvent(QPaintEvent *event) {
+  {
+    // under the text
+    QPainter painter(viewport());
+    paintCurrentLine(&painter, event->rect());
+    paintSearchMatches(&painter, event->rect());
+    paintBracketMatch(&painter, event->rect());
+  }
+  QPlainTextEdit::paintEvent(event);
+  QPainter painter(viewport());
+  paintMarkers(&painter, event->rect());
+}
+
+QVector<QRectF> Editor::rangeRects(const QTextBlock &block, int start,
+                                   int end) const {
+  QVector<QRectF> rects;
+  QTextLayout *layout = block.layout();
+  QPointF top_left = blockBoundingGeometry(block)
+                         .translated(contentOffset())
+                         .topLeft();
+  start = std::max(start, 0);
+  end = std::min(end, block.length() - 1);
+  for (int i = 0; i < layout->lineCount(); ++i) {
+    QTextLine line = layout->lineAt(i);
+    int from = std::max(start, line.textStart());
+    int to = std::min(end, line.textStart() + line.textLength());
+    // an empty range is left only at the end of the block
+    if (from > to || (from == to && i != layout->lineCount() - 1)) continue;
+    qreal left = line.cursorToX(from);
+    qreal right = line.cursorToX(to);
+    // empty ranges, like a missing semicolon at the end of a line
+    if (right - left < 1) right = left + fontMetrics().averageCharWidth();
+    rects.append(QRectF(top_left.x() + left, top_left.y() + line.y(),
+                        right - left, line.height()));
+  }
+  return rects;
+}
+
+template <typename Paint>
+void Editor::forVisibleBlocks(const QRect &area, Paint paint) const {
+  QPointF offset = contentOffset();
+  for (QTextBlock block = firstVisibleBlock(); block.isValid();
+       block = block.next()) {
+    QRectF bounds = blockBoundingGeometry(block).translated(offset);
+    if (bounds.top() > area.bottom()) break;
+    if (block.isVisible() && bounds.bottom() >= area.top()) paint(block);
+  }
+}
+
+void Editor::updateCurrentLine() {
+  QRect rect;
+  if (!isReadOnly()) {
+    rect = QRect(0, cursorRect().top(), viewport()->width(),
+                 cursorRect().height());
+  }
+  if (rect == current_line_rect_) return;
+  viewport()->update(current_line_rect_);
+  viewport()->update(rect);
+  current_line_rect_ = rect;
+}
+
+void Editor::paintCurrentLine(QPainter *painter, const QRect &area) {
+  if (current_line_rect_.intersects(area)) {
+    // transparent yellow
+    painter->fillRect(current_line_rect_, QColor(96, 100, 36, 50));
+  }
+}
+
+void Editor::paintSearchMatches(QPainter *painter, const QRect &area) {
+  if (!search_ || search_->document() != document()) return;
+  const auto &matches = search_->matches();
+  if (matches.empty()) return;
+
+  QColor color(255, 200, 0, 120);
+  forVisibleBlocks(area, [&](const QTextBlock &block) {
+    int from = block.position();
+    auto it = std::lower_bound(
+        matches.begin(), matches.end(), from,
+        [](const DocumentSearch::Match &match, int position) {
+          return match.position + match.length <= position;
+        });
+    // a document may be edited after the search, stale matches are clamped
+    // to the block
+    for (; it != matches.end() && it->position < from + block.length();
+         ++it) {
+      for (const QRectF &rect :
+           rangeRects(block, it->position - from,
+                      it->position + it->length - from)) {
+        painter->fillRect(rect, color);
+      }
+    }
+  });
+}
+
+void Editor::updateBracketMatch() {
+  int first = -1;
+  int second = -1;
+  int position = textCursor().position();
+  QChar current = charUnderCursor();
+  QChar previous = charUnderCursor(-1);
+  for (const auto &pair : brackets()) {
+    if (current == pair.first) {
+      first = position;
+      second = matchingBracket(position, pair.first, pair.second, 1);
+    } else if (previous == pair.second) {
+      first = position - 1;
+      second = matchingBracket(position - 1, pair.second, pair.first, -1);
+    } else {
+      continue;
+    }
+    break;
+  }
+  if (second < 0) first = -1;
+  if (first == bracket_[0] && second == bracket_[1]) return;
+
+  for (int bracket : {bracket_[0], bracket_[1], first, second}) {
+    if (bracket < 0) continue;
+    QTextBlock block = document()->findBlock(bracket);
+    if (!block.isValid()) continue;
+    for (const QRectF &rect : rangeRects(block, bracket - block.position(),
+                                         bracket - block.position() + 1)) {
+      viewport()->update(rect.toAlignedRect());
+    }
+  }
+  bracket_[0] = first;
+  bracket_[1] = second;
+}
+
+int Editor::matchingBracket(int position, QChar active, QChar counter,
+                            int direction) const {
+  // brackets further away than this are not looked for, so the cursor
+  // moves fast in big files with unbalanced text
+  const int MAX_SCAN = 100000;
+  QTextBlock block = document()->findBlock(position);
+  QString text = block.text();
+  int index = position - block.position();
+  int depth = 1;
+  for (int scanned = 0; scanned < MAX_SCAN; ++scanned) {
+    index += direction;
+    while (index < 0 || index >= text.size()) {
+      // the paragraph separator between blocks is not a bracket
+      block = direction > 0 ? block.next() : block.previous();
+      if (!block.isValid()) return -1;
+      text = block.text();
+      index = direction > 0 ? -1 : text.size();
+      index += direction;
+    }
+    if (text[index] == active) {
+      ++depth;
+    } else if (text[index] == counter && --depth == 0) {
+      return block.position() + index;
+    }
+  }
+  return -1;
+}
+
+void Editor::paintBracketMatch(QPainter *painter, const QRect &area) {
+  if (bracket_[0] < 0) return;
+  QColor darkSeaGreen(180, 238, 180);
+  for (int bracket : bracket_) {
+    QTextBlock block = document()->findBlock(bracket);
+    if (!block.isValid()) continue;
+    for (const QRectF &rect : rangeRects(block, bracket - block.position(),
+                                         bracket - block.position() + 1)) {
+      if (rect.intersects(area)) painter->fillRect(rect, darkSeaGreen);
+    }
+  }
+}
+
+void Editor::paintMarkers(QPainter *painter, const QRect &area) {
+  if (!markers_ || markers_->document() != document()) return;
+  std::vector<DiagnosticMarkers::Marker> markers;
+  const int WAVE = 2;
+
+  forVisibleBlocks(area, [&](const QTextBlock &block) {
+    markers.clear();
+    markers_->markersIn(block.position(), block.position() + block.length(),
+                        &markers);
+    for (const DiagnosticMarkers::Marker &marker : markers) {
+      painter->setPen(severityColor(marker.severity));
+      // every line of a wrapped block gets its part of the range
+      for (const QRectF &rect :
+           rangeRects(block, marker.start - block.position(),
+                      std::max(marker.end, marker.start + 1) -
+                          block.position())) {
+        qreal y = rect.top() + fontMetrics().ascent() + WAVE;
+        QPolygonF wave;
+        for (qreal x = rect.left(); x <= rect.right(); x += WAVE) {
+          bool up = static_cast<int>((x - rect.left()) / WAVE) % 2;
+          wave << QPointF(x, y + (up ? -WAVE / 2.0 : WAVE / 2.0));
+        }
+        painter->drawPolyline(wave);
+      }
+    }
+  });
+}
+
 void Editor::insertCompletion(const QString &completion) {
   if (c->widget() != this) return;
+  // the typed prefix is replaced, the completer matches it in any case and
+  // after a trigger character it is empty
   QTextCursor tc = textCursor();
-  int extra = completion.length() - c->completionPrefix().length();
-  tc.movePosition(QTextCursor::Left);
-  tc.movePosition(QTextCursor::EndOfWord);
-  tc.insertText(completion.right(extra));
+  tc.movePosition(QTextCursor::Left, QTextCursor::KeepAnchor,
+                  identifierPrefix().length());
+  tc.insertText(completion);
   setTextCursor(tc);
 }
 
@@ -407,6 +685,152 @@ void Editor::focusInEvent(QFocusEvent *e) {
   QPlainTextEdit::focusInEvent(e);
 }
 
+void Editor::focusOutEvent(QFocusEvent *e) {
+  hideSignatureHelp();
+  QPlainTextEdit::focusOutEvent(e);
+}
+
+void Editor::mouseMoveEvent(QMouseEvent *e) {
+  QPlainTextEdit::mouseMoveEvent(e);
+  if (e->buttons() != Qt::NoButton) {
+    cancelHover();
+    return;
+  }
+  hover_point_ = e->pos();
+  if (wordStartAt(hover_point_) != hover_position_) cancelHover();
+  hover_timer_.start();
+}
+
+void Editor::leaveEvent(QEvent *e) {
+  cancelHover();
+  QPlainTextEdit::leaveEvent(e);
+}
+
+int Editor::wordStartAt(const QPoint &point) const {
+  QTextCursor cursor = cursorForPosition(point);
+  // past the end of a line the nearest position is still found
+  if (qAbs(cursorRect(cursor).center().x() - point.x()) >
+      fontMetrics().averageCharWidth()) {
+    return -1;
+  }
+  QString text = cursor.block().text();
+  int index = cursor.positionInBlock();
+  if (index >= text.size() || !isIdentifier(text[index])) {
+    if (index == 0 || !isIdentifier(text[index - 1])) return -1;
+  }
+  while (index > 0 && isIdentifier(text[index - 1])) --index;
+  return cursor.block().position() + index;
+}
+
+void Editor::requestHover() {
+  if (completer() && completer()->popup()->isVisible()) return;
+  int word = wordStartAt(hover_point_);
+  if (word < 0 || word == hover_position_) return;
+  hover_position_ = word;
+  QTextBlock block = document()->findBlock(word);
+  emit hoverRequested(block.blockNumber(), word - block.position());
+}
+
+void Editor::cancelHover() {
+  hover_timer_.stop();
+  if (hover_position_ < 0) return;
+  hover_position_ = -1;
+  QToolTip::hideText();
+  emit hoverCancelled();
+}
+
+void Editor::showHover(int line, int col, const QString &text) {
+  QTextBlock block = document()->findBlockByNumber(line);
+  if (!block.isValid() || block.position() + col != hover_position_) return;
+  if (text.isEmpty()) return;
+  QToolTip::showText(viewport()->mapToGlobal(hover_point_), text, viewport());
+}
+
+void Editor::requestSignatureHelp(QKeyEvent *e) {
+  QString typed = e->text();
+  if (typed == ")") {
+    hideSignatureHelp();
+  } else if (typed == "(" || typed == ",") {
+    // the closing parenthesis inserted with '(' is after the cursor
+    QTextCursor cursor = textCursor();
+    signature_position_ = cursor.position();
+    emit signatureHelpRequested(cursor.blockNumber(), cursor.positionInBlock());
+  }
+}
+
+void Editor::showSignatureHelp(int line, int col,
+                               const lsp::SignatureHelp &help) {
+  QTextBlock block = document()->findBlockByNumber(line);
+  if (!hasFocus() || !block.isValid() ||
+      block.position() + col != signature_position_) {
+    return;
+  }
+  if (help.signatures.empty()) {
+    hideSignatureHelp();
+    return;
+  }
+  const lsp::SignatureInformation &signature =
+      help.signatures[std::min<std::size_t>(help.activeSignature,
+                                            help.signatures.size() - 1)];
+  QString label = QString::fromStdString(signature.label);
+  // the active parameter is set in bold
+  int start = -1;
+  int end = -1;
+  if (help.activeParameter < signature.parameters.size()) {
+    const lsp::ParameterInformation &parameter =
+        signature.parameters[help.activeParameter];
+    if (parameter.labelOffsets.has_value()) {
+      start = parameter.labelOffsets->first;
+      end = parameter.labelOffsets->second;
+    } else if (!parameter.labelString.empty()) {
+      start = label.indexOf(QString::fromStdString(parameter.labelString));
+      end = start + QString::fromStdString(parameter.labelString).size();
+    }
+  }
+  QString html;
+  if (start >= 0 && start <= end && end <= label.size()) {
+    html = label.left(start).toHtmlEscaped() + "<b>" +
+           label.mid(start, end - start).toHtmlEscaped() + "</b>" +
+           label.mid(end).toHtmlEscaped();
+  } else {
+    html = label.toHtmlEscaped();
+  }
+  signature_label_->setText(html);
+  signature_label_->adjustSize();
+
+  QTextBlock list = document()->findBlockByNumber(help.argListStart.line);
+  signature_start_ =
+      list.isValid() && (help.argListStart.line || help.argListStart.character)
+          ? list.position() + static_cast<int>(help.argListStart.character)
+          : signature_position_;
+  QRect caret = cursorRect();
+  QPoint below = viewport()->mapToGlobal(caret.bottomLeft());
+  QPoint above = viewport()->mapToGlobal(caret.topLeft()) -
+                 QPoint(0, signature_label_->height());
+  // above the line, where it does not hide the completer
+  signature_label_->move(above.y() >= 0 ? above : below);
+  signature_label_->show();
+}
+
+void Editor::followSignatureHelp() {
+  if (signature_position_ < 0) return;
+  // the hint stays on while the cursor is in the argument list it was
+  // asked for
+  QTextCursor cursor = textCursor();
+  if (cursor.position() < signature_start_ ||
+      cursor.block() != document()->findBlock(signature_position_)) {
+    hideSignatureHelp();
+  }
+}
+
+void Editor::hideSignatureHelp() {
+  if (signature_position_ < 0) return;
+  signature_position_ = -1;
+  signature_start_ = -1;
+  signature_label_->hide();
+  emit signatureHelpCancelled();
+}
+
 int Editor::getIndentationSpaces() const {
   auto blockText = textCursor().block().text();
 
@@ -438,9 +862,3 @@ QChar Editor::charUnderCursor(int offset) const {
   return text[index];
 }
 
-void Editor::updateExtraSelection() {
-  QList<QTextEdit::ExtraSelection> extra;
-  highlightParenthesis(&extra);
-  highlightCurrentLine(&extra);
-  setExtraSelections(extra);
-}
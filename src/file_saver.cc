@@ -0,0 +1,156 @@
+#include "file_saver.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+#include "task.h"
+#include "text_diff.h"
+
+namespace {
+
+QString systemError(const QString &what, const QString &fileName) {
+  return QCoreApplication::translate("FileSaver", "Cannot %1 %2:\n%3.")
+      .arg(what, fileName, QString::fromLocal8Bit(std::strerror(errno)));
+}
+
+bool writeAll(int fd, const char *data, qint64 size) {
+  while (size > 0) {
+    ssize_t written = ::write(fd, data, static_cast<size_t>(size));
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+// Returns the error message, empty on success
+QString writeAtomically(const QString &fileName, const QByteArray &data,
+                        bool sync, mode_t create_mode) {
+  // a symbolic link stays a link, its target is replaced
+  QFileInfo info(fileName);
+  QString target = info.isSymLink() ? info.canonicalFilePath() : fileName;
+  if (target.isEmpty()) target = fileName;
+  QFileInfo target_info(target);
+
+  QByteArray path = QFile::encodeName(target);
+  QByteArray temporary = QFile::encodeName(target_info.absolutePath() + "/." +
+                                           target_info.fileName() + ".XXXXXX");
+  int fd = ::mkstemp(temporary.data());
+  if (fd < 0) return systemError("create a temporary file for", target);
+
+  // mkstemp creates the file readable by the owner only
+  struct stat original;
+  mode_t mode = ::stat(path.constData(), &original) == 0
+                    ? original.st_mode & 07777
+                    : create_mode;
+  bool ok = ::fchmod(fd, mode) == 0 &&
+            writeAll(fd, data.constData(), data.size()) &&
+            (!sync || ::fsync(fd) == 0);
+  QString error;
+  if (!ok) error = systemError("write", target);
+  if (::close(fd) != 0 && error.isEmpty()) error = systemError("write", target);
+  if (error.isEmpty() && ::rename(temporary.constData(), path.constData())) {
+    error = systemError("replace", target);
+  }
+  if (!error.isEmpty()) {
+    ::unlink(temporary.constData());
+    return error;
+  }
+
+  if (sync) {
+    // the rename itself is durable only once the directory is synced
+    int dir = ::open(QFile::encodeName(target_info.absolutePath()).constData(),
+                     O_RDONLY | O_DIRECTORY);
+    if (dir >= 0) {
+      ::fsync(dir);
+      ::close(dir);
+    }
+  }
+  return QString();
+}
+
+}  // namespace
+
+FileSaver::FileSaver(QObject *parent) : QObject(parent) {
+  // new files get the usual permissions, umask can only be read by setting it
+  mode_t mask = ::umask(0);
+  ::umask(mask);
+  create_mode_ = 0666 & ~mask;
+}
+
+FileSaver::~FileSaver() { pool_.waitForDone(); }
+
+void FileSaver::setSync(bool sync) { sync_ = sync; }
+
+int FileSaver::save(const QString &fileName, const QString &text,
+                    const text_format::Format &format) {
+  int ticket = next_ticket_++;
+  if (writing_.contains(fileName)) {
+    Job &job = queued_[fileName];
+    job.file_name = fileName;
+    job.text = text;
+    job.format = format;
+    job.tickets.append(ticket);
+    return ticket;
+  }
+  start({fileName, text, format, {ticket}});
+  return ticket;
+}
+
+bool FileSaver::isBusy() const { return !writing_.isEmpty(); }
+
+void FileSaver::waitForDone() {
+  // a finished write may start the one queued behind it
+  while (isBusy()) {
+    pool_.waitForDone();
+    QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+  }
+}
+
+void FileSaver::waitForFile(const QString &fileName) {
+  // a queued write starts only when the one in flight finished
+  while (writing_.contains(fileName)) {
+    pool_.waitForDone();
+    QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+  }
+}
+
+void FileSaver::start(Job job) {
+  writing_.insert(job.file_name);
+  bool sync = sync_;
+  mode_t mode = create_mode_;
+  pool_.start(new Task([this, job = std::move(job), sync, mode]() {
+    QString error = writeAtomically(
+        job.file_name, text_format::Encode(job.text, job.format), sync, mode);
+    // the watcher of open files tells its own saves apart by the digest
+    QByteArray digest = text_diff::Digest(job.text);
+    QMetaObject::invokeMethod(
+        this, [this, job, error, digest]() { finish(job, error, digest); },
+        Qt::QueuedConnection);
+  }));
+}
+
+void FileSaver::finish(const Job &job, const QString &error,
+                       const QByteArray &digest) {
+  writing_.remove(job.file_name);
+  for (int ticket : job.tickets) {
+    emit saved(ticket, job.file_name, error, digest);
+  }
+  auto it = queued_.find(job.file_name);
+  if (it != queued_.end()) {
+    Job next = std::move(it.value());
+    queued_.erase(it);
+    start(std::move(next));
+  }
+}
@@ -2,71 +2,261 @@
 
 #include <QDir>
 #include <algorithm>
-#include <iterator>
 
 #include "editor.h"
 #include "handler.h"
 
+namespace {
+
+// Moves offset in the UTF-8 text forward by the given number of UTF-16
+// units, which is how the server counts columns. line and col follow.
+std::size_t advance(const std::string& text, std::size_t offset, int units,
+                    int* line, int* col) {
+  while (units > 0 && offset < text.size()) {
+    unsigned char lead = static_cast<unsigned char>(text[offset]);
+    int bytes = lead < 0x80 ? 1 : lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : 4;
+    int width = bytes == 4 ? 2 : 1;
+    offset = std::min(text.size(), offset + bytes);
+    units -= width;
+    if (lead == '\n') {
+      ++*line;
+      *col = 0;
+    } else {
+      *col += width;
+    }
+  }
+  return offset;
+}
+
+}  // namespace
+
 FileView::FileView(const std::string& filename, QWidget* parent)
     : QWidget(parent),
       handler_(QDir::currentPath().toStdString(), filename, ""),
       content_(""),
-      carriage_line_(0),
-      carriage_col_(0),
-      completion_required_(false),
+      line_starts_(1, 0),
       valid_cpp_(true) {
   connect(&handler_, &lsp::LSPHandler::DoneCompletion, this,
           &FileView::GetCompletion);
 
+  connect(&handler_, &lsp::LSPHandler::DoneCompletionResolve, this,
+          &FileView::GetCompletionResolve);
+
   connect(&handler_, &lsp::LSPHandler::DoneDiagnostic, this,
           &FileView::GetDiagnostic);
+
+  connect(&handler_, &lsp::LSPHandler::DoneWorkspaceSymbol, this,
+          &FileView::DoneWorkspaceSymbol);
+
+  connect(&handler_, &lsp::LSPHandler::DoneTriggerCharacters, this,
+          &FileView::DoneTriggerCharacters);
+
+  connect(&handler_, &lsp::LSPHandler::DoneHover, this, &FileView::GetHover);
+
+  connect(&handler_, &lsp::LSPHandler::DoneSignatureHelp, this,
+          &FileView::GetSignatureHelp);
+
+  connect(&handler_, &lsp::LSPHandler::DoneDefinition, this,
+          &FileView::DoneDefinition);
+
+  connect(&handler_, &lsp::LSPHandler::DoneReferences, this,
+          &FileView::DoneReferences);
 }
 FileView::~FileView() {}
 
-void FileView::GetCompletion(const std::vector<std::string>& compls) {
+void FileView::GetCompletion(const std::vector<lsp::CompletionItem>& compls) {
   emit DoneCompletion(compls);
 }
+void FileView::GetCompletionResolve(std::size_t index,
+                                    const lsp::CompletionItem& item) {
+  emit DoneCompletionResolve(index, item);
+}
 void FileView::GetDiagnostic(
     const std::vector<lsp::DiagnosticsResponse>& diagns) {
   emit DoneDiagnostic(diagns);
 }
 
+void FileView::GetHover(std::size_t line, std::size_t col,
+                        const std::string& text) {
+  if (hover_version_ == version_) hover_cache_[{line, col}] = text;
+  emit DoneHover(line, col, text);
+}
+void FileView::GetSignatureHelp(std::size_t line, std::size_t col,
+                                const lsp::SignatureHelp& help) {
+  if (signature_help_version_ == version_) {
+    signature_help_cache_[{line, col}] = help;
+  }
+  emit DoneSignatureHelp(line, col, help);
+}
+
 void FileView::SetValidity(bool val) { valid_cpp_ = val; }
 void FileView::UploadContent(const std::string& new_content) {
   if (!valid_cpp_) {
     return;
   }
   content_ = new_content;
-  if (content_.back() != '\n') {
+  if (content_.empty() || content_.back() != '\n') {
     content_ += '\n';
   }
+  IndexLines();
+  TextChanged();
   handler_.FileChanged(content_);
 }
 
-void FileView::ChangeCursor(int new_line, int new_col) {
+bool FileView::UploadChange(int line, int col, int removed,
+                            const std::string& added) {
+  if (!valid_cpp_) {
+    return true;
+  }
+  std::size_t begin = Offset(line, col);
+  if (begin == std::string::npos) {
+    return false;
+  }
+  int end_line = line;
+  int end_col = col;
+  std::size_t end = advance(content_, begin, removed, &end_line, &end_col);
+
+  content_.replace(begin, end - begin, added);
+  // the lines starting in the removed text go, the ones of the added text
+  // come, the rest move by the difference in length
+  auto first = line_starts_.begin() + line + 1;
+  first = line_starts_.erase(first, first + (end_line - line));
+  std::vector<std::size_t> inserted;
+  for (std::size_t i = added.find('\n'); i != std::string::npos;
+       i = added.find('\n', i + 1)) {
+    inserted.push_back(begin + i + 1);
+  }
+  first = line_starts_.insert(first, inserted.begin(), inserted.end());
+  // wraps around for a shrinking text, which the additions undo
+  std::size_t grown = added.size() - (end - begin);
+  for (auto it = first + inserted.size(); it != line_starts_.end(); ++it) {
+    *it += grown;
+  }
+
+  lsp::Range range;
+  range.start = {static_cast<lsp::uinteger>(line),
+                 static_cast<lsp::uinteger>(col)};
+  range.end = {static_cast<lsp::uinteger>(end_line),
+               static_cast<lsp::uinteger>(end_col)};
+  TextChanged();
+  handler_.ContentChanged(range, added);
+  return true;
+}
+
+void FileView::Rename(const std::string& filename, const std::string& content,
+                      bool valid) {
+  // the text sent while the file was not C++ is stale, the server gets it
+  // whole under the new name
+  valid_cpp_ = valid;
+  content_ = valid ? content : "";
+  if (valid_cpp_ && (content_.empty() || content_.back() != '\n')) {
+    content_ += '\n';
+  }
+  IndexLines();
+  TextChanged();
+  handler_.FileRenamed(filename, content_);
+}
+
+void FileView::NotifySaved() {
+  if (!valid_cpp_) {
+    return;
+  }
+  handler_.FileSaved();
+}
+
+void FileView::ResolveCompletion(std::size_t index) {
+  if (!valid_cpp_) {
+    return;
+  }
+  handler_.ResolveCompletion(index);
+}
+
+void FileView::RequestWorkspaceSymbol(const std::string& query) {
+  // the index is project wide, so the request does not depend on valid_cpp_
+  handler_.RequestWorkspaceSymbol(query);
+}
+
+void FileView::TextChanged() {
+  ++version_;
+  hover_cache_.clear();
+  signature_help_cache_.clear();
+}
+
+void FileView::IndexLines() {
+  line_starts_.assign(1, 0);
+  for (std::size_t i = content_.find('\n'); i != std::string::npos;
+       i = content_.find('\n', i + 1)) {
+    line_starts_.push_back(i + 1);
+  }
+}
+
+std::size_t FileView::Offset(int line, int col) const {
+  if (line < 0 || static_cast<std::size_t>(line) >= line_starts_.size()) {
+    return std::string::npos;
+  }
+  // the column counts UTF-16 units, the text is UTF-8
+  int end_col = 0;
+  std::size_t offset =
+      advance(content_, line_starts_[line], col, &line, &end_col);
+  return end_col == col ? offset : std::string::npos;
+}
+
+void FileView::RequestCompletion(int line, int col,
+                                 const std::string& trigger, bool extending) {
+  if (!valid_cpp_) {
+    return;
+  }
+  // the popup filters the last list by itself
+  if (extending && !handler_.CompletionIncomplete()) {
+    return;
+  }
+  handler_.RequestCompletion(line, col, trigger);
+}
+
+void FileView::RequestHover(int line, int col) {
   if (!valid_cpp_) {
     return;
   }
-  carriage_line_ = new_line;
-  carriage_col_ = new_col;
+  auto cached = hover_cache_.find({line, col});
+  if (cached != hover_cache_.end()) {
+    handler_.CancelHover();
+    emit DoneHover(line, col, cached->second);
+    return;
+  }
+  hover_version_ = version_;
+  handler_.RequestHover(line, col);
+}
+
+void FileView::CancelHover() { handler_.CancelHover(); }
 
-  // searching for next charachter after cursor
-  auto it = content_.begin();
-  for (int line = 0; line < carriage_line_; ++line) {
-    it = std::find(it, content_.end(), '\n');
-    it++;
+void FileView::RequestSignatureHelp(int line, int col) {
+  if (!valid_cpp_) {
+    return;
   }
-  char next_char =
-      content_[(std::distance(content_.begin(), it) + carriage_col_)];
+  auto cached = signature_help_cache_.find({line, col});
+  if (cached != signature_help_cache_.end()) {
+    handler_.CancelSignatureHelp();
+    emit DoneSignatureHelp(line, col, cached->second);
+    return;
+  }
+  signature_help_version_ = version_;
+  handler_.RequestSignatureHelp(line, col);
+}
 
-  static char allowable_for_completion[] = {'\n', '\0', '\t', ' ', '}', ')'};
+void FileView::CancelSignatureHelp() { handler_.CancelSignatureHelp(); }
 
-  completion_required_ =
-      std::find(std::begin(allowable_for_completion),
-                std::end(allowable_for_completion),
-                next_char) != std::end(allowable_for_completion);
+void FileView::RequestDefinition(int line, int col) {
+  if (!valid_cpp_) {
+    emit DoneDefinition({});
+    return;
+  }
+  handler_.RequestDefinition(line, col);
+}
 
-  if (completion_required_) {
-    handler_.RequestCompletion(carriage_line_, carriage_col_);
+void FileView::RequestReferences(int line, int col) {
+  if (!valid_cpp_) {
+    emit DoneReferences({}, true);
+    return;
   }
+  handler_.RequestReferences(line, col);
 }
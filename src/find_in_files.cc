@@ -0,0 +1,284 @@
+#include "find_in_files.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHBoxLayout>
+#include <QRegularExpression>
+#include <QVBoxLayout>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include "task.h"
+#include "text_search.h"
+#include "workspace_files.h"
+
+struct SearchJob {
+  QString root;
+  QRegularExpression regex;
+  std::string literal;  // UTF-8, files without it are skipped
+  bool literal_only = false;  // a line containing literal is a match
+  bool case_sensitive = false;
+
+  QStringList files;
+  std::atomic<int> next_file{0};
+  std::atomic<int> running{0};
+  std::atomic<int> match_count{0};
+  std::atomic<int> matched_files{0};
+  std::atomic<bool> cancelled{false};
+};
+
+namespace {
+
+const int PATH_ROLE = Qt::UserRole + 1;
+const int LINE_ROLE = Qt::UserRole + 2;
+const int MAX_MATCHES = 20000;
+
+bool isAscii(const std::string &text) {
+  return std::all_of(text.begin(), text.end(),
+                     [](char ch) { return (ch & 0x80) == 0; });
+}
+
+void searchFile(SearchJob *job, const QRegularExpression &regex,
+                const QString &path, std::vector<SearchMatch> *matches) {
+  const qint64 MAX_FILE_SIZE = 32 * 1024 * 1024;
+  const qint64 BINARY_PROBE_SIZE = 8 * 1024;
+  const int MAX_PREVIEW_LENGTH = 200;
+
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) return;
+  qint64 size = file.size();
+  if (size == 0 || size > MAX_FILE_SIZE) return;
+  uchar *data = file.map(0, size);
+  if (data == nullptr) return;
+
+  const char *begin = reinterpret_cast<const char *>(data);
+  const char *end = begin + size;
+  bool binary =
+      std::memchr(begin, '\0', std::min(size, BINARY_PROBE_SIZE)) != nullptr;
+  const std::string &literal = job->literal;
+  if (binary || (!literal.empty() &&
+                 text_search::FindLiteral(begin, end, literal,
+                                          job->case_sensitive) == nullptr)) {
+    file.unmap(data);
+    return;
+  }
+
+  bool matched = false;
+  int line = 0;
+  const char *counted = begin;  // line is the number of the line at counted
+  const char *pos = begin;      // always the start of a line
+  while (pos < end && !job->cancelled.load()) {
+    const char *line_begin = pos;
+    if (!literal.empty()) {
+      // only lines containing the literal are given to the regex engine
+      const char *hit = text_search::FindLiteral(pos, end, literal,
+                                                 job->case_sensitive);
+      if (hit == nullptr) break;
+      line_begin = hit;
+      while (line_begin > pos && line_begin[-1] != '\n') --line_begin;
+    }
+    auto line_end = static_cast<const char *>(
+        std::memchr(line_begin, '\n', end - line_begin));
+    if (line_end == nullptr) line_end = end;
+    line += static_cast<int>(std::count(counted, line_begin, '\n'));
+    counted = line_begin;
+
+    const char *text_end = line_end;
+    if (text_end > line_begin && text_end[-1] == '\r') --text_end;
+    QString text = QString::fromUtf8(line_begin, text_end - line_begin);
+    if (job->literal_only || regex.match(text).hasMatch()) {
+      if (job->match_count.fetch_add(1) >= MAX_MATCHES) {
+        job->cancelled.store(true);
+        break;
+      }
+      matched = true;
+      matches->push_back(
+          {path, line, text.trimmed().left(MAX_PREVIEW_LENGTH)});
+    }
+    pos = line_end + 1;
+  }
+  if (matched) ++job->matched_files;
+  file.unmap(data);
+}
+
+}  // namespace
+
+FindInFiles::FindInFiles(QWidget *parent)
+    : QWidget(parent),
+      query_(new QLineEdit(this)),
+      regex_(new QCheckBox(tr("Regex"), this)),
+      case_sensitive_(new QCheckBox(tr("Match case"), this)),
+      status_(new QLabel(this)),
+      results_(new QListWidget(this)) {
+  QHBoxLayout *options = new QHBoxLayout;
+  options->addWidget(query_);
+  options->addWidget(regex_);
+  options->addWidget(case_sensitive_);
+  QVBoxLayout *layout = new QVBoxLayout(this);
+  layout->setContentsMargins(0, 0, 0, 0);
+  layout->addLayout(options);
+  layout->addWidget(status_);
+  layout->addWidget(results_);
+
+  query_->setPlaceholderText(tr("Find in files"));
+  results_->setUniformItemSizes(true);
+
+  // typing is not interrupted by a search started for every letter
+  const int RESTART_DELAY_MS = 200;
+  restart_timer_.setSingleShot(true);
+  restart_timer_.setInterval(RESTART_DELAY_MS);
+  connect(&restart_timer_, &QTimer::timeout, this, &FindInFiles::restart);
+  connect(query_, &QLineEdit::textChanged, &restart_timer_,
+          QOverload<>::of(&QTimer::start));
+  connect(query_, &QLineEdit::returnPressed, this, &FindInFiles::restart);
+  connect(regex_, &QCheckBox::toggled, this, &FindInFiles::restart);
+  connect(case_sensitive_, &QCheckBox::toggled, this, &FindInFiles::restart);
+  connect(results_, &QListWidget::itemActivated, this, &FindInFiles::choose);
+}
+
+FindInFiles::~FindInFiles() {
+  cancel();
+  pool_.waitForDone();
+}
+
+void FindInFiles::setRoot(const QString &root) {
+  root_ = root;
+  if (!query_->text().isEmpty()) restart();
+}
+
+void FindInFiles::activate(const QString &text) {
+  if (!text.isEmpty()) query_->setText(text);
+  query_->setFocus();
+  query_->selectAll();
+}
+
+void FindInFiles::cancel() {
+  if (job_) job_->cancelled.store(true);
+  job_.reset();
+}
+
+void FindInFiles::restart() {
+  restart_timer_.stop();
+  cancel();
+  results_->clear();
+  match_count_ = 0;
+
+  QString query = query_->text();
+  if (query.isEmpty()) {
+    status_->clear();
+    return;
+  }
+  if (root_.isEmpty()) {
+    status_->setText(tr("Set the root directory first"));
+    return;
+  }
+
+  auto job = std::make_shared<SearchJob>();
+  job->root = root_;
+  job->case_sensitive = case_sensitive_->isChecked();
+  job->regex.setPattern(regex_->isChecked()
+                            ? query
+                            : QRegularExpression::escape(query));
+  if (!job->case_sensitive) {
+    job->regex.setPatternOptions(QRegularExpression::CaseInsensitiveOption);
+  }
+  if (!job->regex.isValid()) {
+    status_->setText(tr("Invalid regular expression: %1")
+                         .arg(job->regex.errorString()));
+    return;
+  }
+  job->literal = (regex_->isChecked() ? text_search::RequiredLiteral(query)
+                                      : query)
+                     .toStdString();
+  // byte comparison folds ASCII only, other literals need the exact case
+  if (!job->case_sensitive && !isAscii(job->literal)) job->literal.clear();
+  job->literal_only = !regex_->isChecked() && !job->literal.empty();
+
+  job_ = job;
+  status_->setText(tr("Searching..."));
+  pool_.start(new Task([this, job]() {
+    job->files = workspace::ListFiles(job->root, nullptr, &job->cancelled);
+    // workers take the next file from a shared cursor, so a thread stuck on
+    // a big file does not hold back the others
+    int workers = pool_.maxThreadCount();
+    job->running.store(workers);
+    for (int i = 0; i < workers; ++i) {
+      pool_.start(new Task([this, job]() { runSearch(job); }));
+    }
+  }));
+}
+
+void FindInFiles::runSearch(std::shared_ptr<SearchJob> job) {
+  const std::size_t BATCH_SIZE = 256;
+  const int FLUSH_INTERVAL_MS = 50;
+
+  // every worker compiles its own copy of the expression
+  QRegularExpression regex(job->regex.pattern(), job->regex.patternOptions());
+  regex.optimize();
+  std::vector<SearchMatch> batch;
+  QElapsedTimer since_flush;
+  since_flush.start();
+  auto flush = [&]() {
+    if (batch.empty()) return;
+    QMetaObject::invokeMethod(
+        this,
+        [this, job, matches = std::move(batch)]() { addMatches(job, matches); },
+        Qt::QueuedConnection);
+    batch.clear();
+    since_flush.restart();
+  };
+
+  while (!job->cancelled.load()) {
+    int index = job->next_file.fetch_add(1);
+    if (index >= job->files.size()) break;
+    searchFile(job.get(), regex, job->files[index], &batch);
+    if (batch.size() >= BATCH_SIZE ||
+        since_flush.elapsed() >= FLUSH_INTERVAL_MS) {
+      flush();
+    }
+  }
+  flush();
+  if (--job->running == 0) {
+    QMetaObject::invokeMethod(
+        this, [this, job]() { searchFinished(job); }, Qt::QueuedConnection);
+  }
+}
+
+void FindInFiles::addMatches(const std::shared_ptr<SearchJob> &job,
+                             const std::vector<SearchMatch> &matches) {
+  if (job != job_) return;  // the query was changed meanwhile
+  QDir root(job->root);
+  for (const SearchMatch &match : matches) {
+    QListWidgetItem *item = new QListWidgetItem(
+        QString("%1:%2: %3")
+            .arg(root.relativeFilePath(match.path))
+            .arg(match.line + 1)
+            .arg(match.preview),
+        results_);
+    item->setData(PATH_ROLE, match.path);
+    item->setData(LINE_ROLE, match.line);
+  }
+  match_count_ += static_cast<int>(matches.size());
+  status_->setText(tr("Searching... %1 matches").arg(match_count_));
+}
+
+void FindInFiles::searchFinished(const std::shared_ptr<SearchJob> &job) {
+  if (job != job_) return;
+  QString status = tr("%1 matches in %2 files")
+                       .arg(match_count_)
+                       .arg(job->matched_files.load());
+  if (job->match_count.load() > MAX_MATCHES) {
+    status += tr(", stopped after %1").arg(MAX_MATCHES);
+  }
+  status_->setText(status);
+  job_.reset();
+}
+
+void FindInFiles::choose(QListWidgetItem *item) {
+  emit locationChosen(item->data(PATH_ROLE).toString(),
+                      item->data(LINE_ROLE).toInt());
+}
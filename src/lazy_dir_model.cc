@@ -0,0 +1,372 @@
+#include "lazy_dir_model.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <QFile>
+#include <QFileIconProvider>
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "startup_trace.h"
+#include "task.h"
+#include "workspace_files.h"
+
+namespace {
+
+// Directories first, then by name ignoring case
+bool lessThan(const LazyDirModel::Entry &a, const LazyDirModel::Entry &b) {
+  if (a.is_dir != b.is_dir) return a.is_dir;
+  int order = QString::compare(a.name, b.name, Qt::CaseInsensitive);
+  return order != 0 ? order < 0 : a.name < b.name;
+}
+
+std::vector<LazyDirModel::Entry> readDirectory(const QString &path) {
+  std::vector<LazyDirModel::Entry> entries;
+  DIR *dir = ::opendir(QFile::encodeName(path).constData());
+  if (dir == nullptr) return entries;
+  while (dirent *entry = ::readdir(dir)) {
+    const char *name = entry->d_name;
+    if (std::strcmp(name, ".") == 0 || std::strcmp(name, "..") == 0) continue;
+    bool is_dir = entry->d_type == DT_DIR;
+    // links and file systems without types in their directories need a
+    // stat, a link to a directory is shown as one
+    if (entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK) {
+      struct stat info;
+      if (::fstatat(::dirfd(dir), name, &info, 0) != 0) continue;
+      is_dir = S_ISDIR(info.st_mode);
+    }
+    QString file_name = QFile::decodeName(name);
+    if (is_dir && workspace::IsIgnoredDirectory(file_name)) continue;
+    entries.push_back({file_name, is_dir});
+  }
+  ::closedir(dir);
+  std::sort(entries.begin(), entries.end(), lessThan);
+  return entries;
+}
+
+}  // namespace
+
+LazyDirModel::LazyDirModel(QObject *parent)
+    : QAbstractItemModel(parent), root_(new Node) {
+  QFileIconProvider icons;
+  dir_icon_ = icons.icon(QFileIconProvider::Folder);
+  file_icon_ = icons.icon(QFileIconProvider::File);
+  root_->is_dir = true;
+  // a build writing many files lists its directories once
+  const int RELIST_DELAY_MS = 200;
+  relist_timer_.setSingleShot(true);
+  relist_timer_.setInterval(RELIST_DELAY_MS);
+  connect(&watcher_, &QFileSystemWatcher::directoryChanged, this,
+          &LazyDirModel::directoryChanged);
+  connect(&relist_timer_, &QTimer::timeout, this,
+          &LazyDirModel::relistChanged);
+}
+
+LazyDirModel::~LazyDirModel() { pool_.waitForDone(); }
+
+void LazyDirModel::setRootPath(const QString &path) {
+  beginResetModel();
+  if (!watcher_.directories().isEmpty()) {
+    watcher_.removePaths(watcher_.directories());
+  }
+  changed_.clear();
+  root_.reset(new Node);
+  root_->is_dir = true;
+  root_path_ = path;
+  endResetModel();
+  listing_started_ = startup_trace::Now();
+  if (!path.isEmpty()) list(root_.get());
+}
+
+QString LazyDirModel::rootPath() const { return root_path_; }
+
+QString LazyDirModel::filePath(const QModelIndex &index) const {
+  return pathOf(nodeOf(index));
+}
+
+bool LazyDirModel::isDir(const QModelIndex &index) const {
+  return nodeOf(index)->is_dir;
+}
+
+QModelIndex LazyDirModel::index(int row, int column,
+                                const QModelIndex &parent) const {
+  Node *node = nodeOf(parent);
+  if (column != 0 || row < 0 ||
+      row >= static_cast<int>(node->children.size())) {
+    return QModelIndex();
+  }
+  return createIndex(row, 0, node->children[row].get());
+}
+
+QModelIndex LazyDirModel::parent(const QModelIndex &index) const {
+  if (!index.isValid()) return QModelIndex();
+  return indexOf(nodeOf(index)->parent);
+}
+
+int LazyDirModel::rowCount(const QModelIndex &parent) const {
+  if (parent.column() > 0) return 0;
+  return static_cast<int>(nodeOf(parent)->children.size());
+}
+
+int LazyDirModel::columnCount(const QModelIndex &) const { return 1; }
+
+bool LazyDirModel::hasChildren(const QModelIndex &parent) const {
+  const Node *node = nodeOf(parent);
+  if (!node->is_dir) return false;
+  // an unlisted directory gets an expander, listing it may find it empty
+  return node->state != Node::State::Listed || !node->children.empty();
+}
+
+QVariant LazyDirModel::data(const QModelIndex &index, int role) const {
+  if (!index.isValid()) return QVariant();
+  const Node *node = nodeOf(index);
+  switch (role) {
+    case Qt::DisplayRole:
+      return node->name;
+    case Qt::DecorationRole:
+      return node->is_dir ? dir_icon_ : file_icon_;
+    case Qt::ToolTipRole:
+      return pathOf(node);
+    default:
+      return QVariant();
+  }
+}
+
+QVariant LazyDirModel::headerData(int section, Qt::Orientation orientation,
+                                  int role) const {
+  if (section == 0 && orientation == Qt::Horizontal &&
+      role == Qt::DisplayRole) {
+    return tr("Name");
+  }
+  return QVariant();
+}
+
+bool LazyDirModel::canFetchMore(const QModelIndex &parent) const {
+  const Node *node = nodeOf(parent);
+  return node->is_dir && node->state == Node::State::Unlisted &&
+         !root_path_.isEmpty();
+}
+
+void LazyDirModel::fetchMore(const QModelIndex &parent) {
+  if (canFetchMore(parent)) list(nodeOf(parent));
+}
+
+LazyDirModel::Node *LazyDirModel::nodeOf(const QModelIndex &index) const {
+  if (!index.isValid()) return root_.get();
+  return static_cast<Node *>(index.internalPointer());
+}
+
+QModelIndex LazyDirModel::indexOf(Node *node) const {
+  if (node == nullptr || node == root_.get()) return QModelIndex();
+  return createIndex(node->row, 0, node);
+}
+
+QString LazyDirModel::pathOf(const Node *node) const {
+  QStringList names;
+  for (; node != root_.get(); node = node->parent) names.prepend(node->name);
+  names.prepend(root_path_);
+  return names.join('/');
+}
+
+LazyDirModel::Node *LazyDirModel::nodeAt(const QString &path) const {
+  if (root_path_.isEmpty() || !path.startsWith(root_path_)) return nullptr;
+  QString rest = path.mid(root_path_.size());
+  if (!rest.isEmpty() && !rest.startsWith('/') && !root_path_.endsWith('/')) {
+    return nullptr;
+  }
+  Node *node = root_.get();
+  for (const QString &name : rest.split('/')) {
+    if (name.isEmpty()) continue;
+    // the children are sorted, directories first
+    auto it = std::lower_bound(
+        node->children.begin(), node->children.end(), Entry{name, true},
+        [](const std::unique_ptr<Node> &child, const Entry &entry) {
+          return lessThan({child->name, child->is_dir}, entry);
+        });
+    if (it == node->children.end() || !(*it)->is_dir ||
+        (*it)->name != name) {
+      return nullptr;
+    }
+    node = it->get();
+  }
+  return node;
+}
+
+void LazyDirModel::list(Node *node) {
+  node->state = Node::State::Listing;
+  int listing = node->listing = ++listings_;
+  QString path = pathOf(node);
+  // changes made while the listing runs are picked up by listing again
+  watcher_.addPath(path);
+  pool_.start(new Task([this, listing, path]() {
+    // small enough batches to keep every insertion short
+    const std::size_t BATCH_SIZE = 2000;
+    std::vector<Entry> entries = readDirectory(path);
+    std::size_t begin = 0;
+    do {
+      std::size_t end = std::min(entries.size(), begin + BATCH_SIZE);
+      std::vector<Entry> batch(entries.begin() + begin, entries.begin() + end);
+      bool last = end == entries.size();
+      QMetaObject::invokeMethod(
+          this,
+          [this, listing, path, batch = std::move(batch), last]() {
+            appendEntries(path, listing, batch, last);
+          },
+          Qt::QueuedConnection);
+      begin = end;
+    } while (begin < entries.size());
+  }));
+}
+
+void LazyDirModel::appendEntries(const QString &path, int listing,
+                                 const std::vector<Entry> &entries,
+                                 bool last) {
+  // the directory went away, or the root changed, or it is listed again
+  Node *node = nodeAt(path);
+  if (node == nullptr || node->listing != listing) return;
+  QModelIndex parent = indexOf(node);
+  if (!entries.empty()) {
+    int first = static_cast<int>(node->children.size());
+    beginInsertRows(parent, first,
+                    first + static_cast<int>(entries.size()) - 1);
+    for (const Entry &entry : entries) {
+      auto child = std::make_unique<Node>();
+      child->name = entry.name;
+      child->is_dir = entry.is_dir;
+      child->parent = node;
+      child->row = static_cast<int>(node->children.size());
+      node->children.push_back(std::move(child));
+    }
+    endInsertRows();
+  }
+  if (last) {
+    node->state = Node::State::Listed;
+    if (node == root_.get()) {
+      startup_trace::Record("directory tree listing", listing_started_);
+    }
+    // an empty directory loses its expander
+    if (node->children.empty() && parent.isValid()) {
+      emit dataChanged(parent, parent);
+    }
+  }
+}
+
+void LazyDirModel::directoryChanged(const QString &path) {
+  changed_.insert(path);
+  if (!relist_timer_.isActive()) relist_timer_.start();
+}
+
+void LazyDirModel::relistChanged() {
+  QSet<QString> changed;
+  changed.swap(changed_);
+  for (const QString &path : changed) {
+    Node *node = nodeAt(path);
+    // removed with its parent, which changed as well
+    if (node == nullptr) {
+      watcher_.removePath(path);
+    } else if (node->state != Node::State::Unlisted) {
+      relist(node);
+    }
+  }
+}
+
+void LazyDirModel::relist(Node *node) {
+  int listing = node->listing = ++listings_;
+  QString path = pathOf(node);
+  pool_.start(new Task([this, listing, path]() {
+    std::vector<Entry> entries = readDirectory(path);
+    QMetaObject::invokeMethod(
+        this,
+        [this, listing, path, entries = std::move(entries)]() {
+          mergeEntries(path, listing, entries);
+        },
+        Qt::QueuedConnection);
+  }));
+}
+
+void LazyDirModel::mergeEntries(const QString &path, int listing,
+                                const std::vector<Entry> &entries) {
+  Node *node = nodeAt(path);
+  if (node == nullptr || node->listing != listing) return;
+  QModelIndex parent = indexOf(node);
+  std::vector<std::unique_ptr<Node>> &children = node->children;
+  bool was_empty = children.empty();
+  auto before = [](const std::unique_ptr<Node> &child, const Entry &entry) {
+    return lessThan({child->name, child->is_dir}, entry);
+  };
+  auto after = [](const std::unique_ptr<Node> &child, const Entry &entry) {
+    return lessThan(entry, {child->name, child->is_dir});
+  };
+  // the rows of the views follow the nodes before the change is announced
+  auto renumber = [&](std::size_t from) {
+    for (std::size_t i = from; i < children.size(); ++i) {
+      children[i]->row = static_cast<int>(i);
+    }
+  };
+
+  // both lists are sorted the same way, runs of entries that went or came
+  // are removed or inserted at once
+  std::size_t row = 0;
+  std::size_t next = 0;
+  while (row < children.size() || next < entries.size()) {
+    bool gone = next == entries.size() ||
+                (row < children.size() && before(children[row], entries[next]));
+    bool came = row == children.size() ||
+                (next < entries.size() && after(children[row], entries[next]));
+    if (gone) {
+      std::size_t end = row + 1;
+      while (end < children.size() &&
+             (next == entries.size() || before(children[end], entries[next]))) {
+        ++end;
+      }
+      beginRemoveRows(parent, static_cast<int>(row),
+                      static_cast<int>(end) - 1);
+      for (std::size_t i = row; i < end; ++i) unwatch(children[i].get());
+      children.erase(children.begin() + row, children.begin() + end);
+      renumber(row);
+      endRemoveRows();
+    } else if (came) {
+      std::size_t end = next + 1;
+      while (end < entries.size() &&
+             (row == children.size() || after(children[row], entries[end]))) {
+        ++end;
+      }
+      std::vector<std::unique_ptr<Node>> added;
+      for (std::size_t i = next; i < end; ++i) {
+        auto child = std::make_unique<Node>();
+        child->name = entries[i].name;
+        child->is_dir = entries[i].is_dir;
+        child->parent = node;
+        added.push_back(std::move(child));
+      }
+      beginInsertRows(parent, static_cast<int>(row),
+                      static_cast<int>(row + added.size()) - 1);
+      children.insert(children.begin() + row,
+                      std::make_move_iterator(added.begin()),
+                      std::make_move_iterator(added.end()));
+      renumber(row);
+      endInsertRows();
+      row += end - next;
+      next = end;
+    } else {
+      ++row;
+      ++next;
+    }
+  }
+  // a listing cut short by this one is complete now
+  node->state = Node::State::Listed;
+  if (was_empty != children.empty() && parent.isValid()) {
+    emit dataChanged(parent, parent);
+  }
+}
+
+void LazyDirModel::unwatch(const Node *node) {
+  if (!node->is_dir || node->state == Node::State::Unlisted) return;
+  watcher_.removePath(pathOf(node));
+  for (const std::unique_ptr<Node> &child : node->children) {
+    unwatch(child.get());
+  }
+}
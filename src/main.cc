@@ -25,14 +25,60 @@ SOFTWARE.
 #include <QCommandLineParser>
 #include <QDesktopWidget>
 #include <QStyle>
+#include <QTimer>
+#include <memory>
 
 #include "editor.h"
 #include "mainwindow.h"
+#include "startup_trace.h"
 #include "terminal.h"
 
 int main(int argv, char **args) {
+  startup_trace::Start();
   QApplication app(argv, args);
+  startup_trace::Record("application", 0);
+
+  QCommandLineParser parser;
+  parser.addHelpOption();
+  QCommandLineOption profileOption(
+      "profile-startup",
+      QCoreApplication::translate(
+          "main", "Time the phases of the start, write a report and quit."));
+  QCommandLineOption reportOption(
+      "profile-report",
+      QCoreApplication::translate("main",
+                                  "Report of --profile-startup, by default "
+                                  "startup-profile.tsv."),
+      QCoreApplication::translate("main", "file"), "startup-profile.tsv");
+  parser.addOption(profileOption);
+  parser.addOption(reportOption);
+  parser.process(app);
+  if (parser.isSet(profileOption)) startup_trace::Enable();
+
+  qint64 start = startup_trace::Now();
   MainWindow mainwindow;
+  startup_trace::Record("main window", start);
   mainwindow.show();
+
+  if (parser.isSet(profileOption)) {
+    // the start is over once the language server answered, a missing
+    // server ends it by the timeout
+    QString report = parser.value(reportOption);
+    // shared by both callbacks, which outlive this block
+    auto written = std::make_shared<bool>(false);
+    auto finish = [&app, report, written]() {
+      if (*written) return;
+      *written = true;
+      QString error;
+      if (!startup_trace::WriteReport(report, &error)) {
+        qWarning("Cannot write %s: %s", qPrintable(report),
+                 qPrintable(error));
+      }
+      app.quit();
+    };
+    startup_trace::WhenRecorded("clangd initialize", finish);
+    const int PROFILE_TIMEOUT_MS = 60000;
+    QTimer::singleShot(PROFILE_TIMEOUT_MS, &app, finish);
+  }
   return app.exec();
 }
@@ -14,57 +14,99 @@
 #include <list>
 #include <utility>
 
+#include "completion_model.h"
 #include "directory_tree.h"
 #include "editor.h"
 #include "handler.h"
+#include "startup_trace.h"
 #include "syntax_highlighter.h"
 #include "terminal.h"
 namespace {
 const int tabStop = 4;
+const char SETTINGS_ORGANIZATION[] = "baton";
+const char SETTINGS_APPLICATION[] = "baton";
+const char DEFAULT_BUILD_COMMAND[] = "cmake --build build";
 struct WidgetPlacer {
   int row, col, row_span, col_span;
 };
-std::string number_to_string(int number, std::string failure_log) {
-  if (number % 10 == 1 && number % 100 != 11) {
-    failure_log += "st";
-  } else if (number % 10 == 2 && number % 100 != 12) {
-    failure_log += "nd";
-  } else if (number % 10 == 3 && number % 100 != 13) {
-    failure_log += "rd";
-  } else {
-    failure_log += "th";
+DocumentManager::ViewState viewStateOf(const Editor *pane) {
+  QTextCursor cursor = pane->textCursor();
+  return {cursor.position(), cursor.anchor(),
+          pane->verticalScrollBar()->value()};
+}
+// Documents are listed in the problems panel by their identity, untitled
+// ones have no name to tell them apart
+QString diagnosticsKey(const Document *doc) {
+  return QString("document:%1").arg(reinterpret_cast<quintptr>(doc));
+}
+// Files the build complained about are listed apart from the documents, the
+// server knows nothing about the messages of the compiler
+const char BUILD_KEY[] = "build:";
+std::vector<lsp::DiagnosticsResponse> fromBuild(
+    const std::vector<build_output::Diagnostic> &diagnostics) {
+  std::vector<lsp::DiagnosticsResponse> result;
+  result.reserve(diagnostics.size());
+  for (const build_output::Diagnostic &diagnostic : diagnostics) {
+    lsp::DiagnosticsResponse response;
+    response.message = diagnostic.message.toStdString();
+    response.range.start.line = diagnostic.line;
+    response.range.start.character = diagnostic.column;
+    response.range.end = response.range.start;
+    response.severity = lsp::DiagnosticSeverity::Information;
+    if (diagnostic.severity == build_output::Severity::Error) {
+      response.severity = lsp::DiagnosticSeverity::Error;
+    } else if (diagnostic.severity == build_output::Severity::Warning) {
+      response.severity = lsp::DiagnosticSeverity::Warning;
+    }
+    result.push_back(response);
   }
-  return failure_log;
+  return result;
+}
+void restoreViewState(Editor *pane, const DocumentManager::ViewState &state) {
+  // the file may have been replaced on disk while the tab was dormant
+  int last = pane->document()->characterCount() - 1;
+  QTextCursor cursor(pane->document());
+  cursor.setPosition(qMin(state.anchor, last));
+  cursor.setPosition(qMin(state.position, last), QTextCursor::KeepAnchor);
+  pane->setTextCursor(cursor);
+  pane->verticalScrollBar()->setValue(state.scroll);
 }
 }  // namespace
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent),
       ui(new Ui::MainWindow),
-      textEdit(new Editor),
       terminal(new Terminal),
-      splitted(false),
-      display_failure_log(new QPlainTextEdit),
+      diagnostics_model(new DiagnosticsModel(this)),
+      diagnostics_view(new QTreeView),
+      search_bar(new SearchBar),
       font(new QFont) {
   ui->setupUi(this);
+  // nothing is spawned before the window is on screen
+  lsp::Client::HoldLaunches();
   font->setFamily("Courier");
   font->setStyleHint(QFont::Monospace);
   font->setFixedPitch(true);
   font->setPointSize(11);
 
-  textEdit->setFont(*font);
   metrics = new QFontMetrics(*font);
-  textEdit->setTabStopDistance(tabStop * metrics->horizontalAdvance(' '));
-  fv = new FileView("kek.cpp");
-
+  tab_bar = new QTabBar;
+  documents = new DocumentManager(this);
+  connect(documents, &DocumentManager::materialized, this,
+          &MainWindow::connectDocument);
+  connect(documents, &DocumentManager::changedOnDisk, this,
+          &MainWindow::fileChangedOnDisk);
+  saver = new FileSaver(this);
+  connect(saver, &FileSaver::saved, this, &MainWindow::saveFinished);
+  qint64 start = startup_trace::Now();
+  current_tab = documents->add(QString());
+  document = documents->materialize(current_tab, nullptr);
+  startup_trace::Record("first document", start);
+
+  start = startup_trace::Now();
   createStatusBar();
   createActions();
 
-  connect(textEdit->document(), &QTextDocument::contentsChanged, this,
-          &MainWindow::documentWasModified);
-
-  setCurrentFile(QString(), textEdit);
-
   central_widget = new QWidget();
   grid_layout = new QGridLayout(central_widget);
 
@@ -73,7 +115,7 @@ MainWindow::MainWindow(QWidget *parent)
   WidgetPlacer term = {1, 0, 3, 6};
   grid_layout->addWidget(&directory_tree.tree, dir_tr.row, dir_tr.col,
                          dir_tr.row_span, dir_tr.col_span);
-  grid_layout->addWidget(display_failure_log, disp.row, disp.col, disp.row_span,
+  grid_layout->addWidget(diagnostics_view, disp.row, disp.col, disp.row_span,
                          disp.col_span);
   grid_layout->addWidget(terminal, term.row, term.col, term.row_span,
                          term.col_span);
@@ -83,161 +125,504 @@ MainWindow::MainWindow(QWidget *parent)
     grid_layout->setRowStretch(i, stretch_for_col[i]);
 
   splitter = new QSplitter(centralWidget());
-  splitter->addWidget(textEdit);
+  completer = createCompleter();
+  Editor *first = createPane(nullptr);
   stretch_for_col = {0, 10};
   for (std::size_t i = 0; i < stretch_for_col.size(); ++i)
     splitter->setStretchFactor(i, stretch_for_col[i]);
 
+  QWidget *editor_area = new QWidget;
+  QVBoxLayout *editor_layout = new QVBoxLayout(editor_area);
+  editor_layout->setContentsMargins(0, 0, 0, 0);
+  editor_layout->setSpacing(0);
+  editor_layout->addWidget(tab_bar);
+  editor_layout->addWidget(splitter);
+  editor_layout->addWidget(search_bar);
+  search_bar->hide();
+
   WidgetPlacer splt = {0, 2, 1, 11};
-  grid_layout->addWidget(splitter, splt.row, splt.col, splt.row_span,
+  grid_layout->addWidget(editor_area, splt.row, splt.col, splt.row_span,
                          splt.col_span);
   central_widget->setLayout(grid_layout);
   setCentralWidget(central_widget);
 
-  connect(textEdit, &Editor::cursorPositionChanged, this,
-          &MainWindow::showCursorPosition);
   connect(&directory_tree.tree, &QTreeView::clicked, this,
           &MainWindow::tree_clicked);
 
-  display_failure_log->setReadOnly(true);
-  QStringList stringList;
-  stringList << "m0"
-             << "m1"
-             << "m2";
-  QStringListModel *model = new QStringListModel(stringList);
-  completer = new QCompleter(model, this);
-  completer->setModelSorting(QCompleter::CaseInsensitivelySortedModel);
-  completer->setCaseSensitivity(Qt::CaseInsensitive);
-  completer->setWrapAround(false);
-  textEdit->setCompleter(completer);
+  diagnostics_view->setModel(diagnostics_model);
+  diagnostics_view->setHeaderHidden(true);
+  diagnostics_view->setUniformRowHeights(true);
+  diagnostics_view->setEditTriggers(QAbstractItemView::NoEditTriggers);
+  connect(diagnostics_model, &QAbstractItemModel::rowsInserted, this,
+          [this](const QModelIndex &parent, int first, int last) {
+            // files show up expanded
+            if (parent.isValid()) return;
+            for (int row = first; row <= last; ++row) {
+              diagnostics_view->expand(diagnostics_model->index(row, 0));
+            }
+          });
+  connect(diagnostics_view, &QTreeView::activated, this,
+          &MainWindow::diagnosticActivated);
+  connect(diagnostics_view, &QTreeView::clicked, this,
+          &MainWindow::diagnosticActivated);
+
+  tab_bar->setTabsClosable(true);
+  tab_bar->setDocumentMode(true);
+  tab_bar->setExpanding(false);
+  tab_bar->setElideMode(Qt::ElideMiddle);
+  tab_bar->setUsesScrollButtons(true);
+  tab_bar->addTab(QString());
+  updateTab(current_tab);
+  setCurrentFile(QString());
+  connect(tab_bar, &QTabBar::currentChanged, this, &MainWindow::tabChanged);
+  connect(tab_bar, &QTabBar::tabCloseRequested, this, &MainWindow::closeTab);
+
+  workspace_watcher = new workspace::Watcher(this);
+  symbol_index = new SymbolIndex(workspace_watcher, this);
+  symbol_palette = new SymbolPalette(symbol_index, document->fileView(), this);
+  connect(symbol_palette, &SymbolPalette::symbolChosen, this,
+          &MainWindow::openLocation);
+
+  path_index = new PathIndex(workspace_watcher, this);
+  quick_open = new QuickOpen(path_index, this);
+  connect(quick_open, &QuickOpen::fileChosen, this, &MainWindow::loadFile);
+
+  find_in_files = new FindInFiles;
+  find_dock = new QDockWidget(tr("Find in Files"), this);
+  find_dock->setWidget(find_in_files);
+  addDockWidget(Qt::BottomDockWidgetArea, find_dock);
+  find_dock->hide();
+  connect(find_in_files, &FindInFiles::locationChosen, this,
+          &MainWindow::openLocation);
+
+  build_panel = new BuildPanel;
+  build_dock = new QDockWidget(tr("Build"), this);
+  build_dock->setWidget(build_panel);
+  addDockWidget(Qt::BottomDockWidgetArea, build_dock);
+  tabifyDockWidget(find_dock, build_dock);
+  build_dock->hide();
+  connect(build_panel, &BuildPanel::locationChosen, this,
+          &MainWindow::goToLocation);
+  connect(build_panel, &BuildPanel::diagnosticsChanged, this,
+          &MainWindow::showBuildDiagnostics);
+
+  references_panel = new ReferencesPanel;
+  references_dock = new QDockWidget(tr("References"), this);
+  references_dock->setWidget(references_panel);
+  references_panel->setDocuments(documents);
+  addDockWidget(Qt::BottomDockWidgetArea, references_dock);
+  tabifyDockWidget(find_dock, references_dock);
+  references_dock->hide();
+  connect(references_panel, &ReferencesPanel::locationChosen, this,
+          &MainWindow::goToLocation);
+  startup_trace::Record("ui setup", start);
+
+  start = startup_trace::Now();
+  readSettings();
+  startup_trace::Record("session restore", start);
+  // the indices start from their caches of the restored root
+  start = startup_trace::Now();
+  symbol_index->setRoot(directory_tree.root_path());
+  path_index->setRoot(directory_tree.root_path());
+  find_in_files->setRoot(directory_tree.root_path());
+  references_panel->setRoot(directory_tree.root_path());
+  startup_trace::Record("index roots", start);
+
+  activeEditor()->setFocus();
+  first->viewport()->installEventFilter(this);
+  if (startup_trace::IsEnabled()) qApp->installEventFilter(this);
+  // a window which is never painted, e.g. minimized, still gets them
+  const int SERVICES_DELAY_MS = 1000;
+  QTimer::singleShot(SERVICES_DELAY_MS, this, &MainWindow::startServices);
+  // the questions are asked once the window is up
+  QTimer::singleShot(0, this, &MainWindow::recoverJournals);
+}
 
-  connect(textEdit, &Editor::changeContent, fv, &FileView::UploadContent);
+bool MainWindow::eventFilter(QObject *watched, QEvent *event) {
+  if (event->type() == QEvent::Paint && !services_started &&
+      watched == panes.first()->viewport()) {
+    startup_trace::Mark("first paint");
+    // the shell and the servers are spawned after this paint reached the
+    // screen
+    QTimer::singleShot(0, this, &MainWindow::startServices);
+  } else if (event->type() == QEvent::KeyPress && !typed) {
+    typed = true;
+    qApp->removeEventFilter(this);
+    startup_trace::Mark("first keystroke");
+  }
+  return QMainWindow::eventFilter(watched, event);
+}
 
-  connect(textEdit, &Editor::changeCursor, fv, &FileView::ChangeCursor);
+void MainWindow::startServices() {
+  if (services_started) return;
+  services_started = true;
+  panes.first()->viewport()->removeEventFilter(this);
+  terminal->start();
+  lsp::Client::ReleaseLaunches();
+  startup_trace::Mark("services started");
+}
 
-  connect(fv, &FileView::DoneDiagnostic, this, &MainWindow::display_failure);
+void MainWindow::readSettings() {
+  QSettings settings(SETTINGS_ORGANIZATION, SETTINGS_APPLICATION);
+  if (!restoreGeometry(settings.value("geometry").toByteArray())) {
+    setWindowState(Qt::WindowMaximized);
+  }
+  QString root = settings.value("root").toString();
+  if (!root.isEmpty() && QFileInfo(root).isDir()) {
+    directory_tree.dir_name = root;
+    directory_tree.set_root_path();
+  }
 
-  connect(fv, &FileView::DoneCompletion, this,
-          &MainWindow::displayAutocompleteOptions);
+  // the tabs stay dormant, only the current one is read now
+  int current = settings.value("currentTab", -1).toInt();
+  int restored = -1;
+  int size = settings.beginReadArray("tabs");
+  for (int i = 0; i < size; ++i) {
+    settings.setArrayIndex(i);
+    QString fileName = settings.value("file").toString();
+    if (!QFileInfo(fileName).isFile() || documents->indexOf(fileName) >= 0) {
+      continue;
+    }
+    int index = documents->add(fileName);
+    tab_bar->addTab(QString());
+    updateTab(index);
+    documents->setViewState(index, {settings.value("position").toInt(),
+                                    settings.value("anchor").toInt(),
+                                    settings.value("scroll").toInt()});
+    if (i == current || restored < 0) restored = index;
+  }
+  settings.endArray();
+  if (restored < 0) return;
+
+  int pane_count = settings.value("panes", 1).toInt();
+  while (panes.size() < pane_count) createPane(panes.first());
+  splitter->restoreState(settings.value("splitter").toByteArray());
+  tab_bar->setCurrentIndex(restored);
+  if (current_tab != restored) return;
+  // the untitled tab of a fresh start is not needed
+  closeTab(0);
+  // the scroll range is only known once the panes are laid out
+  QTimer::singleShot(0, this, [this]() {
+    for (Editor *pane : panes) {
+      restoreViewState(pane, documents->viewState(current_tab));
+    }
+  });
+}
 
-  this->setWindowState(Qt::WindowMaximized);
-  textEdit->setFocus();
+void MainWindow::writeSettings() {
+  QSettings settings(SETTINGS_ORGANIZATION, SETTINGS_APPLICATION);
+  settings.setValue("geometry", saveGeometry());
+  settings.setValue("root", directory_tree.root_path());
+  documents->setViewState(current_tab, viewStateOf(activeEditor()));
+  int current = -1;
+  int written = 0;
+  settings.beginWriteArray("tabs");
+  for (int i = 0; i < documents->count(); ++i) {
+    QString fileName = documents->fileName(i);
+    if (fileName.isEmpty()) continue;
+    if (i == current_tab) current = written;
+    const DocumentManager::ViewState &state = documents->viewState(i);
+    settings.setArrayIndex(written++);
+    settings.setValue("file", fileName);
+    settings.setValue("position", state.position);
+    settings.setValue("anchor", state.anchor);
+    settings.setValue("scroll", state.scroll);
+  }
+  settings.endArray();
+  settings.setValue("currentTab", current);
+  settings.setValue("panes", panes.size());
+  settings.setValue("splitter", splitter->saveState());
+}
+
+void MainWindow::recoverJournals() {
+  for (const QString &path : EditJournal::abandoned()) {
+    EditJournal::Recovery recovery;
+    if (!EditJournal::read(path, &recovery) || recovery.edits.empty()) {
+      EditJournal::discard(path);
+      continue;
+    }
+    QString name = recovery.file_name.isEmpty() ? tr("An untitled document")
+                                                : recovery.file_name;
+    QMessageBox::StandardButton answer = QMessageBox::question(
+        this, tr("Application"),
+        tr("%1 had unsaved changes when Baton stopped.\n"
+           "Recover them?")
+            .arg(name));
+    if (answer == QMessageBox::Yes) {
+      if (recovery.file_name.isEmpty()) {
+        newFile();
+      } else {
+        loadFile(recovery.file_name);
+      }
+      bool opened = documents->fileName(current_tab) == recovery.file_name;
+      if (!opened || !document->recover(recovery)) {
+        QMessageBox::warning(
+            this, tr("Application"),
+            tr("%1 cannot be opened or changed on disk, the unsaved "
+               "changes cannot be applied.")
+                .arg(name));
+      }
+    }
+    EditJournal::discard(path);
+  }
 }
 
 void MainWindow::closeEvent(QCloseEvent *event) {
-  if (maybeSave()) {
-    event->accept();
-  } else {
+  failed_saves = 0;
+  for (int i = 0; i < documents->count(); ++i) {
+    if (!documents->isModified(i)) continue;
+    tab_bar->setCurrentIndex(i);
+    if (!maybeSave()) {
+      event->ignore();
+      return;
+    }
+  }
+  // nothing is lost by closing while a save is still being written
+  saver->waitForDone();
+  if (failed_saves > 0) {
     event->ignore();
+    return;
   }
+  writeSettings();
+  event->accept();
 }
 
 void MainWindow::newFile() {
-  if (maybeSave()) {
-    textEdit->clear();
-    setCurrentFile(QString(), textEdit);
-  }
+  int index = documents->add(QString());
+  tab_bar->addTab(QString());
+  updateTab(index);
+  tab_bar->setCurrentIndex(index);
 }
 
 void MainWindow::open() {
-  if (maybeSave()) {
-    QString fileName = QFileDialog::getOpenFileName(this);
-    if (!fileName.isEmpty()) loadFile(fileName);
-  }
+  QString fileName = QFileDialog::getOpenFileName(this);
+  if (!fileName.isEmpty()) loadFile(fileName);
 }
 
-void MainWindow::choose_directory() {
-  directory_tree.dir_name = QFileDialog::getExistingDirectory(this);
-  directory_tree.set_root_path();
+void MainWindow::tabChanged(int index) {
+  if (index < 0 || index == current_tab) return;
+  QString error;
+  Document *next = documents->materialize(index, &error);
+  if (next == nullptr) {
+    QMessageBox::warning(this, tr("Application"), error);
+    tab_bar->setCurrentIndex(current_tab);
+    return;
+  }
+
+  documents->setViewState(current_tab, viewStateOf(activeEditor()));
+  if (search_bar->isVisible()) search_bar->closeBar();
+  current_tab = index;
+  document = next;
+  const DocumentManager::ViewState &state = documents->viewState(index);
+  for (Editor *pane : panes) {
+    pane->setDocument(next->textDocument());
+    pane->setMarkers(next->markers());
+    pane->setLineMarkers(next->buildMarkers());
+    restoreViewState(pane, state);
+  }
+  // the previous document is off screen now and may be released
+  documents->releaseUnused();
+
+  symbol_palette->setServer(next->fileView());
+  updateTab(index);
+  QString shownName = documents->fileName(index);
+  if (shownName.isEmpty()) shownName = "untitled.txt";
+  setWindowFilePath(shownName);
+  activeEditor()->setFocus();
 }
 
-bool MainWindow::save() {
-  QString filename =
-      (textEdit->curFile.isEmpty()) ? "untitled.cpp" : textEdit->curFile;
-  QString splittedFilename = (splittedTextEdit->curFile.isEmpty())
-                                 ? "untitled.cpp"
-                                 : splittedTextEdit->curFile;
-  QMessageBox msgBox;
-  msgBox.setText(tr("Which file would you like to save?"));
-  QAbstractButton *pButtonEdit = msgBox.addButton(
-      tr(filename.toStdString().c_str()), QMessageBox::YesRole);
-  msgBox.addButton(tr(splittedFilename.toStdString().c_str()),
-                   QMessageBox::NoRole);
-  msgBox.exec();
-  if (msgBox.clickedButton() == pButtonEdit) {
-    if (textEdit->curFile.isEmpty()) {
-      return saveAs();
-    } else {
-      return saveFile(textEdit->curFile, textEdit);
-    }
-  } else {
-    if (splittedTextEdit->curFile.isEmpty()) {
-      return saveAs();
+void MainWindow::closeTab(int index) {
+  if (documents->isModified(index)) {
+    tab_bar->setCurrentIndex(index);
+    if (!maybeSave()) return;
+  }
+  if (index == current_tab) {
+    // the panes move to another document before this one goes away
+    if (documents->count() == 1) {
+      newFile();
     } else {
-      return saveFile(splittedTextEdit->curFile, splittedTextEdit);
+      tab_bar->setCurrentIndex(index + 1 < documents->count() ? index + 1
+                                                              : index - 1);
     }
+    if (current_tab == index) return;
   }
+  if (index < current_tab) --current_tab;
+  documents->remove(index);
+  tab_bar->removeTab(index);
 }
 
-void MainWindow::split() {
-  if (!splitted) {
-    splitted = true;
-    splittedTextEdit = new Editor(textEdit->fontSize);
-
-    QStringList stringList;
-    stringList << "m0"
-               << "m1"
-               << "m2";
-    QStringListModel *model = new QStringListModel(stringList);
-    splittedCompleter = new QCompleter(model, this);
-    splittedCompleter->setModelSorting(
-        QCompleter::CaseInsensitivelySortedModel);
-    splittedCompleter->setCaseSensitivity(Qt::CaseInsensitive);
-    splittedCompleter->setWrapAround(false);
-
-    splittedTextEdit->setCompleter(splittedCompleter);
-
-    splitter->addWidget(splittedTextEdit);
-
-    const int IND = 2;
-    const int STRETCH_FACTOR = 1;
-    splitter->setStretchFactor(IND, STRETCH_FACTOR);
-    fv_split = new FileView("lol.cpp");
-
-    connect(splittedTextEdit, &Editor::changeContent, fv_split,
-            &FileView::UploadContent);
-
-    connect(splittedTextEdit, &Editor::changeCursor, fv_split,
-            &FileView::ChangeCursor);
-
-    connect(fv_split, &FileView::DoneCompletion, this,
-            &MainWindow::displayAutocompleteOptionsSplit);
-
-    connect(fv_split, &FileView::DoneDiagnostic, this,
-            &MainWindow::display_failure);
+void MainWindow::connectDocument(Document *doc) {
+  // completions for a document in the background are dropped, diagnostics
+  // of every open document are listed
+  FileView *view = doc->fileView();
+  setBuildMarkers(doc);
+  connect(view, &FileView::DoneDiagnostic, this,
+          [this, doc](const std::vector<lsp::DiagnosticsResponse> &resp) {
+            showDiagnostics(doc, resp);
+          });
+  connect(doc, &QObject::destroyed, this, [this, doc]() {
+    diagnostics_model->removeFile(diagnosticsKey(doc));
+    if (references_document == doc) references_document = nullptr;
+  });
+  connect(view, &FileView::DoneTriggerCharacters, this,
+          [this](const std::vector<std::string> &characters) {
+            trigger_characters.clear();
+            for (const std::string &character : characters) {
+              trigger_characters.append(QString::fromStdString(character));
+            }
+            for (Editor *pane : panes) {
+              pane->setTriggerCharacters(trigger_characters);
+            }
+          });
+  connect(view, &FileView::DoneHover, this,
+          [this, doc](int line, int col, const std::string &text) {
+            if (doc != document) return;
+            for (Editor *pane : panes) {
+              pane->showHover(line, col, QString::fromStdString(text));
+            }
+          });
+  connect(view, &FileView::DoneSignatureHelp, this,
+          [this, doc](int line, int col, const lsp::SignatureHelp &help) {
+            if (doc != document) return;
+            for (Editor *pane : panes) pane->showSignatureHelp(line, col, help);
+          });
+  connect(view, &FileView::DoneDefinition, this,
+          [this, doc](const std::vector<lsp::Location> &locations) {
+            if (doc != document) return;
+            const int TIME_OUT_MS = 2000;
+            if (locations.empty()) {
+              statusBar()->showMessage(tr("No definition found"), TIME_OUT_MS);
+            } else if (locations.size() == 1) {
+              const lsp::Location &location = locations.front();
+              goToLocation(
+                  QUrl(QString::fromStdString(location.uri)).toLocalFile(),
+                  location.range.start.line, location.range.start.character);
+            } else {
+              references_document = nullptr;
+              references_panel->start(tr("definitions"));
+              references_panel->addLocations(locations, true);
+              references_dock->show();
+              references_dock->raise();
+            }
+          });
+  connect(view, &FileView::DoneReferences, this,
+          [this, doc](const std::vector<lsp::Location> &locations,
+                      bool finished) {
+            if (doc != references_document) return;
+            references_panel->addLocations(locations, finished);
+            if (finished) references_document = nullptr;
+          });
+  connect(view, &FileView::DoneCompletion, this,
+          [this, doc](const std::vector<lsp::CompletionItem> &items) {
+            if (doc == document) displayAutocompleteOptions(items);
+          });
+  connect(view, &FileView::DoneCompletionResolve, this,
+          [this, doc](std::size_t row, const lsp::CompletionItem &item) {
+            if (doc != document) return;
+            static_cast<CompletionModel *>(completer->model())
+                ->setResolved(row, item);
+            QString summary = QString::fromStdString(item.documentation)
+                                  .section('\n', 0, 0);
+            if (!summary.isEmpty()) {
+              const int TIME_OUT_MS = 5000;
+              statusBar()->showMessage(summary, TIME_OUT_MS);
+            }
+          });
+  connect(doc->textDocument(), &QTextDocument::modificationChanged, this,
+          [this, doc]() { updateTab(documents->indexOf(doc)); });
+}
 
-    splittedTextEdit->setTabStopDistance(tabStop *
-                                         metrics->horizontalAdvance(' '));
+void MainWindow::updateTab(int index) {
+  if (index < 0) return;
+  QString name = documents->fileName(index);
+  QString title = name.isEmpty() ? tr("untitled") : strippedName(name);
+  if (documents->isModified(index)) title += "*";
+  tab_bar->setTabText(index, title);
+  tab_bar->setTabToolTip(index, name);
+  if (index != current_tab) return;
+  setWindowModified(documents->isModified(index));
+  format_label->setText(text_format::Describe(document->format()));
+}
 
-    connect(splittedTextEdit, &Editor::cursorPositionChanged, this,
-            &MainWindow::showCursorPositionOnSplitted);
+void MainWindow::choose_directory() {
+  directory_tree.dir_name = QFileDialog::getExistingDirectory(this);
+  directory_tree.set_root_path();
+  symbol_index->setRoot(directory_tree.root_path());
+  path_index->setRoot(directory_tree.root_path());
+  find_in_files->setRoot(directory_tree.root_path());
+  references_panel->setRoot(directory_tree.root_path());
+}
 
-    splittedTextEdit->setFont(*font);
-  } else {
-    disconnect(splittedTextEdit, &Editor::changeContent, fv_split,
-               &FileView::UploadContent);
+bool MainWindow::save() {
+  if (document->fileName().isEmpty()) return saveAs();
+  return saveFile(document->fileName());
+}
 
-    disconnect(splittedTextEdit, &Editor::changeCursor, fv_split,
-               &FileView::ChangeCursor);
+Editor *MainWindow::createPane(Editor *source) {
+  Editor *pane = new Editor(document->textDocument());
+  pane->setMarkers(document->markers());
+  pane->setLineMarkers(document->buildMarkers());
+  pane->setFont(*font);
+  pane->setTabStopDistance(tabStop * metrics->horizontalAdvance(' '));
+  pane->setCompleter(completer);
+
+  // every pane follows edits made in the others, only the focused one asks
+  // for completions
+  if (!trigger_characters.isEmpty()) {
+    pane->setTriggerCharacters(trigger_characters);
+  }
+  connect(pane, &Editor::completionRequested, this,
+          [this, pane](int line, int col, const QString &trigger,
+                       bool extending) {
+            if (!pane->hasFocus()) return;
+            document->fileView()->RequestCompletion(
+                line, col, trigger.toStdString(), extending);
+          });
+  connect(pane, &Editor::hoverRequested, this, [this](int line, int col) {
+    document->fileView()->RequestHover(line, col);
+  });
+  connect(pane, &Editor::hoverCancelled, this,
+          [this]() { document->fileView()->CancelHover(); });
+  connect(pane, &Editor::signatureHelpRequested, this,
+          [this](int line, int col) {
+            document->fileView()->RequestSignatureHelp(line, col);
+          });
+  connect(pane, &Editor::signatureHelpCancelled, this,
+          [this]() { document->fileView()->CancelSignatureHelp(); });
+  connect(pane, &Editor::cursorPositionChanged, this,
+          [this, pane]() { showCursorPosition(pane); });
+
+  if (source != nullptr) {
+    pane->fontSize = source->fontSize;
+    pane->setTextCursor(source->textCursor());
+    pane->verticalScrollBar()->setValue(source->verticalScrollBar()->value());
+  }
+  panes.append(pane);
+  splitter->addWidget(pane);
+  return pane;
+}
 
-    disconnect(fv_split, &FileView::DoneDiagnostic, this,
-               &MainWindow::display_failure);
+void MainWindow::split() {
+  Editor *source = activeEditor();
+  Editor *pane = createPane(source);
 
-    delete fv_split;
-    fv_split = nullptr;
-    splitted = false;
-    delete splitter->widget(1);
+  QList<int> sizes;
+  for (int i = 0; i < panes.size(); ++i) {
+    sizes.append(splitter->width() / panes.size());
   }
+  splitter->setSizes(sizes);
+  pane->setFocus();
+  // the scroll range of the new pane is only known once it is laid out
+  pane->verticalScrollBar()->setValue(source->verticalScrollBar()->value());
+}
+
+void MainWindow::closePane() {
+  if (panes.size() < 2) return;
+  Editor *pane = activeEditor();
+  panes.removeOne(pane);
+  if (completer->widget() == pane) completer->setWidget(panes.first());
+  delete pane;
+  panes.first()->setFocus();
 }
 
 void MainWindow::textSize(const QString &p) {
@@ -245,70 +630,37 @@ void MainWindow::textSize(const QString &p) {
   if (p.toFloat() > 0) {
     QTextCharFormat fmt;
     fmt.setFontPointSize(pointSize);
-    textEdit->fontSize = pointSize;
-    textEdit->repaint();
-    if (splitted) {
-      splittedTextEdit->fontSize = pointSize;
-      splittedTextEdit->repaint();
+    for (Editor *pane : panes) {
+      pane->fontSize = pointSize;
+      pane->repaint();
     }
     mergeFormatOnWordOrSelection(fmt);
   }
 }
 
 void MainWindow::mergeFormatOnWordOrSelection(const QTextCharFormat &format) {
-  QTextCursor cursor = textEdit->textCursor();
-  textEdit->selectAll();
+  // the format lands in the shared document, so one pane is enough
+  Editor *pane = activeEditor();
+  QTextCursor cursor = pane->textCursor();
+  pane->selectAll();
   cursor.select(QTextCursor::WordUnderCursor);
   cursor.mergeCharFormat(format);
-  textEdit->mergeCurrentCharFormat(format);
+  pane->mergeCurrentCharFormat(format);
   cursor.movePosition(QTextCursor::End);
-  textEdit->setTextCursor(cursor);
-
-  if (splitted) {
-    QTextCursor splitCursor = splittedTextEdit->textCursor();
-    splittedTextEdit->repaint();
-    splittedTextEdit->selectAll();
-    splitCursor.mergeCharFormat(format);
-    splittedTextEdit->mergeCurrentCharFormat(format);
-    splitCursor.movePosition(QTextCursor::End);
-    splittedTextEdit->setTextCursor(splitCursor);
-  }
+  pane->setTextCursor(cursor);
 }
 
 bool MainWindow::saveAs() {
-  if (splitted) {
-    QString filename = (textEdit->curFile.isEmpty()) ? "untitled(left).cpp"
-                                                     : textEdit->curFile;
-    QString splittedFilename = (splittedTextEdit->curFile.isEmpty())
-                                   ? "untitled(right).cpp"
-                                   : splittedTextEdit->curFile;
-    QMessageBox msgBox;
-    msgBox.setText(tr("Which file would you like to save?"));
-    QAbstractButton *pButtonEdit = msgBox.addButton(
-        tr(filename.toStdString().c_str()), QMessageBox::YesRole);
-    msgBox.addButton(tr(splittedFilename.toStdString().c_str()),
-                     QMessageBox::NoRole);
-    msgBox.exec();
-    QFileDialog dialog(this);
-    dialog.setWindowModality(Qt::WindowModal);
-    dialog.setAcceptMode(QFileDialog::AcceptSave);
-    if (dialog.exec() != QDialog::Accepted) return false;
-    if (msgBox.clickedButton() != pButtonEdit) {
-      return saveFile(dialog.selectedFiles().first(), splittedTextEdit);
-    } else {
-      return saveFile(dialog.selectedFiles().first(), textEdit);
-    }
-  }
+  QString fileName = askFileName();
+  return !fileName.isEmpty() && saveFile(fileName);
+}
+
+QString MainWindow::askFileName() {
   QFileDialog dialog(this);
   dialog.setWindowModality(Qt::WindowModal);
   dialog.setAcceptMode(QFileDialog::AcceptSave);
-  if (dialog.exec() != QDialog::Accepted) return false;
-  return saveFile(dialog.selectedFiles().first(), textEdit);
-}
-
-void MainWindow::documentWasModified() {
-  setWindowTitle(tr("Baton Editor[*]"));
-  setWindowModified(textEdit->document()->isModified());
+  if (dialog.exec() != QDialog::Accepted) return QString();
+  return dialog.selectedFiles().first();
 }
 
 void MainWindow::createActions() {
@@ -326,16 +678,115 @@ void MainWindow::createActions() {
   connect(openAct, &QAction::triggered, this, &MainWindow::open);
   fileMenu->addAction(openAct);
 
+  QAction *closeTabAct = fileMenu->addAction(
+      tr("&Close Tab"), this, [this]() { closeTab(current_tab); });
+  closeTabAct->setShortcuts(QKeySequence::Close);
+  closeTabAct->setStatusTip(tr("Close the current file"));
+
+  QAction *saveAct = fileMenu->addAction(tr("&Save"), this, &MainWindow::save);
+  saveAct->setShortcuts(QKeySequence::Save);
+  saveAct->setStatusTip(tr("Save the document to disk"));
+
   QAction *saveAsAct =
       fileMenu->addAction(tr("Save &As..."), this, &MainWindow::saveAs);
   saveAsAct->setShortcuts(QKeySequence::SaveAs);
   saveAsAct->setStatusTip(tr("Save the document under a new name"));
 
+  QAction *saveAllAct =
+      fileMenu->addAction(tr("Save A&ll"), this, &MainWindow::saveAll);
+  saveAllAct->setShortcut(Qt::CTRL + Qt::ALT + Qt::Key_S);
+  saveAllAct->setStatusTip(tr("Save every modified document"));
+
+  QAction *syncAct = fileMenu->addAction(tr("S&ync Saves to Disk"));
+  syncAct->setCheckable(true);
+  syncAct->setChecked(true);
+  syncAct->setStatusTip(
+      tr("Wait for the disk on every save, so a system crash cannot lose it"));
+  connect(syncAct, &QAction::toggled, saver, &FileSaver::setSync);
+
   QAction *set_root_directory = fileMenu->addAction(
       tr("&Set root directory..."), this, &MainWindow::choose_directory);
   set_root_directory->setStatusTip(
       tr("Choose the directory which will be shown in directory tree"));
 
+  QMenu *editMenu = menuBar()->addMenu(tr("&Edit"));
+  QAction *findAct =
+      editMenu->addAction(tr("&Find..."), this, &MainWindow::find);
+  findAct->setShortcuts(QKeySequence::Find);
+  findAct->setStatusTip(tr("Search in the current file"));
+
+  QAction *replaceAct =
+      editMenu->addAction(tr("&Replace..."), this, &MainWindow::replace);
+  replaceAct->setShortcut(Qt::CTRL + Qt::Key_H);
+  replaceAct->setStatusTip(tr("Replace text in the current file"));
+
+  QAction *findNextAct = editMenu->addAction(tr("Find &Next"), search_bar,
+                                             &SearchBar::findNext);
+  findNextAct->setShortcuts(QKeySequence::FindNext);
+
+  QAction *findPreviousAct = editMenu->addAction(
+      tr("Find &Previous"), search_bar, &SearchBar::findPrevious);
+  findPreviousAct->setShortcuts(QKeySequence::FindPrevious);
+  editMenu->addSeparator();
+
+  QAction *findInFilesAct = editMenu->addAction(tr("Find in &Files..."), this,
+                                                &MainWindow::findInFiles);
+  findInFilesAct->setShortcut(Qt::CTRL + Qt::SHIFT + Qt::Key_F);
+  findInFilesAct->setStatusTip(tr("Search all files of the root directory"));
+
+  QMenu *goMenu = menuBar()->addMenu(tr("&Go"));
+  QAction *goToSymbolAct =
+      goMenu->addAction(tr("Go to &Symbol..."), this, &MainWindow::goToSymbol);
+  goToSymbolAct->setShortcut(Qt::CTRL + Qt::Key_T);
+  goToSymbolAct->setStatusTip(
+      tr("Jump to a class, function or macro defined in the project"));
+  QAction *goToFileAct =
+      goMenu->addAction(tr("Go to &File..."), this, &MainWindow::goToFile);
+  goToFileAct->setShortcut(Qt::CTRL + Qt::Key_P);
+  goToFileAct->setStatusTip(tr("Open a file of the project by its name"));
+
+  goMenu->addSeparator();
+  QAction *goToDefinitionAct = goMenu->addAction(
+      tr("Go to &Definition"), this, &MainWindow::goToDefinition);
+  goToDefinitionAct->setShortcut(Qt::Key_F12);
+  goToDefinitionAct->setStatusTip(
+      tr("Jump to the definition of the symbol under the cursor"));
+  QAction *findReferencesAct = goMenu->addAction(
+      tr("Find &References"), this, &MainWindow::findReferences);
+  findReferencesAct->setShortcut(Qt::SHIFT + Qt::Key_F12);
+  findReferencesAct->setStatusTip(
+      tr("List every use of the symbol under the cursor"));
+  goMenu->addSeparator();
+  QAction *nextTabAct = goMenu->addAction(tr("&Next Tab"), this, [this]() {
+    tab_bar->setCurrentIndex((current_tab + 1) % documents->count());
+  });
+  nextTabAct->setShortcuts(QKeySequence::NextChild);
+  QAction *previousTabAct =
+      goMenu->addAction(tr("&Previous Tab"), this, [this]() {
+        int count = documents->count();
+        tab_bar->setCurrentIndex((current_tab + count - 1) % count);
+      });
+  previousTabAct->setShortcuts(QKeySequence::PreviousChild);
+
+  QMenu *buildMenu = menuBar()->addMenu(tr("&Build"));
+  QAction *buildAct =
+      buildMenu->addAction(tr("&Build"), this, &MainWindow::build);
+  buildAct->setShortcut(Qt::CTRL + Qt::Key_B);
+  buildAct->setStatusTip(tr("Save every document and run the build command"));
+  // the panel is created after the actions
+  buildMenu->addAction(tr("&Stop Build"), this,
+                       [this]() { build_panel->stop(); });
+  buildMenu->addAction(tr("Set Build &Command..."), this,
+                       &MainWindow::setBuildCommand);
+  buildMenu->addSeparator();
+  QAction *nextProblemAct = buildMenu->addAction(
+      tr("&Next Problem"), this, [this]() { build_panel->goToProblem(1); });
+  nextProblemAct->setShortcut(Qt::Key_F4);
+  QAction *previousProblemAct =
+      buildMenu->addAction(tr("&Previous Problem"), this,
+                           [this]() { build_panel->goToProblem(-1); });
+  previousProblemAct->setShortcut(Qt::SHIFT + Qt::Key_F4);
+
   tb = addToolBar(tr("Format Actions"));
   tb->setAllowedAreas(Qt::TopToolBarArea | Qt::BottomToolBarArea);
   addToolBarBreak(Qt::TopToolBarArea);
@@ -360,26 +811,35 @@ void MainWindow::createActions() {
   splitAct->setStatusTip("Split right");
   connect(splitAct, &QAction::triggered, this, &MainWindow::split);
   tb->addAction(splitAct);
+
+  QAction *closePaneAct = new QAction(tr("Close pane"), this);
+  closePaneAct->setStatusTip(tr("Close the focused split pane"));
+  connect(closePaneAct, &QAction::triggered, this, &MainWindow::closePane);
+  tb->addAction(closePaneAct);
 }
 
 MainWindow::~MainWindow() {
+  // the panes go before the document they show
+  qDeleteAll(panes);
   delete ui;
-  delete fv;
-  delete fv_split;
   delete terminal;
   delete font;
 }
 
 bool MainWindow::maybeSave() {
-  if (!textEdit->document()->isModified()) return true;
+  if (!document->textDocument()->isModified()) return true;
   const QMessageBox::StandardButton ret = QMessageBox::warning(
       this, tr("Application"),
       tr("В документе есть не сохранённые изменения.\n"
          "Сохранить?"),
       QMessageBox::Save | QMessageBox::Discard | QMessageBox::Cancel);
   switch (ret) {
-    case QMessageBox::Save:
-      return save();
+    case QMessageBox::Save: {
+      // the document may be closed next, so the write has to be committed
+      QString fileName = document->fileName();
+      if (fileName.isEmpty()) fileName = askFileName();
+      return !fileName.isEmpty() && saveFile(fileName, true);
+    }
     case QMessageBox::Cancel:
       return false;
     default:
@@ -389,83 +849,283 @@ bool MainWindow::maybeSave() {
 }
 
 void MainWindow::loadFile(const QString &fileName) {
-  static QString good_suf[] = {".h", ".c", ".cpp", ".hpp", ".cc"};
-  if (std::none_of(
-          std::begin(good_suf), std::end(good_suf),
-          [&fileName](const auto &str) { return fileName.contains(str); })) {
-    fv->SetValidity(false);
-  } else {
-    fv->SetValidity(true);
-  }
-
-  QFile file(fileName);
-  if (!file.open(QFile::ReadOnly | QFile::Text)) {
-    QMessageBox::warning(
-        this, tr("Application"),
-        tr("Cannot read file %1:\n%2.")
-            .arg(QDir::toNativeSeparators(fileName), file.errorString()));
-    return;
+  int index = documents->indexOf(fileName);
+  bool added = index < 0;
+  if (added) {
+    index = documents->add(fileName);
+    tab_bar->addTab(QString());
+    updateTab(index);
   }
-  QTextStream in(&file);
 #ifndef QT_NO_CURSOR
   QGuiApplication::setOverrideCursor(Qt::WaitCursor);
 #endif
-  textEdit->setPlainText(in.readAll());
+  tab_bar->setCurrentIndex(index);
 #ifndef QT_NO_CURSOR
   QGuiApplication::restoreOverrideCursor();
 #endif
-
-  setCurrentFile(fileName, textEdit);
+  if (current_tab != index) {
+    // the file could not be read
+    if (added) {
+      documents->remove(index);
+      tab_bar->removeTab(index);
+    }
+    return;
+  }
   const int TIME_OUT_MS = 2000;
   statusBar()->showMessage(tr("File loaded"), TIME_OUT_MS);
 }
 
 void MainWindow::tree_clicked(const QModelIndex &index) {
-  QFileInfo file_info = directory_tree.model.fileInfo(index);
-  if (file_info.isFile()) {
-    MainWindow::loadFile(file_info.filePath());
+  if (!directory_tree.model.isDir(index)) {
+    MainWindow::loadFile(directory_tree.model.filePath(index));
     return;
   }
 }
-void MainWindow::createStatusBar() { statusBar()->showMessage(tr("Ready")); }
+void MainWindow::find() { search_bar->activate(activeEditor(), false); }
 
-bool MainWindow::saveFile(const QString &fileName, Editor *editArea) {
-  QString errorMessage;
+void MainWindow::replace() { search_bar->activate(activeEditor(), true); }
 
-  QGuiApplication::setOverrideCursor(Qt::WaitCursor);
-  QSaveFile file(fileName);
-  if (file.open(QFile::WriteOnly | QFile::Text)) {
-    QTextStream out(&file);
-    out << editArea->toPlainText();
-    if (!file.commit()) {
-      errorMessage =
-          tr("Cannot write file %1:\n%2.")
-              .arg(QDir::toNativeSeparators(fileName), file.errorString());
-    }
+Editor *MainWindow::activeEditor() {
+  // the completer is moved to every pane that gets focus
+  Editor *pane = qobject_cast<Editor *>(completer->widget());
+  if (pane != nullptr && panes.contains(pane)) return pane;
+  return panes.first();
+}
+
+void MainWindow::goToSymbol() { symbol_palette->popup(); }
+
+void MainWindow::goToFile() { quick_open->popup(); }
+
+void MainWindow::findInFiles() {
+  find_dock->show();
+  find_dock->raise();
+  QString selected = activeEditor()->textCursor().selectedText();
+  // QTextCursor separates selected lines with U+2029
+  if (selected.contains(QChar::ParagraphSeparator)) selected.clear();
+  find_in_files->activate(selected);
+}
+
+void MainWindow::goToDefinition() {
+  QTextCursor cursor = activeEditor()->textCursor();
+  document->fileView()->RequestDefinition(cursor.blockNumber(),
+                                          cursor.positionInBlock());
+}
+
+void MainWindow::findReferences() {
+  QTextCursor cursor = activeEditor()->textCursor();
+  QTextCursor word = cursor;
+  word.select(QTextCursor::WordUnderCursor);
+  QString what = word.selectedText();
+  references_document = document;
+  references_panel->start(
+      what.isEmpty() ? tr("references") : tr("references to %1").arg(what));
+  references_dock->show();
+  references_dock->raise();
+  document->fileView()->RequestReferences(cursor.blockNumber(),
+                                          cursor.positionInBlock());
+}
+
+void MainWindow::openLocation(const QString &fileName, int line) {
+  goToLocation(fileName, line, 0);
+}
+
+void MainWindow::goToLocation(const QString &fileName, int line,
+                              int column) {
+  // an open file is only brought to front, its text is not read again
+  int index = documents->indexOf(fileName);
+  if (index >= 0) {
+    tab_bar->setCurrentIndex(index);
   } else {
-    errorMessage =
-        tr("Cannot open file %1 for writing:\n%2.")
-            .arg(QDir::toNativeSeparators(fileName), file.errorString());
+    loadFile(fileName);
   }
-  QGuiApplication::restoreOverrideCursor();
+  if (documents->indexOf(fileName) != current_tab) return;
+  showLocation(line, column);
+}
 
-  if (!errorMessage.isEmpty()) {
-    QMessageBox::warning(this, tr("Application"), errorMessage);
+void MainWindow::showLocation(int line, int column) {
+  Editor *pane = activeEditor();
+  QTextBlock block = document->textDocument()->findBlockByNumber(line);
+  QTextCursor cursor(block);
+  if (block.isValid()) {
+    cursor.setPosition(block.position() + qMin(column, block.length() - 1));
+  }
+  pane->setTextCursor(cursor);
+  pane->centerCursor();
+  pane->setFocus();
+}
+
+void MainWindow::build() {
+  if (build_panel->isRunning()) build_panel->stop();
+  saveAll();
+  // the compiler has to see what is on screen, the build starts once the
+  // last save is committed
+  if (!pending_saves.isEmpty()) {
+    build_pending = true;
+    return;
+  }
+  startBuild();
+}
+
+void MainWindow::startBuild() {
+  QSettings settings(SETTINGS_ORGANIZATION, SETTINGS_APPLICATION);
+  QString command =
+      settings.value("buildCommand", DEFAULT_BUILD_COMMAND).toString();
+  QString directory = directory_tree.root_path();
+  if (directory.isEmpty()) directory = QDir::currentPath();
+  build_dock->show();
+  build_dock->raise();
+  build_panel->build(command, directory);
+}
+
+void MainWindow::setBuildCommand() {
+  QSettings settings(SETTINGS_ORGANIZATION, SETTINGS_APPLICATION);
+  bool ok = false;
+  QString command = QInputDialog::getText(
+      this, tr("Build Command"),
+      tr("Command run by the shell in the root directory:"), QLineEdit::Normal,
+      settings.value("buildCommand", DEFAULT_BUILD_COMMAND).toString(), &ok);
+  if (ok && !command.trimmed().isEmpty()) {
+    settings.setValue("buildCommand", command);
+  }
+}
+
+void MainWindow::showBuildDiagnostics() {
+  QStringList files = build_panel->files();
+  QSet<QString> listed(files.begin(), files.end());
+  for (const QString &file : build_files) {
+    if (!listed.contains(file)) diagnostics_model->removeFile(BUILD_KEY + file);
+  }
+  build_files = listed;
+  for (const QString &file : files) {
+    diagnostics_model->setDiagnostics(
+        BUILD_KEY + file, file, fromBuild(build_panel->diagnosticsOf(file)),
+        tr("build"));
+  }
+  for (int i = 0; i < documents->count(); ++i) {
+    // dormant documents are marked when they are loaded
+    if (Document *doc = documents->document(i)) setBuildMarkers(doc);
+  }
+}
+
+void MainWindow::setBuildMarkers(Document *doc) {
+  // the lines are those of the saved text the build read, edits made since
+  // move the marks along
+  std::vector<lsp::DiagnosticsResponse> diagnostics;
+  if (!doc->fileName().isEmpty()) {
+    diagnostics = fromBuild(
+        build_panel->diagnosticsOf(QDir::cleanPath(doc->fileName())));
+  }
+  doc->buildMarkers()->setDiagnostics(diagnostics);
+}
+
+void MainWindow::createStatusBar() {
+  statusBar()->showMessage(tr("Ready"));
+  format_label = new QLabel;
+  statusBar()->addPermanentWidget(format_label);
+}
+
+bool MainWindow::saveFile(const QString &fileName, bool wait) {
+  int open = documents->indexOf(fileName);
+  if (open >= 0 && open != current_tab) {
+    QMessageBox::warning(this, tr("Application"),
+                         tr("%1 is already open in another tab.")
+                             .arg(QDir::toNativeSeparators(fileName)));
     return false;
   }
+  // the document keeps its name and stays modified until the write is
+  // committed, a failed Save As leaves it where it was
+  Document *doc = document;
+  startSave(doc, fileName);
+  if (!wait) return true;
+  saver->waitForFile(fileName);
+  // nothing can be typed meanwhile, so a failed write leaves it modified
+  return !doc->textDocument()->isModified();
+}
 
-  setCurrentFile(fileName, editArea);
-  return true;
+void MainWindow::startSave(Document *doc, const QString &fileName) {
+  // only the snapshot is taken here, encoding and writing happen on a worker
+  QString text = doc->textDocument()->toPlainText();
+  // a file that changes encoding says so instead of doing it silently, only
+  // Latin-1 files are looked at
+  text_format::Format format = text_format::EncodedAs(text, doc->format());
+  if (format.encoding != doc->format().encoding) {
+    doc->setFormat(format);
+    QMessageBox::warning(
+        this, tr("Application"),
+        tr("%1 holds characters ISO-8859-1 lacks and is saved as %2.")
+            .arg(QDir::toNativeSeparators(fileName),
+                 text_format::Describe(format)));
+    if (doc == document) {
+      format_label->setText(text_format::Describe(format));
+    }
+  }
+  int ticket = saver->save(fileName, text, format);
+  pending_saves.insert(ticket, {doc, doc->revision(), text.size()});
+}
+
+void MainWindow::saveAll() {
+  int started = 0;
+  for (int i = 0; i < documents->count(); ++i) {
+    // dormant tabs are never modified, untitled ones need a name first
+    if (!documents->isModified(i) || documents->fileName(i).isEmpty()) {
+      continue;
+    }
+    startSave(documents->document(i), documents->fileName(i));
+    ++started;
+  }
+  const int TIME_OUT_MS = 2000;
+  statusBar()->showMessage(tr("Saving %n file(s)", "", started), TIME_OUT_MS);
+}
+
+void MainWindow::saveFinished(int ticket, const QString &fileName,
+                              const QString &error,
+                              const QByteArray &digest) {
+  PendingSave pending = pending_saves.take(ticket);
+  if (build_pending && pending_saves.isEmpty()) {
+    // once this save is applied below, the build reads the new names
+    build_pending = false;
+    QTimer::singleShot(0, this, &MainWindow::startBuild);
+  }
+  if (!error.isEmpty()) {
+    ++failed_saves;
+    QMessageBox::warning(this, tr("Application"), error);
+    return;
+  }
+  const int TIME_OUT_MS = 2000;
+  statusBar()->showMessage(tr("Saved %1").arg(strippedName(fileName)),
+                           TIME_OUT_MS);
+  if (!pending.document) return;
+  // a Save As takes the new name now, unless a tab opened the file meanwhile
+  int index = documents->indexOf(pending.document.data());
+  if (index >= 0 && documents->indexOf(fileName) < 0) {
+    documents->setFileName(index, fileName);
+    updateTab(index);
+    if (index == current_tab) setWindowFilePath(fileName);
+  }
+  pending.document->saved(pending.revision, pending.length, digest);
 }
 
-void MainWindow::setCurrentFile(const QString &fileName, Editor *editArea) {
-  editArea->curFile = fileName;
+void MainWindow::fileChangedOnDisk(int index) {
+  // the tabs may change while the question is asked
+  QString fileName = documents->fileName(index);
+  QMessageBox::StandardButton answer = QMessageBox::question(
+      this, tr("Application"),
+      tr("%1 has been changed on disk.\n"
+         "Reload it? The unsaved changes can be undone afterwards.")
+          .arg(QDir::toNativeSeparators(fileName)));
+  index = documents->indexOf(fileName);
+  if (answer == QMessageBox::Yes && index >= 0) documents->reload(index);
+}
+
+void MainWindow::setCurrentFile(const QString &fileName) {
+  documents->setFileName(current_tab, fileName);
   setWindowTitle(tr("Baton Editor[*]"));
-  editArea->document()->setModified(false);
+  document->textDocument()->setModified(false);
   setWindowModified(false);
+  updateTab(current_tab);
 
-  QString shownName = curFile;
-  if (curFile.isEmpty()) shownName = "untitled.txt";
+  QString shownName = fileName;
+  if (fileName.isEmpty()) shownName = "untitled.txt";
   setWindowFilePath(shownName);
 }
 
@@ -482,61 +1142,69 @@ QString MainWindow::strippedName(const QString &fullFileName) {
   return QFileInfo(fullFileName).fileName();
 }
 
-void MainWindow::showCursorPosition() {
-  int line = textEdit->textCursor().blockNumber() + 1;
-  int column = textEdit->textCursor().columnNumber() + 1;
+void MainWindow::showCursorPosition(Editor *pane) {
+  int line = pane->textCursor().blockNumber() + 1;
+  int column = pane->textCursor().columnNumber() + 1;
   statusBar()->showMessage(QString("Line %1  Column %2").arg(line).arg(column));
 }
 
-void MainWindow::showCursorPositionOnSplitted() {
-  int line = splittedTextEdit->textCursor().blockNumber() + 1;
-  int column = splittedTextEdit->textCursor().columnNumber() + 1;
-  statusBar()->showMessage(QString("Line %1  Column %2").arg(line).arg(column));
+QCompleter *MainWindow::createCompleter() {
+  CompletionModel *model = new CompletionModel(this);
+  QCompleter *result = new QCompleter(model, this);
+  // items come ordered by the server's sortText
+  result->setModelSorting(QCompleter::UnsortedModel);
+  result->setCaseSensitivity(Qt::CaseInsensitive);
+  result->setWrapAround(false);
+
+  // documentation is requested only for the row under the popup's cursor
+  connect(result,
+          QOverload<const QModelIndex &>::of(&QCompleter::highlighted), this,
+          [this, result, model](const QModelIndex &index) {
+            auto *proxy =
+                qobject_cast<QAbstractProxyModel *>(result->completionModel());
+            QModelIndex source = proxy ? proxy->mapToSource(index) : index;
+            if (!source.isValid() || model->isResolved(source.row())) return;
+            document->fileView()->ResolveCompletion(source.row());
+          });
+  return result;
 }
 
 void MainWindow::displayAutocompleteOptions(
-    const std::vector<std::string> &vec) {
+    const std::vector<lsp::CompletionItem> &vec) {
   if (vec.size() == 0) return;
-  QStringListModel *model =
-      reinterpret_cast<QStringListModel *>(completer->model());
-  QStringList stringList;
-
-  for (const auto &item : vec) {
-    stringList << QString::fromStdString(item);
-  }
-  model->setStringList(stringList);
+  static_cast<CompletionModel *>(completer->model())->setItems(vec);
+  // the list asked for by a trigger character is shown as soon as it is
+  // there
+  Editor *pane = activeEditor();
+  if (pane->hasFocus()) pane->showCompletions();
 }
 
-void MainWindow::displayAutocompleteOptionsSplit(
-    const std::vector<std::string> &vec) {
-  if (vec.size() == 0) return;
-  QStringListModel *model =
-      reinterpret_cast<QStringListModel *>(splittedCompleter->model());
-  QStringList stringList;
-
-  for (const auto &item : vec) {
-    stringList << QString::fromStdString(item);
-  }
-  model->setStringList(stringList);
+void MainWindow::showDiagnostics(
+    Document *doc, const std::vector<lsp::DiagnosticsResponse> &resp) {
+  QString fileName = doc->fileName();
+  if (fileName.isEmpty()) fileName = tr("untitled");
+  diagnostics_model->setDiagnostics(diagnosticsKey(doc), fileName, resp);
 }
 
-void MainWindow::display_failure(
-    const std::vector<lsp::DiagnosticsResponse> &resp) {
-  if (resp.empty()) {
-    display_failure_log->clear();
+void MainWindow::diagnosticActivated(const QModelIndex &index) {
+  // rows of files only expand
+  if (!index.parent().isValid()) return;
+  QString key = index.data(DiagnosticsModel::KeyRole).toString();
+  if (key.startsWith(BUILD_KEY)) {
+    goToLocation(index.data(DiagnosticsModel::PathRole).toString(),
+                 index.data(DiagnosticsModel::LineRole).toInt(),
+                 index.data(DiagnosticsModel::ColumnRole).toInt());
     return;
   }
-  std::string failure_log;
-  for (auto &[ctgry, msg, range] : resp) {
-    failure_log += msg;
-    failure_log += " in the ";
-    failure_log += std::to_string(range.start.line + 1);
-    failure_log = number_to_string(range.start.line + 1, failure_log);
-    failure_log += " line, ";
-    failure_log += std::to_string(range.start.character + 1);
-    failure_log = number_to_string(range.start.character + 1, failure_log);
-    failure_log += " column\n";
-  }
-  display_failure_log->setPlainText(
-      QString::fromStdString(std::string(failure_log)));
+  // untitled documents are found by their tab
+  int tab = -1;
+  for (int i = 0; i < documents->count() && tab < 0; ++i) {
+    Document *doc = documents->document(i);
+    if (doc != nullptr && diagnosticsKey(doc) == key) tab = i;
+  }
+  if (tab < 0) return;
+  tab_bar->setCurrentIndex(tab);
+  if (tab != current_tab) return;
+  showLocation(index.data(DiagnosticsModel::LineRole).toInt(),
+               index.data(DiagnosticsModel::ColumnRole).toInt());
 }
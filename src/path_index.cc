@@ -0,0 +1,370 @@
+#include "path_index.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <utility>
+
+#include "task.h"
+#include "workspace_files.h"
+
+namespace {
+
+using Paths = PathIndex::Paths;
+
+const char CACHE_MAGIC[] = "baton-paths 1\n";
+const int NO_MATCH = INT_MIN;
+
+char foldCase(char ch) {
+  return ch >= 'A' && ch <= 'Z' ? static_cast<char>(ch + ('a' - 'A')) : ch;
+}
+
+std::shared_ptr<const Paths> makePaths(QStringList relative) {
+  relative.sort();
+  auto paths = std::make_shared<Paths>();
+  paths->offsets.reserve(relative.size() + 1);
+  for (const QString &path : relative) {
+    paths->offsets.push_back(static_cast<uint32_t>(paths->text.size()));
+    paths->text += path.toStdString();
+  }
+  paths->offsets.push_back(static_cast<uint32_t>(paths->text.size()));
+  paths->folded = paths->text;
+  std::transform(paths->folded.begin(), paths->folded.end(),
+                 paths->folded.begin(), foldCase);
+  return paths;
+}
+
+QString pathAt(const Paths &paths, std::size_t id) {
+  uint32_t begin = paths.offsets[id];
+  return QString::fromUtf8(paths.text.data() + begin,
+                           static_cast<int>(paths.offsets[id + 1] - begin));
+}
+
+QStringList readCache(const QString &cache_path) {
+  QFile file(cache_path);
+  if (!file.open(QIODevice::ReadOnly)) return {};
+  QByteArray data = file.readAll();
+  if (!data.startsWith(CACHE_MAGIC)) return {};
+  QStringList relative =
+      QString::fromUtf8(data.mid(sizeof(CACHE_MAGIC) - 1)).split('\n');
+  relative.removeAll(QString());
+  return relative;
+}
+
+void writeCache(const QString &cache_path, const Paths &paths) {
+  QDir().mkpath(QFileInfo(cache_path).path());
+  QSaveFile out(cache_path);
+  if (!out.open(QIODevice::WriteOnly)) return;
+  out.write(CACHE_MAGIC);
+  for (std::size_t id = 0; id + 1 < paths.offsets.size(); ++id) {
+    out.write(paths.text.data() + paths.offsets[id],
+              paths.offsets[id + 1] - paths.offsets[id]);
+    out.write("\n", 1);
+  }
+  out.commit();
+}
+
+// Runs on the worker thread. With full == false only the dirty directories
+// are listed again, everything else is taken from the previous list.
+QStringList listPaths(const QString &root, const Paths *old,
+                      const QStringList &dirty_dirs, bool full,
+                      const QSet<QString> &known_dirs,
+                      const std::atomic<bool> &cancelled,
+                      QStringList *directories) {
+  QDir root_dir(root);
+  QStringList relative;
+  if (full || old == nullptr) {
+    for (const QString &path :
+         workspace::ListFiles(root, directories, &cancelled)) {
+      relative.append(root_dir.relativeFilePath(path));
+    }
+    return relative;
+  }
+
+  QSet<QString> dirty;
+  for (const QString &dir : dirty_dirs) {
+    QString path = root_dir.relativeFilePath(dir);
+    dirty.insert(path == "." ? QString() : path);
+  }
+  for (std::size_t id = 0; id + 1 < old->offsets.size(); ++id) {
+    QString path = pathAt(*old, id);
+    int slash = path.lastIndexOf('/');
+    if (!dirty.contains(slash < 0 ? QString() : path.left(slash))) {
+      relative.append(path);
+    }
+  }
+  for (const QString &dir : dirty_dirs) {
+    if (cancelled.load()) break;
+    for (const QString &path : workspace::ListDirectory(
+             root, dir, known_dirs, directories, &cancelled)) {
+      relative.append(root_dir.relativeFilePath(path));
+    }
+  }
+  return relative;
+}
+
+bool isBoundary(const char *text, int i) {
+  if (i == 0) return true;
+  char previous = text[i - 1];
+  char ch = text[i];
+  return previous == '/' || previous == '_' || previous == '-' ||
+         previous == '.' || previous == ' ' ||
+         (previous >= 'a' && previous <= 'z' && ch >= 'A' && ch <= 'Z');
+}
+
+// NO_MATCH when the query is not a subsequence of the path
+int scorePath(const char *text, const char *folded, int length,
+              const std::string &query) {
+  const int size = static_cast<int>(query.size());
+  // the earliest end of a match, memchr skips to every next character
+  int end = 0;
+  for (char ch : query) {
+    const void *found = std::memchr(folded + end, ch, length - end);
+    if (found == nullptr) return NO_MATCH;
+    end = static_cast<int>(static_cast<const char *>(found) - folded) + 1;
+  }
+  // walking back from there gives the shortest window ending at end
+  int start = end - 1;
+  for (int i = end - 1, q = size - 1; i >= 0 && q >= 0; --i) {
+    if (folded[i] == query[q]) {
+      start = i;
+      --q;
+    }
+  }
+
+  int name_start = length;
+  while (name_start > 0 && text[name_start - 1] != '/') --name_start;
+  const int BOUNDARY_BONUS = 8;
+  const int CONSECUTIVE_BONUS = 4;
+  const int NAME_BONUS = 2;
+  const int ONLY_NAME_BONUS = 16;
+  int score = 0;
+  int previous = -2;
+  for (int i = start, q = 0; i < end && q < size; ++i) {
+    if (folded[i] != query[q]) continue;
+    score += 1;
+    if (isBoundary(text, i)) score += BOUNDARY_BONUS;
+    if (i == previous + 1) score += CONSECUTIVE_BONUS;
+    if (i >= name_start) score += NAME_BONUS;
+    previous = i;
+    ++q;
+  }
+  // every character skipped inside the window costs a point
+  score -= end - start - size;
+  if (start >= name_start) score += ONLY_NAME_BONUS;
+  return score;
+}
+
+struct Scored {
+  int score;
+  uint32_t length;
+  uint32_t id;
+};
+
+bool better(const Scored &a, const Scored &b) {
+  if (a.score != b.score) return a.score > b.score;
+  if (a.length != b.length) return a.length < b.length;
+  return a.id < b.id;
+}
+
+}  // namespace
+
+PathIndex::PathIndex(workspace::Watcher *watcher, QObject *parent)
+    : QObject(parent),
+      watcher_(watcher),
+      cancelled_(std::make_shared<std::atomic<bool>>(false)) {
+  const int REBUILD_DELAY_MS = 1000;
+  rebuild_timer_.setSingleShot(true);
+  rebuild_timer_.setInterval(REBUILD_DELAY_MS);
+  connect(&rebuild_timer_, &QTimer::timeout, this, &PathIndex::startRebuild);
+  connect(watcher_, &workspace::Watcher::directoryChanged, this,
+          &PathIndex::directoryChanged);
+}
+
+PathIndex::~PathIndex() {
+  stopWorker();
+  pool_.waitForDone();
+}
+
+void PathIndex::setRoot(const QString &root) {
+  QString cleaned = QDir::cleanPath(root);
+  if (root.isEmpty() || cleaned == root_) return;
+
+  stopWorker();
+  watcher_->setRoot(cleaned);
+  directories_.clear();
+  root_ = cleaned;
+  QByteArray hash =
+      QCryptographicHash::hash(root_.toUtf8(), QCryptographicHash::Sha1);
+  cache_path_ =
+      QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+      "/paths-" + QString::fromLatin1(hash.toHex()) + ".lst";
+  paths_.reset();
+  last_query_.clear();
+  candidates_.clear();
+  dirty_dirs_.clear();
+  full_rebuild_ = true;
+  startRebuild();
+}
+
+QString PathIndex::root() const { return root_; }
+
+int PathIndex::count() const {
+  return paths_ ? static_cast<int>(paths_->offsets.size()) - 1 : 0;
+}
+
+std::vector<PathIndex::Match> PathIndex::find(const QString &query,
+                                              std::size_t limit,
+                                              std::size_t *total_matches) {
+  if (total_matches != nullptr) *total_matches = 0;
+  if (!paths_ || query.isEmpty()) return {};
+  std::string needle = query.toStdString();
+  needle.erase(std::remove(needle.begin(), needle.end(), ' '), needle.end());
+  std::transform(needle.begin(), needle.end(), needle.begin(), foldCase);
+  if (needle.empty()) return {};
+
+  const Paths &paths = *paths_;
+  const uint32_t total = static_cast<uint32_t>(paths.offsets.size()) - 1;
+  // every match of a longer query is a match of its prefix
+  bool narrowing = !last_query_.empty() &&
+                   needle.compare(0, last_query_.size(), last_query_) == 0;
+  const std::size_t count = narrowing ? candidates_.size() : total;
+
+  struct Chunk {
+    std::size_t begin;
+    std::size_t end;
+    std::vector<uint32_t> matched;
+    std::vector<Scored> best;
+  };
+  // small queries are not worth the threads
+  const std::size_t MIN_CHUNK = 16384;
+  std::size_t chunk_count = std::min<std::size_t>(
+      std::max(1, QThread::idealThreadCount()), count / MIN_CHUNK + 1);
+  std::vector<Chunk> chunks(chunk_count);
+  for (std::size_t i = 0; i < chunk_count; ++i) {
+    chunks[i].begin = count * i / chunk_count;
+    chunks[i].end = count * (i + 1) / chunk_count;
+  }
+  auto run = [&](Chunk *chunk) {
+    for (std::size_t i = chunk->begin; i < chunk->end; ++i) {
+      uint32_t id = narrowing ? candidates_[i] : static_cast<uint32_t>(i);
+      uint32_t begin = paths.offsets[id];
+      uint32_t length = paths.offsets[id + 1] - begin;
+      int score = scorePath(paths.text.data() + begin,
+                            paths.folded.data() + begin,
+                            static_cast<int>(length), needle);
+      if (score == NO_MATCH) continue;
+      chunk->matched.push_back(id);
+      chunk->best.push_back({score, length, id});
+    }
+    std::size_t kept = std::min(limit, chunk->best.size());
+    std::partial_sort(chunk->best.begin(), chunk->best.begin() + kept,
+                      chunk->best.end(), better);
+    chunk->best.resize(kept);
+  };
+  for (std::size_t i = 1; i < chunk_count; ++i) {
+    pool_.start(new Task([&run, &chunks, i]() { run(&chunks[i]); }));
+  }
+  run(&chunks[0]);
+  pool_.waitForDone();
+
+  std::vector<uint32_t> matched;
+  std::vector<Scored> best;
+  for (Chunk &chunk : chunks) {
+    matched.insert(matched.end(), chunk.matched.begin(), chunk.matched.end());
+    best.insert(best.end(), chunk.best.begin(), chunk.best.end());
+  }
+  last_query_ = needle;
+  candidates_ = std::move(matched);
+  if (total_matches != nullptr) *total_matches = candidates_.size();
+
+  std::size_t kept = std::min(limit, best.size());
+  std::partial_sort(best.begin(), best.begin() + kept, best.end(), better);
+  std::vector<Match> result;
+  result.reserve(kept);
+  for (std::size_t i = 0; i < kept; ++i) {
+    result.push_back({pathAt(paths, best[i].id), best[i].score});
+  }
+  return result;
+}
+
+void PathIndex::directoryChanged(const QString &path) {
+  if (!QFileInfo(path).isDir()) directories_.remove(path);
+  if (!dirty_dirs_.contains(path)) dirty_dirs_.append(path);
+  rebuild_timer_.start();
+}
+
+void PathIndex::startRebuild() {
+  if (root_.isEmpty()) return;
+  if (worker_) {  // try again once the running rebuild is over
+    rebuild_timer_.start();
+    return;
+  }
+
+  QString root = root_;
+  QString cache_path = cache_path_;
+  std::shared_ptr<const Paths> old = paths_;
+  QStringList dirty = dirty_dirs_;
+  QSet<QString> known = directories_;
+  bool full = full_rebuild_;
+  dirty_dirs_.clear();
+  full_rebuild_ = false;
+
+  cancelled_ = std::make_shared<std::atomic<bool>>(false);
+  auto cancelled = cancelled_;
+  worker_ = QThread::create([this, root, cache_path, old, dirty, full, known,
+                             cancelled]() {
+    // the list of the previous session answers until the walk is done
+    if (old == nullptr) {
+      QStringList cached = readCache(cache_path);
+      if (!cached.isEmpty() && !cancelled->load()) {
+        std::shared_ptr<const Paths> paths = makePaths(std::move(cached));
+        QMetaObject::invokeMethod(
+            this,
+            [this, root, paths]() {
+              if (root == root_ && !paths_) rebuildFinished(paths, {}, false);
+            },
+            Qt::QueuedConnection);
+      }
+    }
+    QStringList directories;
+    QStringList relative = listPaths(root, old.get(), dirty, full, known,
+                                     *cancelled, &directories);
+    if (cancelled->load()) return;
+    std::shared_ptr<const Paths> paths = makePaths(std::move(relative));
+    writeCache(cache_path, *paths);
+    QMetaObject::invokeMethod(
+        this,
+        [this, root, paths, directories, full]() {
+          if (root == root_) rebuildFinished(paths, directories, full);
+        },
+        Qt::QueuedConnection);
+  });
+  connect(worker_, &QThread::finished, worker_, &QObject::deleteLater);
+  worker_->start(QThread::LowPriority);
+}
+
+void PathIndex::rebuildFinished(std::shared_ptr<const Paths> paths,
+                                const QStringList &directories, bool full) {
+  paths_ = std::move(paths);
+  last_query_.clear();
+  candidates_.clear();
+  if (full) directories_.clear();
+  for (const QString &dir : directories) directories_.insert(dir);
+  watcher_->watch(directories);
+  emit updated();
+}
+
+void PathIndex::stopWorker() {
+  cancelled_->store(true);
+  if (worker_) {
+    worker_->wait();
+    delete worker_;
+  }
+}
@@ -0,0 +1,187 @@
+#include "pty_process.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <QProcessEnvironment>
+#include <QStandardPaths>
+#include <vector>
+
+namespace {
+
+const int MAX_BUFFERED_BYTES = 1 << 20;
+
+}  // namespace
+
+PtyProcess::PtyProcess(QObject *parent) : QObject(parent) {}
+
+PtyProcess::~PtyProcess() {
+  if (pid_ <= 0) return;
+  // closing the terminal hangs up the programs started from it
+  ::close(master_);
+  ::kill(pid_, SIGKILL);
+  ::waitpid(pid_, nullptr, 0);
+}
+
+bool PtyProcess::start(const QString &program, const QStringList &arguments,
+                       int rows, int columns) {
+  if (isRunning()) return false;
+  QString path = QStandardPaths::findExecutable(program);
+  if (path.isEmpty()) return false;
+
+  int master = ::posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0) return false;
+  ::fcntl(master, F_SETFD, FD_CLOEXEC);
+  char slave_name[128];
+  if (::grantpt(master) != 0 || ::unlockpt(master) != 0 ||
+      ::ptsname_r(master, slave_name, sizeof(slave_name)) != 0) {
+    ::close(master);
+    return false;
+  }
+  struct winsize size = {};
+  size.ws_row = static_cast<unsigned short>(rows);
+  size.ws_col = static_cast<unsigned short>(columns);
+  ::ioctl(master, TIOCSWINSZ, &size);
+
+  // the child only calls async-signal-safe functions, everything it needs
+  // is prepared before the fork
+  QByteArray file = path.toLocal8Bit();
+  std::vector<QByteArray> strings;
+  strings.push_back(program.toLocal8Bit());
+  for (const QString &argument : arguments) {
+    strings.push_back(argument.toLocal8Bit());
+  }
+  std::size_t argument_count = strings.size();
+  QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+  environment.insert("TERM", "xterm-256color");
+  for (const QString &variable : environment.toStringList()) {
+    strings.push_back(variable.toLocal8Bit());
+  }
+  std::vector<char *> argv;
+  std::vector<char *> envp;
+  for (std::size_t i = 0; i < strings.size(); ++i) {
+    (i < argument_count ? argv : envp).push_back(strings[i].data());
+  }
+  argv.push_back(nullptr);
+  envp.push_back(nullptr);
+
+  pid_t pid = ::fork();
+  if (pid < 0) {
+    ::close(master);
+    return false;
+  }
+  if (pid == 0) {
+    ::setsid();
+    int slave = ::open(slave_name, O_RDWR);
+    if (slave < 0) ::_exit(127);
+    ::ioctl(slave, TIOCSCTTY, 0);
+    ::dup2(slave, STDIN_FILENO);
+    ::dup2(slave, STDOUT_FILENO);
+    ::dup2(slave, STDERR_FILENO);
+    if (slave > STDERR_FILENO) ::close(slave);
+    ::signal(SIGPIPE, SIG_DFL);
+    ::execve(file.constData(), argv.data(), envp.data());
+    ::_exit(127);
+  }
+
+  ::fcntl(master, F_SETFL, ::fcntl(master, F_GETFL) | O_NONBLOCK);
+  master_ = master;
+  pid_ = pid;
+  read_notifier_ = new QSocketNotifier(master_, QSocketNotifier::Read, this);
+  connect(read_notifier_, &QSocketNotifier::activated, this,
+          &PtyProcess::readOutput);
+  write_notifier_ = new QSocketNotifier(master_, QSocketNotifier::Write, this);
+  write_notifier_->setEnabled(false);
+  connect(write_notifier_, &QSocketNotifier::activated, this,
+          &PtyProcess::writeInput);
+  return true;
+}
+
+bool PtyProcess::isRunning() const { return pid_ > 0; }
+
+void PtyProcess::write(const QByteArray &data) {
+  if (!isRunning()) return;
+  input_ += data;
+  writeInput();
+}
+
+void PtyProcess::resize(int rows, int columns) {
+  if (!isRunning()) return;
+  struct winsize size = {};
+  size.ws_row = static_cast<unsigned short>(rows);
+  size.ws_col = static_cast<unsigned short>(columns);
+  ::ioctl(master_, TIOCSWINSZ, &size);
+}
+
+QByteArray PtyProcess::read(int max) {
+  QByteArray output;
+  if (max >= output_.size()) {
+    output.swap(output_);
+  } else {
+    output = output_.left(max);
+    output_.remove(0, max);
+  }
+  if (read_notifier_ != nullptr && !read_notifier_->isEnabled() &&
+      output_.size() < MAX_BUFFERED_BYTES / 2) {
+    read_notifier_->setEnabled(true);
+  }
+  return output;
+}
+
+int PtyProcess::bytesAvailable() const { return output_.size(); }
+
+void PtyProcess::readOutput() {
+  char chunk[1 << 16];
+  while (output_.size() < MAX_BUFFERED_BYTES) {
+    ssize_t count = ::read(master_, chunk, sizeof(chunk));
+    if (count > 0) {
+      output_.append(chunk, static_cast<int>(count));
+    } else if (count < 0 && errno == EINTR) {
+      continue;
+    } else if (count < 0 && errno == EAGAIN) {
+      break;
+    } else {
+      // EIO once every program holding the terminal is gone
+      if (!output_.isEmpty()) emit readyRead();
+      finish();
+      return;
+    }
+  }
+  // the program waits until read takes some of the output
+  if (output_.size() >= MAX_BUFFERED_BYTES) read_notifier_->setEnabled(false);
+  if (!output_.isEmpty()) emit readyRead();
+}
+
+void PtyProcess::writeInput() {
+  while (!input_.isEmpty()) {
+    ssize_t count = ::write(master_, input_.constData(), input_.size());
+    if (count < 0 && errno == EINTR) continue;
+    if (count < 0) break;
+    input_.remove(0, static_cast<int>(count));
+  }
+  // the rest goes once the program read some of its input
+  write_notifier_->setEnabled(!input_.isEmpty());
+}
+
+void PtyProcess::finish() {
+  // called from a slot of the read notifier
+  read_notifier_->setEnabled(false);
+  read_notifier_->deleteLater();
+  write_notifier_->setEnabled(false);
+  write_notifier_->deleteLater();
+  read_notifier_ = nullptr;
+  write_notifier_ = nullptr;
+  ::close(master_);
+  master_ = -1;
+  int status = 0;
+  ::waitpid(pid_, &status, 0);
+  pid_ = -1;
+  input_.clear();
+  emit finished(WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+}
@@ -0,0 +1,108 @@
+#include "quick_open.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QKeyEvent>
+#include <QVBoxLayout>
+
+namespace {
+
+const int PATH_ROLE = Qt::UserRole + 1;
+const std::size_t MAX_RESULTS = 100;
+
+}  // namespace
+
+QuickOpen::QuickOpen(PathIndex *index, QWidget *parent)
+    : QDialog(parent, Qt::Popup),
+      index_(index),
+      input_(new QLineEdit(this)),
+      results_(new QListWidget(this)),
+      status_(new QLabel(this)) {
+  QVBoxLayout *layout = new QVBoxLayout(this);
+  layout->setContentsMargins(4, 4, 4, 4);
+  layout->addWidget(input_);
+  layout->addWidget(results_);
+  layout->addWidget(status_);
+  input_->setPlaceholderText(tr("File name"));
+  results_->setUniformItemSizes(true);
+  input_->installEventFilter(this);
+
+  const int WIDTH = 600;
+  const int HEIGHT = 400;
+  resize(WIDTH, HEIGHT);
+
+  connect(input_, &QLineEdit::textChanged, this, &QuickOpen::search);
+  connect(input_, &QLineEdit::returnPressed, this, &QuickOpen::choose);
+  connect(results_, &QListWidget::itemActivated, this, &QuickOpen::choose);
+  // the first listing of a large tree may still be running
+  connect(index_, &PathIndex::updated, this, [this]() {
+    if (isVisible()) search();
+  });
+}
+
+void QuickOpen::popup() {
+  if (parentWidget() != nullptr) {
+    QWidget *window = parentWidget()->window();
+    move(window->mapToGlobal(
+        QPoint((window->width() - width()) / 2, window->height() / 8)));
+  }
+  input_->clear();
+  results_->clear();
+  status_->setText(tr("%n file(s)", "", index_->count()));
+  show();
+  input_->setFocus();
+}
+
+bool QuickOpen::eventFilter(QObject *watched, QEvent *event) {
+  if (watched == input_ && event->type() == QEvent::KeyPress) {
+    auto *key_event = static_cast<QKeyEvent *>(event);
+    switch (key_event->key()) {
+      case Qt::Key_Up:
+      case Qt::Key_Down:
+      case Qt::Key_PageUp:
+      case Qt::Key_PageDown:
+        QCoreApplication::sendEvent(results_, event);
+        return true;
+      default:
+        break;
+    }
+  }
+  return QDialog::eventFilter(watched, event);
+}
+
+void QuickOpen::search() {
+  results_->clear();
+  QString query = input_->text().trimmed();
+  if (query.isEmpty()) {
+    status_->setText(tr("%n file(s)", "", index_->count()));
+    return;
+  }
+
+  QElapsedTimer timer;
+  timer.start();
+  std::size_t total = 0;
+  std::vector<PathIndex::Match> matches =
+      index_->find(query, MAX_RESULTS, &total);
+  qint64 elapsed = timer.elapsed();
+
+  QDir root(index_->root());
+  for (const PathIndex::Match &match : matches) {
+    QListWidgetItem *item = new QListWidgetItem(match.path, results_);
+    item->setData(PATH_ROLE, root.filePath(match.path));
+  }
+  results_->setCurrentRow(0);
+  QString status = tr("%1 of %n file(s), %2 ms", "", index_->count())
+                       .arg(total)
+                       .arg(elapsed);
+  if (total > matches.size()) {
+    status += tr(", best %1 shown").arg(matches.size());
+  }
+  status_->setText(status);
+}
+
+void QuickOpen::choose() {
+  QListWidgetItem *item = results_->currentItem();
+  if (item == nullptr) return;
+  hide();
+  emit fileChosen(item->data(PATH_ROLE).toString());
+}
@@ -0,0 +1,247 @@
+#include "references_panel.h"
+
+#include <QAbstractListModel>
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QStringList>
+#include <QTextBlock>
+#include <QThreadPool>
+#include <QUrl>
+#include <QVBoxLayout>
+#include <list>
+#include <utility>
+
+#include "document_manager.h"
+#include "task.h"
+
+namespace {
+
+const int PATH_ROLE = Qt::UserRole + 1;
+const int LINE_ROLE = Qt::UserRole + 2;
+const int COLUMN_ROLE = Qt::UserRole + 3;
+const int MAX_PREVIEW_LENGTH = 200;
+
+// Lines of the files read last, the references of a file come spread over
+// many batches
+class LineCache {
+ public:
+  const QStringList &linesOf(const QString &path) {
+    const int MAX_CACHED_FILES = 64;
+    auto cached = files_.find(path);
+    if (cached != files_.end()) {
+      recent_.splice(recent_.begin(), recent_, cached->use);
+      return cached->lines;
+    }
+    if (files_.size() >= MAX_CACHED_FILES) {
+      files_.remove(recent_.back());
+      recent_.pop_back();
+    }
+    QStringList lines;
+    QFile file(path);
+    if (file.open(QIODevice::ReadOnly)) {
+      lines = QString::fromUtf8(file.readAll()).split('\n');
+    }
+    recent_.push_front(path);
+    return files_.insert(path, {lines, recent_.begin()})->lines;
+  }
+
+  void clear() {
+    files_.clear();
+    recent_.clear();
+  }
+
+ private:
+  struct File {
+    QStringList lines;
+    std::list<QString>::iterator use;
+  };
+
+  QHash<QString, File> files_;
+  // most recently used first
+  std::list<QString> recent_;
+};
+
+QString preview(const QString &line) {
+  return line.trimmed().left(MAX_PREVIEW_LENGTH);
+}
+
+}  // namespace
+
+class ReferencesModel : public QAbstractListModel {
+ public:
+  explicit ReferencesModel(QObject *parent) : QAbstractListModel(parent) {
+    // the cache is only used by the one worker
+    pool_.setMaxThreadCount(1);
+  }
+  ~ReferencesModel() override { pool_.waitForDone(); }
+
+  void setRoot(const QString &root) {
+    beginResetModel();
+    root_ = QDir(root);
+    endResetModel();
+  }
+
+  void setDocuments(const DocumentManager *documents) {
+    documents_ = documents;
+  }
+
+  void clear() {
+    beginResetModel();
+    references_.clear();
+    ++search_;
+    endResetModel();
+    // files may change on disk before the next search
+    pool_.start(new Task([this]() { cache_.clear(); }));
+  }
+
+  void append(const std::vector<lsp::Location> &locations) {
+    if (locations.empty()) return;
+    int first = static_cast<int>(references_.size());
+    int last = first + static_cast<int>(locations.size()) - 1;
+    beginInsertRows(QModelIndex(), first, last);
+    references_.reserve(references_.size() + locations.size());
+    // lines of open documents are taken as they are on screen, the rest is
+    // read from disk
+    std::vector<Reference> unread;
+    for (const lsp::Location &location : locations) {
+      Reference reference{
+          QUrl(QString::fromStdString(location.uri)).toLocalFile(),
+          static_cast<int>(location.range.start.line),
+          static_cast<int>(location.range.start.character), QString(),
+          static_cast<int>(references_.size())};
+      if (!openLine(&reference)) unread.push_back(reference);
+      references_.push_back(std::move(reference));
+    }
+    endInsertRows();
+    if (unread.empty()) return;
+
+    int search = search_;
+    pool_.start(new Task([this, search, first, last,
+                          unread = std::move(unread)]() mutable {
+      for (Reference &reference : unread) {
+        const QStringList &lines = cache_.linesOf(reference.path);
+        if (reference.line >= 0 && reference.line < lines.size()) {
+          reference.preview = preview(lines.at(reference.line));
+        }
+      }
+      QMetaObject::invokeMethod(
+          this,
+          [this, search, first, last, unread = std::move(unread)]() {
+            setPreviews(search, first, last, unread);
+          },
+          Qt::QueuedConnection);
+    }));
+  }
+
+  int rowCount(const QModelIndex &parent) const override {
+    return parent.isValid() ? 0 : static_cast<int>(references_.size());
+  }
+
+  QVariant data(const QModelIndex &index, int role) const override {
+    if (!index.isValid()) return QVariant();
+    const Reference &reference = references_[index.row()];
+    switch (role) {
+      case Qt::DisplayRole:
+        return QString("%1:%2:%3: %4")
+            .arg(root_.relativeFilePath(reference.path))
+            .arg(reference.line + 1)
+            .arg(reference.column + 1)
+            .arg(reference.preview);
+      case Qt::ToolTipRole:
+        return reference.path;
+      case PATH_ROLE:
+        return reference.path;
+      case LINE_ROLE:
+        return reference.line;
+      case COLUMN_ROLE:
+        return reference.column;
+      default:
+        return QVariant();
+    }
+  }
+
+ private:
+  struct Reference {
+    QString path;
+    int line;
+    int column;
+    QString preview;
+    int row;
+  };
+
+  std::vector<Reference> references_;
+  QDir root_;
+  const DocumentManager *documents_ = nullptr;
+  // previews read for an earlier search are dropped
+  int search_ = 0;
+  QThreadPool pool_;
+  // only touched by the worker
+  LineCache cache_;
+
+  bool openLine(Reference *reference) const {
+    if (documents_ == nullptr) return false;
+    int tab = documents_->indexOf(reference->path);
+    // dormant tabs hold no edits, their file is what they show
+    Document *document = tab < 0 ? nullptr : documents_->document(tab);
+    if (document == nullptr) return false;
+    QTextBlock block =
+        document->textDocument()->findBlockByNumber(reference->line);
+    if (block.isValid()) reference->preview = preview(block.text());
+    return true;
+  }
+
+  void setPreviews(int search, int first, int last,
+                   const std::vector<Reference> &read) {
+    if (search != search_) return;
+    for (const Reference &reference : read) {
+      references_[reference.row].preview = reference.preview;
+    }
+    emit dataChanged(index(first), index(last), {Qt::DisplayRole});
+  }
+};
+
+ReferencesPanel::ReferencesPanel(QWidget *parent)
+    : QWidget(parent),
+      model_(new ReferencesModel(this)),
+      list_(new QListView),
+      status_(new QLabel) {
+  list_->setModel(model_);
+  list_->setUniformItemSizes(true);
+  list_->setEditTriggers(QAbstractItemView::NoEditTriggers);
+  QVBoxLayout *layout = new QVBoxLayout(this);
+  layout->setContentsMargins(0, 0, 0, 0);
+  layout->addWidget(status_);
+  layout->addWidget(list_);
+
+  connect(list_, &QListView::activated, this, &ReferencesPanel::choose);
+}
+
+void ReferencesPanel::setRoot(const QString &root) { model_->setRoot(root); }
+
+void ReferencesPanel::setDocuments(const DocumentManager *documents) {
+  model_->setDocuments(documents);
+}
+
+void ReferencesPanel::start(const QString &what) {
+  what_ = what;
+  model_->clear();
+  status_->setText(tr("Searching for %1...").arg(what_));
+}
+
+void ReferencesPanel::addLocations(
+    const std::vector<lsp::Location> &locations, bool finished) {
+  model_->append(locations);
+  int count = model_->rowCount(QModelIndex());
+  if (finished) {
+    status_->setText(tr("%1: %2 found").arg(what_).arg(count));
+  } else {
+    status_->setText(tr("Searching for %1... %2 found").arg(what_).arg(count));
+  }
+}
+
+void ReferencesPanel::choose(const QModelIndex &index) {
+  emit locationChosen(index.data(PATH_ROLE).toString(),
+                      index.data(LINE_ROLE).toInt(),
+                      index.data(COLUMN_ROLE).toInt());
+}
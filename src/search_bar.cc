@@ -0,0 +1,165 @@
+#include "search_bar.h"
+
+#include <QGuiApplication>
+#include <QHBoxLayout>
+#include <QKeyEvent>
+#include <QPushButton>
+#include <QTextCursor>
+#include <QToolButton>
+#include <QVBoxLayout>
+
+SearchBar::SearchBar(QWidget *parent)
+    : QWidget(parent),
+      find_(new QLineEdit(this)),
+      replace_(new QLineEdit(this)),
+      regex_(new QCheckBox(tr("Regex"), this)),
+      case_sensitive_(new QCheckBox(tr("Match case"), this)),
+      status_(new QLabel(this)),
+      replace_row_(new QWidget(this)) {
+  QPushButton *previous = new QPushButton(tr("Previous"), this);
+  QPushButton *next = new QPushButton(tr("Next"), this);
+  QToolButton *close = new QToolButton(this);
+  close->setText("x");
+  QHBoxLayout *find_row = new QHBoxLayout;
+  find_row->addWidget(find_);
+  find_row->addWidget(previous);
+  find_row->addWidget(next);
+  find_row->addWidget(regex_);
+  find_row->addWidget(case_sensitive_);
+  find_row->addWidget(status_);
+  find_row->addWidget(close);
+
+  QPushButton *replace_one = new QPushButton(tr("Replace"), replace_row_);
+  QPushButton *replace_all = new QPushButton(tr("Replace all"), replace_row_);
+  QHBoxLayout *replace_layout = new QHBoxLayout(replace_row_);
+  replace_layout->setContentsMargins(0, 0, 0, 0);
+  replace_layout->addWidget(replace_);
+  replace_layout->addWidget(replace_one);
+  replace_layout->addWidget(replace_all);
+
+  QVBoxLayout *layout = new QVBoxLayout(this);
+  layout->setContentsMargins(0, 0, 0, 0);
+  layout->addLayout(find_row);
+  layout->addWidget(replace_row_);
+
+  find_->setPlaceholderText(tr("Find"));
+  replace_->setPlaceholderText(tr("Replace with"));
+
+  connect(find_, &QLineEdit::textChanged, this, &SearchBar::queryChanged);
+  connect(find_, &QLineEdit::returnPressed, this, [this]() {
+    if (QGuiApplication::keyboardModifiers() & Qt::ShiftModifier) {
+      findPrevious();
+    } else {
+      findNext();
+    }
+  });
+  connect(replace_, &QLineEdit::returnPressed, this, &SearchBar::replaceOne);
+  connect(regex_, &QCheckBox::toggled, this, &SearchBar::queryChanged);
+  connect(case_sensitive_, &QCheckBox::toggled, this,
+          &SearchBar::queryChanged);
+  connect(previous, &QPushButton::clicked, this, &SearchBar::findPrevious);
+  connect(next, &QPushButton::clicked, this, &SearchBar::findNext);
+  connect(replace_one, &QPushButton::clicked, this, &SearchBar::replaceOne);
+  connect(replace_all, &QPushButton::clicked, this, &SearchBar::replaceAll);
+  connect(close, &QToolButton::clicked, this, &SearchBar::closeBar);
+  connect(&search_, &DocumentSearch::matchesChanged, this,
+          &SearchBar::updateStatus);
+}
+
+void SearchBar::activate(Editor *editor, bool replace) {
+  if (editor_ != editor) {
+    if (editor_) editor_->setSearch(nullptr);
+    editor_ = editor;
+    search_.setDocument(editor->document());
+  }
+  editor->setSearch(&search_);
+  replace_row_->setVisible(replace);
+  show();
+
+  QString selected = editor->textCursor().selectedText();
+  // QTextCursor separates selected lines with U+2029
+  if (!selected.isEmpty() && !selected.contains(QChar::ParagraphSeparator)) {
+    find_->setText(selected);
+  }
+  queryChanged();
+  find_->setFocus();
+  find_->selectAll();
+}
+
+void SearchBar::closeBar() {
+  hide();
+  search_.clear();
+  if (editor_) {
+    editor_->setSearch(nullptr);
+    editor_->setFocus();
+  }
+}
+
+void SearchBar::keyPressEvent(QKeyEvent *event) {
+  if (event->key() == Qt::Key_Escape) {
+    closeBar();
+    return;
+  }
+  QWidget::keyPressEvent(event);
+}
+
+void SearchBar::queryChanged() {
+  if (!editor_) return;
+  QString error;
+  if (!search_.setQuery(find_->text(), regex_->isChecked(),
+                        case_sensitive_->isChecked(), &error)) {
+    status_->setText(error);
+    return;
+  }
+  // the first match from the cursor is selected while typing
+  int index = search_.nextMatch(editor_->textCursor().selectionStart());
+  if (index >= 0) select(index);
+}
+
+void SearchBar::findNext() {
+  if (!editor_ || isHidden()) return;
+  select(search_.nextMatch(editor_->textCursor().selectionEnd()));
+}
+
+void SearchBar::findPrevious() {
+  if (!editor_ || isHidden()) return;
+  select(search_.previousMatch(editor_->textCursor().selectionStart()));
+}
+
+void SearchBar::replaceOne() {
+  if (!editor_) return;
+  QTextCursor cursor = editor_->textCursor();
+  int index = search_.matchAt(cursor.selectionStart(),
+                              cursor.selectionEnd() - cursor.selectionStart());
+  if (index >= 0) {
+    cursor.insertText(search_.replacementFor(index, replace_->text()));
+    editor_->setTextCursor(cursor);
+  }
+  findNext();
+}
+
+void SearchBar::replaceAll() {
+  if (!editor_) return;
+  int count = search_.replaceAll(replace_->text());
+  status_->setText(tr("%1 replaced").arg(count));
+}
+
+void SearchBar::updateStatus() {
+  if (find_->text().isEmpty()) {
+    status_->clear();
+    return;
+  }
+  int count = static_cast<int>(search_.matches().size());
+  status_->setText(count == 0 ? tr("No matches") : tr("%1 matches").arg(count));
+}
+
+void SearchBar::select(int index) {
+  if (!editor_ || index < 0) return;
+  const DocumentSearch::Match &match = search_.matches()[index];
+  QTextCursor cursor(editor_->document());
+  cursor.setPosition(match.position);
+  cursor.setPosition(match.position + match.length, QTextCursor::KeepAnchor);
+  editor_->setTextCursor(cursor);
+  editor_->ensureCursorVisible();
+  status_->setText(tr("%1 of %2").arg(index + 1).arg(search_.matches().size()));
+}
@@ -0,0 +1,102 @@
+#include "startup_trace.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace startup_trace {
+
+namespace {
+
+struct Entry {
+  const char *phase;
+  qint64 start;
+  qint64 duration;
+};
+
+struct State {
+  QElapsedTimer clock;
+  bool enabled = !qEnvironmentVariableIsEmpty("BATON_STARTUP_TRACE");
+  std::vector<Entry> entries;
+  const char *awaited = nullptr;
+  std::function<void()> done;
+};
+
+State *state() {
+  static State trace;
+  return &trace;
+}
+
+}  // namespace
+
+void Start() { state()->clock.start(); }
+
+void Enable() { state()->enabled = true; }
+
+bool IsEnabled() { return state()->enabled; }
+
+qint64 Now() {
+  return state()->clock.isValid() ? state()->clock.elapsed() : 0;
+}
+
+void Mark(const char *phase) { Record(phase, Now()); }
+
+void Record(const char *phase, qint64 start) {
+  State *trace = state();
+  if (!trace->enabled || !trace->clock.isValid()) return;
+  for (const Entry &entry : trace->entries) {
+    if (std::strcmp(entry.phase, phase) == 0) return;
+  }
+  qint64 now = Now();
+  trace->entries.push_back({phase, start, now - start});
+  std::fprintf(stderr, "startup: %6lld ms %6lld ms  %s\n",
+               static_cast<long long>(start),
+               static_cast<long long>(now - start), phase);
+  if (trace->awaited != nullptr && std::strcmp(trace->awaited, phase) == 0) {
+    trace->awaited = nullptr;
+    std::function<void()> done = std::move(trace->done);
+    done();
+  }
+}
+
+void WhenRecorded(const char *phase, std::function<void()> done) {
+  State *trace = state();
+  for (const Entry &entry : trace->entries) {
+    if (std::strcmp(entry.phase, phase) == 0) {
+      done();
+      return;
+    }
+  }
+  trace->awaited = phase;
+  trace->done = std::move(done);
+}
+
+Phase::Phase(const char *name) : name_(name), start_(Now()) {}
+
+Phase::~Phase() { Record(name_, start_); }
+
+bool WriteReport(const QString &fileName, QString *error) {
+  QFile file(fileName);
+  if (!file.open(QFile::WriteOnly | QFile::Truncate | QFile::Text)) {
+    *error = file.errorString();
+    return false;
+  }
+  QTextStream out(&file);
+  out << "# phase\tstart ms\tduration ms\n";
+  for (const Entry &entry : state()->entries) {
+    out << entry.phase << '\t' << entry.start << '\t' << entry.duration
+        << '\n';
+  }
+  out.flush();
+  if (file.error() != QFile::NoError) {
+    *error = file.errorString();
+    return false;
+  }
+  return true;
+}
+
+}  // namespace startup_trace
@@ -0,0 +1,892 @@
+#include "symbol_index.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+#include "workspace_files.h"
+
+namespace {
+
+// On-disk layout, every record is naturally aligned inside the mapping:
+// Header | FileRecord[] | SymbolRecord[] | TrigramRecord[] | uint32_t[] |
+// strings. Symbols are grouped by file, trigrams are sorted and point to
+// sorted runs of symbol ids in the postings array.
+constexpr char INDEX_MAGIC[4] = {'B', 'S', 'I', '1'};
+
+struct Header {
+  char magic[4];
+  uint32_t file_count;
+  uint32_t symbol_count;
+  uint32_t trigram_count;
+  uint32_t posting_count;
+  uint32_t strings_size;
+};
+
+struct FileRecord {
+  int64_t mtime;
+  int64_t size;
+  uint32_t path_offset;
+  uint32_t path_length;
+  uint32_t first_symbol;
+  uint32_t symbol_count;
+};
+
+struct SymbolRecord {
+  uint32_t name_offset;
+  uint32_t name_length;
+  uint32_t container_offset;
+  uint32_t container_length;
+  uint32_t file;
+  uint32_t line;
+  uint32_t kind;
+};
+
+struct TrigramRecord {
+  uint32_t trigram;
+  uint32_t first_posting;
+  uint32_t posting_count;
+};
+
+static_assert(sizeof(Header) == 24, "unexpected padding");
+static_assert(sizeof(FileRecord) == 32, "unexpected padding");
+static_assert(sizeof(SymbolRecord) == 28, "unexpected padding");
+static_assert(sizeof(TrigramRecord) == 12, "unexpected padding");
+
+// Read-only access to a mapped index
+class IndexView {
+ public:
+  IndexView(const uchar *data, qint64 size) {
+    if (data == nullptr || size < static_cast<qint64>(sizeof(Header))) return;
+    auto header = reinterpret_cast<const Header *>(data);
+    if (std::memcmp(header->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0) {
+      return;
+    }
+    qint64 expected = sizeof(Header) +
+                      sizeof(FileRecord) * qint64(header->file_count) +
+                      sizeof(SymbolRecord) * qint64(header->symbol_count) +
+                      sizeof(TrigramRecord) * qint64(header->trigram_count) +
+                      sizeof(uint32_t) * qint64(header->posting_count) +
+                      header->strings_size;
+    if (expected != size) return;
+
+    header_ = header;
+    files_ = reinterpret_cast<const FileRecord *>(header + 1);
+    symbols_ =
+        reinterpret_cast<const SymbolRecord *>(files_ + header->file_count);
+    trigrams_ = reinterpret_cast<const TrigramRecord *>(symbols_ +
+                                                        header->symbol_count);
+    postings_ =
+        reinterpret_cast<const uint32_t *>(trigrams_ + header->trigram_count);
+    strings_ = reinterpret_cast<const char *>(postings_ +
+                                              header->posting_count);
+  }
+
+  bool valid() const { return header_ != nullptr; }
+
+  // Checks every range stored in the records against the sizes of the
+  // sections, so a truncated or stale index can not make the accessors read
+  // outside the mapping. Linear in the size of the index, run once when a
+  // file is mapped.
+  bool checkRanges() const {
+    const uint32_t symbol_count = header_->symbol_count;
+    for (uint32_t i = 0; i < header_->file_count; ++i) {
+      const FileRecord &rec = files_[i];
+      if (qint64(rec.first_symbol) + rec.symbol_count > symbol_count ||
+          !inStrings(rec.path_offset, rec.path_length)) {
+        return false;
+      }
+    }
+    for (uint32_t i = 0; i < symbol_count; ++i) {
+      const SymbolRecord &sym = symbols_[i];
+      if (sym.file >= header_->file_count ||
+          !inStrings(sym.name_offset, sym.name_length) ||
+          !inStrings(sym.container_offset, sym.container_length)) {
+        return false;
+      }
+    }
+    for (uint32_t i = 0; i < header_->trigram_count; ++i) {
+      const TrigramRecord &rec = trigrams_[i];
+      if (qint64(rec.first_posting) + rec.posting_count >
+          header_->posting_count) {
+        return false;
+      }
+    }
+    return std::all_of(
+        postings_, postings_ + header_->posting_count,
+        [symbol_count](uint32_t id) { return id < symbol_count; });
+  }
+  uint32_t fileCount() const { return header_->file_count; }
+  uint32_t symbolCount() const { return header_->symbol_count; }
+  const FileRecord &file(uint32_t i) const { return files_[i]; }
+  const SymbolRecord &symbol(uint32_t i) const { return symbols_[i]; }
+
+  std::string_view string(uint32_t offset, uint32_t length) const {
+    if (!inStrings(offset, length)) return {};
+    return std::string_view(strings_ + offset, length);
+  }
+
+  // Sorted posting list of the trigram, empty when it does not occur
+  std::pair<const uint32_t *, uint32_t> postings(uint32_t trigram) const {
+    const TrigramRecord *end = trigrams_ + header_->trigram_count;
+    const TrigramRecord *it = std::lower_bound(
+        trigrams_, end, trigram,
+        [](const TrigramRecord &rec, uint32_t key) {
+          return rec.trigram < key;
+        });
+    if (it == end || it->trigram != trigram) return {nullptr, 0};
+    return {postings_ + it->first_posting, it->posting_count};
+  }
+
+ private:
+  const Header *header_ = nullptr;
+  const FileRecord *files_ = nullptr;
+  const SymbolRecord *symbols_ = nullptr;
+  const TrigramRecord *trigrams_ = nullptr;
+  const uint32_t *postings_ = nullptr;
+  const char *strings_ = nullptr;
+
+  bool inStrings(uint32_t offset, uint32_t length) const {
+    return qint64(offset) + length <= header_->strings_size;
+  }
+};
+
+struct RawSymbol {
+  std::string name;
+  std::string container;
+  uint32_t line = 0;
+  lsp::SymbolKind kind = lsp::SymbolKind::Function;
+};
+
+struct FileSymbols {
+  std::string path;
+  int64_t mtime = 0;
+  int64_t size = 0;
+  std::vector<RawSymbol> symbols;
+};
+
+struct Token {
+  std::string_view text;
+  uint32_t line;
+  bool identifier;
+};
+
+bool isIdentStart(char ch) {
+  return std::isalpha(static_cast<unsigned char>(ch)) || ch == '_';
+}
+
+bool isIdentChar(char ch) {
+  return std::isalnum(static_cast<unsigned char>(ch)) || ch == '_';
+}
+
+const std::unordered_set<std::string_view> &keywords() {
+  static const std::unordered_set<std::string_view> words = {
+      "alignas", "alignof", "asm", "auto", "bool", "break", "case", "catch",
+      "char", "class", "const", "constexpr", "const_cast", "continue",
+      "decltype", "default", "defined", "delete", "do", "double",
+      "dynamic_cast", "else", "enum", "explicit", "extern", "false", "final",
+      "float", "for", "friend", "goto", "if", "inline", "int", "long",
+      "mutable", "namespace", "new", "noexcept", "nullptr", "operator",
+      "override", "private", "protected", "public", "register",
+      "reinterpret_cast", "return", "short", "signed", "sizeof", "static",
+      "static_assert", "static_cast", "struct", "switch", "template", "this",
+      "thread_local", "throw", "true", "try", "typedef", "typeid", "typename",
+      "union", "unsigned", "using", "virtual", "void", "volatile", "while",
+      "__attribute__", "__declspec"};
+  return words;
+}
+
+uint32_t countLines(std::string_view src, std::size_t from, std::size_t to) {
+  return static_cast<uint32_t>(
+      std::count(src.begin() + from, src.begin() + to, '\n'));
+}
+
+// Splits C++ source into identifiers and punctuation. Comments, literals and
+// preprocessor lines are dropped, names of #define are reported into macros.
+std::vector<Token> tokenize(std::string_view src,
+                            std::vector<RawSymbol> *macros) {
+  std::vector<Token> tokens;
+  const std::size_t n = src.size();
+  std::size_t i = 0;
+  uint32_t line = 0;
+  bool line_start = true;
+
+  auto skip_line = [&]() {
+    while (i < n && src[i] != '\n') {
+      if (src[i] == '\\' && i + 1 < n && src[i + 1] == '\n') {
+        ++line;
+        ++i;
+      }
+      ++i;
+    }
+  };
+  auto skip_blanks = [&]() {
+    while (i < n && (src[i] == ' ' || src[i] == '\t')) ++i;
+  };
+
+  while (i < n) {
+    char ch = src[i];
+    char next = i + 1 < n ? src[i + 1] : '\0';
+
+    if (ch == '\n') {
+      ++line;
+      line_start = true;
+      ++i;
+      continue;
+    }
+    if (std::isspace(static_cast<unsigned char>(ch))) {
+      ++i;
+      continue;
+    }
+    if (ch == '/' && next == '/') {
+      skip_line();
+      continue;
+    }
+    if (ch == '/' && next == '*') {
+      std::size_t end = src.find("*/", i + 2);
+      end = end == std::string_view::npos ? n : end + 2;
+      line += countLines(src, i, end);
+      i = end;
+      continue;
+    }
+    if (ch == '#' && line_start) {
+      ++i;
+      skip_blanks();
+      std::size_t start = i;
+      while (i < n && isIdentChar(src[i])) ++i;
+      if (src.substr(start, i - start) == "define") {
+        skip_blanks();
+        start = i;
+        while (i < n && isIdentChar(src[i])) ++i;
+        std::string_view name = src.substr(start, i - start);
+        auto ends_with = [&](std::string_view suffix) {
+          return name.size() >= suffix.size() &&
+                 name.substr(name.size() - suffix.size()) == suffix;
+        };
+        // include guards are not worth jumping to
+        if (!name.empty() && !ends_with("_H") && !ends_with("_H_") &&
+            !ends_with("_HPP")) {
+          macros->push_back({std::string(src.substr(start, i - start)), {},
+                             line, lsp::SymbolKind::Constant});
+        }
+      }
+      skip_line();
+      continue;
+    }
+    line_start = false;
+
+    if (ch == 'R' && next == '"') {  // R"delimiter(...)delimiter"
+      std::size_t open = src.find('(', i + 2);
+      if (open != std::string_view::npos) {
+        std::string closing =
+            ")" + std::string(src.substr(i + 2, open - i - 2)) + "\"";
+        std::size_t end = src.find(closing, open);
+        end = end == std::string_view::npos ? n : end + closing.size();
+        line += countLines(src, i, end);
+        i = end;
+        continue;
+      }
+    }
+    if (ch == '"' || ch == '\'') {
+      ++i;
+      while (i < n && src[i] != ch && src[i] != '\n') {
+        if (src[i] == '\\' && i + 1 < n) {
+          if (src[i + 1] == '\n') ++line;
+          ++i;
+        }
+        ++i;
+      }
+      if (i < n && src[i] == ch) ++i;
+      continue;
+    }
+    if (std::isdigit(static_cast<unsigned char>(ch))) {
+      // digit separators must not be taken for character literals
+      while (i < n && (isIdentChar(src[i]) || src[i] == '.' ||
+                       src[i] == '\'')) {
+        ++i;
+      }
+      continue;
+    }
+    if (isIdentStart(ch)) {
+      std::size_t start = i;
+      while (i < n && isIdentChar(src[i])) ++i;
+      tokens.push_back({src.substr(start, i - start), line, true});
+      continue;
+    }
+    if ((ch == ':' && next == ':') || (ch == '-' && next == '>')) {
+      tokens.push_back({src.substr(i, 2), line, false});
+      i += 2;
+      continue;
+    }
+    tokens.push_back({src.substr(i, 1), line, false});
+    ++i;
+  }
+  return tokens;
+}
+
+// Finds type, namespace, macro and function definitions. It is a heuristic
+// over the token stream, the goal is a good go-to-symbol, not a parser.
+std::vector<RawSymbol> extractSymbols(std::string_view src) {
+  std::vector<RawSymbol> symbols;
+  const std::vector<Token> tokens = tokenize(src, &symbols);
+  const std::size_t m = tokens.size();
+
+  auto is = [&](std::size_t k, std::string_view text) {
+    return k < m && tokens[k].text == text;
+  };
+  auto is_name = [&](std::size_t k) {
+    return k < m && tokens[k].identifier &&
+           keywords().count(tokens[k].text) == 0;
+  };
+  // a definition name follows a type, a scope or the end of the previous
+  // declaration, anything else is an expression
+  auto declaration_context = [&](std::size_t k) {
+    if (k == 0) return true;
+    const Token &prev = tokens[k - 1];
+    if (prev.identifier) {
+      return prev.text != "return" && prev.text != "new" &&
+             prev.text != "delete" && prev.text != "throw" &&
+             prev.text != "case" && prev.text != "else" &&
+             prev.text != "do" && prev.text != "sizeof";
+    }
+    if (prev.text == ":") {  // access specifier, not an initializer list
+      return k < 2 || tokens[k - 2].identifier;
+    }
+    if (prev.text == "&") {  // a reference, not a logical and
+      return k < 2 || tokens[k - 2].text != "&";
+    }
+    return prev.text == "*" || prev.text == ">" ||
+           prev.text == "::" || prev.text == "~" || prev.text == "}" ||
+           prev.text == ";" || prev.text == "{";
+  };
+  auto skip_parens = [&](std::size_t k) {  // k points to "("
+    int depth = 0;
+    for (; k < m; ++k) {
+      if (is(k, "(")) {
+        ++depth;
+      } else if (is(k, ")") && --depth == 0) {
+        return k + 1;
+      }
+    }
+    return m;
+  };
+
+  for (std::size_t k = 0; k < m; ++k) {
+    const Token &tok = tokens[k];
+    if (!tok.identifier) continue;
+
+    if (tok.text == "class" || tok.text == "struct" || tok.text == "union" ||
+        tok.text == "enum" || tok.text == "namespace") {
+      if (k > 0 && is(k - 1, "enum")) continue;  // handled with the enum
+      std::size_t j = k + 1;
+      if (tok.text == "enum" && (is(j, "class") || is(j, "struct"))) ++j;
+      // export macros stand between the keyword and the name
+      while (is_name(j) && is_name(j + 1)) ++j;
+      if (!is_name(j)) continue;
+      std::size_t last = j;
+      while (tok.text == "namespace" && is(last + 1, "::") &&
+             is_name(last + 2)) {
+        last += 2;
+      }
+      if (!is(last + 1, "{") && !is(last + 1, ":") && !is(last + 1, "final")) {
+        continue;  // forward declaration or elaborated type
+      }
+
+      RawSymbol sym;
+      sym.name = std::string(tokens[last].text);
+      if (last != j) sym.container = std::string(tokens[last - 2].text);
+      sym.line = tokens[last].line;
+      if (tok.text == "class") {
+        sym.kind = lsp::SymbolKind::Class;
+      } else if (tok.text == "enum") {
+        sym.kind = lsp::SymbolKind::Enum;
+      } else if (tok.text == "namespace") {
+        sym.kind = lsp::SymbolKind::Namespace;
+      } else {
+        sym.kind = lsp::SymbolKind::Struct;
+      }
+      symbols.push_back(std::move(sym));
+      continue;
+    }
+
+    if (!is(k + 1, "(") || keywords().count(tok.text) != 0) continue;
+    if (!declaration_context(k)) continue;
+
+    std::size_t j = skip_parens(k + 1);
+    if (j >= m) break;  // unbalanced till the end of file
+
+    const int MAX_TRAILING_TOKENS = 32;
+    for (int steps = 0; j < m && steps < MAX_TRAILING_TOKENS; ++steps) {
+      if (is(j, "const") || is(j, "override") || is(j, "final") ||
+          is(j, "volatile") || is(j, "&")) {
+        ++j;
+      } else if (is(j, "noexcept") || is(j, "throw")) {
+        ++j;
+        if (is(j, "(")) j = skip_parens(j);
+      } else if (is(j, "->")) {  // trailing return type
+        while (j < m && !is(j, "{") && !is(j, ";") && !is(j, "=")) ++j;
+      } else {
+        break;
+      }
+    }
+
+    bool body = is(j, "{");
+    // constructor with a member initializer list
+    if (is(j, ":") && j + 1 < m && tokens[j + 1].identifier) {
+      body = is(j + 2, "(") || is(j + 2, "{") || is(j + 2, "::");
+    }
+    if (!body) continue;
+
+    RawSymbol sym;
+    sym.name = std::string(tok.text);
+    std::size_t first = k;
+    if (first > 0 && is(first - 1, "~")) {
+      sym.name = "~" + sym.name;
+      --first;
+    }
+    if (first >= 2 && is(first - 1, "::") && tokens[first - 2].identifier) {
+      sym.container = std::string(tokens[first - 2].text);
+    }
+    sym.line = tok.line;
+    sym.kind = sym.container.empty() ? lsp::SymbolKind::Function
+                                     : lsp::SymbolKind::Method;
+    symbols.push_back(std::move(sym));
+  }
+  return symbols;
+}
+
+std::vector<uint32_t> trigramsOf(std::string_view text) {
+  std::vector<uint32_t> result;
+  for (std::size_t i = 0; i + 3 <= text.size(); ++i) {
+    auto lower = [&](std::size_t k) {
+      return static_cast<uint32_t>(
+          std::tolower(static_cast<unsigned char>(text[k])));
+    };
+    result.push_back(lower(i) << 16 | lower(i + 1) << 8 | lower(i + 2));
+  }
+  return result;
+}
+
+std::vector<RawSymbol> readSymbols(const IndexView &view, uint32_t file) {
+  const FileRecord &rec = view.file(file);
+  std::vector<RawSymbol> result;
+  result.reserve(rec.symbol_count);
+  for (uint32_t i = 0; i < rec.symbol_count; ++i) {
+    const SymbolRecord &sym = view.symbol(rec.first_symbol + i);
+    RawSymbol raw;
+    raw.name = std::string(view.string(sym.name_offset, sym.name_length));
+    raw.container =
+        std::string(view.string(sym.container_offset, sym.container_length));
+    raw.line = sym.line;
+    raw.kind = static_cast<lsp::SymbolKind>(sym.kind);
+    result.push_back(std::move(raw));
+  }
+  return result;
+}
+
+template <typename T>
+void appendRecords(QByteArray *out, const std::vector<T> &records) {
+  out->append(reinterpret_cast<const char *>(records.data()),
+              static_cast<int>(records.size() * sizeof(T)));
+}
+
+QByteArray serialize(const std::vector<FileSymbols> &files) {
+  std::string strings;
+  std::unordered_map<std::string, uint32_t> interned;
+  auto intern = [&](const std::string &s) {
+    auto [it, inserted] =
+        interned.emplace(s, static_cast<uint32_t>(strings.size()));
+    if (inserted) strings += s;
+    return it->second;
+  };
+
+  std::vector<FileRecord> file_records;
+  std::vector<SymbolRecord> symbol_records;
+  std::vector<std::pair<uint32_t, uint32_t>> occurrences;  // trigram, symbol
+  file_records.reserve(files.size());
+
+  for (const FileSymbols &file : files) {
+    FileRecord rec{};
+    rec.mtime = file.mtime;
+    rec.size = file.size;
+    rec.path_offset = intern(file.path);
+    rec.path_length = static_cast<uint32_t>(file.path.size());
+    rec.first_symbol = static_cast<uint32_t>(symbol_records.size());
+    rec.symbol_count = static_cast<uint32_t>(file.symbols.size());
+
+    for (const RawSymbol &raw : file.symbols) {
+      SymbolRecord sym{};
+      sym.name_offset = intern(raw.name);
+      sym.name_length = static_cast<uint32_t>(raw.name.size());
+      sym.container_offset = intern(raw.container);
+      sym.container_length = static_cast<uint32_t>(raw.container.size());
+      sym.file = static_cast<uint32_t>(file_records.size());
+      sym.line = raw.line;
+      sym.kind = static_cast<uint32_t>(raw.kind);
+
+      uint32_t id = static_cast<uint32_t>(symbol_records.size());
+      for (uint32_t trigram : trigramsOf(raw.name)) {
+        occurrences.emplace_back(trigram, id);
+      }
+      symbol_records.push_back(sym);
+    }
+    file_records.push_back(rec);
+  }
+
+  std::sort(occurrences.begin(), occurrences.end());
+  occurrences.erase(std::unique(occurrences.begin(), occurrences.end()),
+                    occurrences.end());
+  std::vector<TrigramRecord> trigram_records;
+  std::vector<uint32_t> postings;
+  postings.reserve(occurrences.size());
+  for (const auto &[trigram, id] : occurrences) {
+    if (trigram_records.empty() || trigram_records.back().trigram != trigram) {
+      trigram_records.push_back(
+          {trigram, static_cast<uint32_t>(postings.size()), 0});
+    }
+    ++trigram_records.back().posting_count;
+    postings.push_back(id);
+  }
+
+  Header header{};
+  std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+  header.file_count = static_cast<uint32_t>(file_records.size());
+  header.symbol_count = static_cast<uint32_t>(symbol_records.size());
+  header.trigram_count = static_cast<uint32_t>(trigram_records.size());
+  header.posting_count = static_cast<uint32_t>(postings.size());
+  header.strings_size = static_cast<uint32_t>(strings.size());
+
+  QByteArray out;
+  out.reserve(static_cast<int>(
+      sizeof(header) + file_records.size() * sizeof(FileRecord) +
+      symbol_records.size() * sizeof(SymbolRecord) +
+      trigram_records.size() * sizeof(TrigramRecord) +
+      postings.size() * sizeof(uint32_t) + strings.size()));
+  out.append(reinterpret_cast<const char *>(&header), sizeof(header));
+  appendRecords(&out, file_records);
+  appendRecords(&out, symbol_records);
+  appendRecords(&out, trigram_records);
+  appendRecords(&out, postings);
+  out.append(strings.data(), static_cast<int>(strings.size()));
+  return out;
+}
+
+// Runs on the worker thread. With full == false only the dirty directories
+// are listed again, the other files of the previous index are kept unless
+// their size or mtime changed. Returns false when nothing was written.
+bool buildIndex(const QString &root, const QString &index_path,
+                const QStringList &dirty_dirs, bool full,
+                const QSet<QString> &known_dirs,
+                const std::atomic<bool> &cancelled,
+                QStringList *directories) {
+  const qint64 MAX_FILE_SIZE = 8 * 1024 * 1024;  // generated code
+
+  QFile old_file(index_path);
+  uchar *old_data = nullptr;
+  if (old_file.open(QIODevice::ReadOnly) && old_file.size() > 0) {
+    old_data = old_file.map(0, old_file.size());
+  }
+  IndexView old(old_data, old_data ? old_file.size() : 0);
+  // a damaged index is rebuilt from scratch
+  if (old.valid() && !old.checkRanges()) old = IndexView(nullptr, 0);
+  full = full || !old.valid();
+
+  std::unordered_map<std::string, uint32_t> old_files;
+  if (old.valid()) {
+    for (uint32_t i = 0; i < old.fileCount(); ++i) {
+      const FileRecord &rec = old.file(i);
+      old_files.emplace(std::string(old.string(rec.path_offset,
+                                               rec.path_length)),
+                        i);
+    }
+  }
+
+  QSet<QString> dirty(dirty_dirs.begin(), dirty_dirs.end());
+  QStringList paths;
+  if (full) {
+    paths = workspace::ListFiles(root, directories, &cancelled);
+  } else {
+    for (const auto &entry : old_files) {
+      QString file = QString::fromStdString(entry.first);
+      if (!dirty.contains(QFileInfo(file).path())) paths.append(file);
+    }
+    for (const QString &dir : dirty_dirs) {
+      paths += workspace::ListDirectory(root, dir, known_dirs, directories,
+                                        &cancelled);
+    }
+  }
+
+  bool changed = full || !dirty_dirs.isEmpty();
+  std::vector<FileSymbols> files;
+  for (const QString &path : paths) {
+    if (cancelled.load()) return false;
+    if (!workspace::IsSourceFile(path)) continue;
+
+    FileSymbols entry;
+    entry.path = path.toStdString();
+    auto old_it = old_files.find(entry.path);
+    // a file written in place does not show in the directory watches, so
+    // every file is checked
+    QFileInfo info(path);
+    if (!info.isFile()) {
+      changed = true;
+      continue;
+    }
+    entry.mtime = info.lastModified().toMSecsSinceEpoch();
+    entry.size = info.size();
+    if (old_it != old_files.end() &&
+        old.file(old_it->second).mtime == entry.mtime &&
+        old.file(old_it->second).size == entry.size) {
+      entry.symbols = readSymbols(old, old_it->second);
+      files.push_back(std::move(entry));
+      continue;
+    }
+    changed = true;
+    if (entry.size > 0 && entry.size <= MAX_FILE_SIZE) {
+      QFile source(path);
+      if (source.open(QIODevice::ReadOnly)) {
+        uchar *data = source.map(0, entry.size);
+        if (data != nullptr) {
+          entry.symbols = extractSymbols(std::string_view(
+              reinterpret_cast<const char *>(data), entry.size));
+          source.unmap(data);
+        }
+      }
+    }
+    files.push_back(std::move(entry));
+  }
+  if (old_data != nullptr) old_file.unmap(old_data);
+  old_file.close();
+  if (!changed) return false;
+
+  QDir().mkpath(QFileInfo(index_path).path());
+  QSaveFile out(index_path);
+  if (!out.open(QIODevice::WriteOnly)) return false;
+  out.write(serialize(files));
+  return !cancelled.load() && out.commit();
+}
+
+}  // namespace
+
+SymbolIndex::SymbolIndex(workspace::Watcher *watcher, QObject *parent)
+    : QObject(parent),
+      watcher_(watcher),
+      cancelled_(std::make_shared<std::atomic<bool>>(false)) {
+  const int REBUILD_DELAY_MS = 1000;
+  rebuild_timer_.setSingleShot(true);
+  rebuild_timer_.setInterval(REBUILD_DELAY_MS);
+  connect(&rebuild_timer_, &QTimer::timeout, this, &SymbolIndex::startRebuild);
+  const int RESCAN_INTERVAL_MS = 60000;
+  rescan_timer_.setInterval(RESCAN_INTERVAL_MS);
+  connect(&rescan_timer_, &QTimer::timeout, this, [this]() {
+    if (!worker_) startRebuild();
+  });
+  connect(watcher_, &workspace::Watcher::directoryChanged, this,
+          &SymbolIndex::directoryChanged);
+}
+
+SymbolIndex::~SymbolIndex() {
+  stopWorker();
+  unmapIndex();
+}
+
+void SymbolIndex::setRoot(const QString &root) {
+  QString cleaned = QDir::cleanPath(root);
+  if (root.isEmpty() || cleaned == root_) return;
+
+  stopWorker();
+  unmapIndex();
+  watcher_->setRoot(cleaned);
+  directories_.clear();
+
+  root_ = cleaned;
+  QByteArray hash =
+      QCryptographicHash::hash(root_.toUtf8(), QCryptographicHash::Sha1);
+  index_path_ =
+      QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+      "/symbols-" + QString::fromLatin1(hash.toHex()) + ".idx";
+
+  // the index of the previous session answers until the refresh is done
+  mapIndex();
+  dirty_dirs_.clear();
+  full_rebuild_ = true;
+  startRebuild();
+  rescan_timer_.start();
+}
+
+QString SymbolIndex::root() const { return root_; }
+
+std::vector<IndexedSymbol> SymbolIndex::find(const QString &query,
+                                             std::size_t limit) const {
+  IndexView view(data_, size_);
+  if (!view.valid() || query.isEmpty()) return {};
+
+  std::string needle = query.toStdString();
+  std::transform(needle.begin(), needle.end(), needle.begin(), [](char ch) {
+    return static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+  });
+
+  // candidates are the intersection of the posting lists of all trigrams of
+  // the query, short queries fall back to a scan over the symbol table
+  std::vector<uint32_t> candidates;
+  bool scan_all = needle.size() < 3;
+  if (!scan_all) {
+    std::vector<std::pair<const uint32_t *, uint32_t>> lists;
+    for (uint32_t trigram : trigramsOf(needle)) {
+      auto list = view.postings(trigram);
+      if (list.second == 0) return {};
+      lists.push_back(list);
+    }
+    std::sort(lists.begin(), lists.end(), [](const auto &l, const auto &r) {
+      return l.second < r.second;
+    });
+    candidates.assign(lists[0].first, lists[0].first + lists[0].second);
+    for (std::size_t i = 1; i < lists.size() && !candidates.empty(); ++i) {
+      std::vector<uint32_t> next;
+      std::set_intersection(candidates.begin(), candidates.end(),
+                            lists[i].first, lists[i].first + lists[i].second,
+                            std::back_inserter(next));
+      candidates.swap(next);
+    }
+  }
+
+  struct Match {
+    int rank;
+    uint32_t length;
+    uint32_t id;
+    bool operator<(const Match &oth) const {
+      return std::tie(rank, length, id) <
+             std::tie(oth.rank, oth.length, oth.id);
+    }
+  };
+  std::vector<Match> matches;
+  auto consider = [&](uint32_t id) {
+    const SymbolRecord &sym = view.symbol(id);
+    std::string_view name = view.string(sym.name_offset, sym.name_length);
+    auto it = std::search(name.begin(), name.end(), needle.begin(),
+                          needle.end(), [](char lhs, char rhs) {
+                            return std::tolower(static_cast<unsigned char>(
+                                       lhs)) == rhs;
+                          });
+    if (it == name.end()) return;
+    int rank = 2;
+    if (it == name.begin()) rank = name.size() == needle.size() ? 0 : 1;
+    matches.push_back({rank, sym.name_length, id});
+  };
+  if (scan_all) {
+    for (uint32_t id = 0; id < view.symbolCount(); ++id) consider(id);
+  } else {
+    for (uint32_t id : candidates) consider(id);
+  }
+
+  std::size_t count = std::min(limit, matches.size());
+  std::partial_sort(matches.begin(), matches.begin() + count, matches.end());
+
+  std::vector<IndexedSymbol> result;
+  result.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    const SymbolRecord &sym = view.symbol(matches[i].id);
+    const FileRecord &file = view.file(sym.file);
+    auto to_qstring = [](std::string_view s) {
+      return QString::fromUtf8(s.data(), static_cast<int>(s.size()));
+    };
+    IndexedSymbol symbol;
+    symbol.name = to_qstring(view.string(sym.name_offset, sym.name_length));
+    symbol.container = to_qstring(
+        view.string(sym.container_offset, sym.container_length));
+    symbol.path = to_qstring(view.string(file.path_offset, file.path_length));
+    symbol.line = static_cast<int>(sym.line);
+    symbol.kind = static_cast<lsp::SymbolKind>(sym.kind);
+    result.push_back(std::move(symbol));
+  }
+  return result;
+}
+
+void SymbolIndex::directoryChanged(const QString &path) {
+  if (!QFileInfo(path).isDir()) directories_.remove(path);
+  if (!dirty_dirs_.contains(path)) dirty_dirs_.append(path);
+  rebuild_timer_.start();
+}
+
+void SymbolIndex::startRebuild() {
+  if (root_.isEmpty()) return;
+  if (worker_) {  // try again once the running rebuild is over
+    rebuild_timer_.start();
+    return;
+  }
+
+  QString root = root_;
+  QString index_path = index_path_;
+  QStringList dirty = dirty_dirs_;
+  QSet<QString> known = directories_;
+  bool full = full_rebuild_;
+  dirty_dirs_.clear();
+  full_rebuild_ = false;
+
+  cancelled_ = std::make_shared<std::atomic<bool>>(false);
+  auto cancelled = cancelled_;
+  worker_ = QThread::create([this, root, index_path, dirty, full, known,
+                             cancelled]() {
+    QStringList directories;
+    if (!buildIndex(root, index_path, dirty, full, known, *cancelled,
+                    &directories)) {
+      return;
+    }
+    QMetaObject::invokeMethod(
+        this,
+        [this, root, directories, full]() {
+          if (root == root_) rebuildFinished(directories, full);
+        },
+        Qt::QueuedConnection);
+  });
+  connect(worker_, &QThread::finished, worker_, &QObject::deleteLater);
+  worker_->start(QThread::LowPriority);
+}
+
+void SymbolIndex::rebuildFinished(const QStringList &directories,
+                                  bool full) {
+  unmapIndex();
+  mapIndex();
+  if (full) directories_.clear();
+  for (const QString &dir : directories) directories_.insert(dir);
+  watcher_->watch(directories);
+  emit updated();
+}
+
+void SymbolIndex::mapIndex() {
+  index_file_.setFileName(index_path_);
+  if (!index_file_.open(QIODevice::ReadOnly)) return;
+  size_ = index_file_.size();
+  data_ = size_ > 0 ? index_file_.map(0, size_) : nullptr;
+  IndexView view(data_, size_);
+  if (!view.valid() || !view.checkRanges()) unmapIndex();
+}
+
+void SymbolIndex::unmapIndex() {
+  if (data_ != nullptr) index_file_.unmap(data_);
+  data_ = nullptr;
+  size_ = 0;
+  index_file_.close();
+}
+
+void SymbolIndex::stopWorker() {
+  cancelled_->store(true);
+  if (worker_) {
+    worker_->wait();
+    delete worker_;
+  }
+}
@@ -0,0 +1,232 @@
+#include "symbol_palette.h"
+
+#include <QDir>
+#include <QKeyEvent>
+#include <QSet>
+#include <QUrl>
+#include <QVBoxLayout>
+#include <utility>
+
+namespace {
+
+const int PATH_ROLE = Qt::UserRole + 1;
+const int LINE_ROLE = Qt::UserRole + 2;
+// clangd's default for --limit-results, a shorter answer is complete
+const std::size_t SERVER_LIMIT = 100;
+const std::size_t MAX_RESULTS = 200;
+
+QString kindName(lsp::SymbolKind kind) {
+  switch (kind) {
+    case lsp::SymbolKind::Namespace:
+      return "ns";
+    case lsp::SymbolKind::Class:
+    case lsp::SymbolKind::Struct:
+      return "type";
+    case lsp::SymbolKind::Enum:
+    case lsp::SymbolKind::EnumMember:
+      return "enum";
+    case lsp::SymbolKind::Field:
+    case lsp::SymbolKind::Variable:
+    case lsp::SymbolKind::Property:
+      return "var";
+    case lsp::SymbolKind::Constant:
+      return "const";
+    default:
+      return "fn";
+  }
+}
+
+QString qualifiedName(const IndexedSymbol &symbol) {
+  return symbol.container.isEmpty() ? symbol.name
+                                    : symbol.container + "::" + symbol.name;
+}
+
+// clangd matches fuzzily, so every result for a longer query contains the
+// query as a subsequence of the qualified name
+bool subsequence(const QString &query, const QString &text) {
+  int pos = 0;
+  for (QChar ch : query) {
+    pos = text.indexOf(ch, pos, Qt::CaseInsensitive);
+    if (pos < 0) return false;
+    ++pos;
+  }
+  return true;
+}
+
+}  // namespace
+
+SymbolPalette::SymbolPalette(SymbolIndex *index, FileView *server,
+                             QWidget *parent)
+    : QDialog(parent, Qt::Popup),
+      index_(index),
+      input_(new QLineEdit(this)),
+      results_(new QListWidget(this)) {
+  QVBoxLayout *layout = new QVBoxLayout(this);
+  layout->setContentsMargins(4, 4, 4, 4);
+  layout->addWidget(input_);
+  layout->addWidget(results_);
+  input_->setPlaceholderText(tr("Symbol name"));
+  results_->setUniformItemSizes(true);
+  input_->installEventFilter(this);
+
+  const int REQUEST_DELAY_MS = 100;
+  request_timer_.setSingleShot(true);
+  request_timer_.setInterval(REQUEST_DELAY_MS);
+  connect(&request_timer_, &QTimer::timeout, this,
+          &SymbolPalette::requestServer);
+  setServer(server);
+
+  const int WIDTH = 600;
+  const int HEIGHT = 400;
+  resize(WIDTH, HEIGHT);
+
+  connect(input_, &QLineEdit::textChanged, this, &SymbolPalette::search);
+  connect(input_, &QLineEdit::returnPressed, this, &SymbolPalette::choose);
+  connect(results_, &QListWidget::itemActivated, this, &SymbolPalette::choose);
+  // a finished rebuild may bring the symbol the user is looking for
+  connect(index_, &SymbolIndex::updated, this, [this]() {
+    if (isVisible()) search();
+  });
+}
+
+void SymbolPalette::setServer(FileView *server) {
+  if (server_ == server) return;
+  if (server_) disconnect(server_, nullptr, this, nullptr);
+  server_ = server;
+  if (server_) {
+    connect(server_, &FileView::DoneWorkspaceSymbol, this,
+            &SymbolPalette::serverAnswered);
+  }
+  // a query still pending in the old session will never be answered
+  requested_.clear();
+}
+
+void SymbolPalette::popup() {
+  if (parentWidget() != nullptr) {
+    QWidget *window = parentWidget()->window();
+    move(window->mapToGlobal(
+        QPoint((window->width() - width()) / 2, window->height() / 8)));
+  }
+  // the workspace may have changed since the last time
+  server_cache_.clear();
+  requested_.clear();
+  input_->clear();
+  results_->clear();
+  show();
+  input_->setFocus();
+}
+
+bool SymbolPalette::eventFilter(QObject *watched, QEvent *event) {
+  if (watched == input_ && event->type() == QEvent::KeyPress) {
+    auto *key_event = static_cast<QKeyEvent *>(event);
+    switch (key_event->key()) {
+      case Qt::Key_Up:
+      case Qt::Key_Down:
+      case Qt::Key_PageUp:
+      case Qt::Key_PageDown:
+        QCoreApplication::sendEvent(results_, event);
+        return true;
+      default:
+        break;
+    }
+  }
+  return QDialog::eventFilter(watched, event);
+}
+
+void SymbolPalette::search() {
+  results_->clear();
+  QString query = input_->text().trimmed();
+  if (query.isEmpty()) {
+    request_timer_.stop();
+    return;
+  }
+
+  bool complete = false;
+  std::vector<IndexedSymbol> symbols = cachedSymbols(query, &complete);
+  if (complete) {
+    request_timer_.stop();
+  } else {
+    request_timer_.start();
+  }
+  // server results go first, they are ranked by clangd
+  for (IndexedSymbol &symbol : index_->find(query, MAX_RESULTS)) {
+    symbols.push_back(std::move(symbol));
+  }
+
+  QDir root(index_->root());
+  QSet<QString> shown;
+  for (const IndexedSymbol &symbol : symbols) {
+    if (static_cast<std::size_t>(results_->count()) >= MAX_RESULTS) break;
+    QString location = QString("%1:%2")
+                           .arg(index_->root().isEmpty()
+                                    ? symbol.path
+                                    : root.relativeFilePath(symbol.path))
+                           .arg(symbol.line + 1);
+    if (shown.contains(location)) continue;
+    shown.insert(location);
+    QListWidgetItem *item = new QListWidgetItem(
+        QString("[%1] %2  %3")
+            .arg(kindName(symbol.kind), qualifiedName(symbol), location),
+        results_);
+    item->setData(PATH_ROLE, symbol.path);
+    item->setData(LINE_ROLE, symbol.line);
+  }
+  results_->setCurrentRow(0);
+}
+
+std::vector<IndexedSymbol> SymbolPalette::cachedSymbols(const QString &query,
+                                                        bool *complete) const {
+  *complete = false;
+  for (int length = query.size(); length > 0; --length) {
+    auto it = server_cache_.constFind(query.left(length));
+    if (it == server_cache_.constEnd()) continue;
+    if (length == query.size()) {
+      *complete = true;
+      return it.value();
+    }
+    std::vector<IndexedSymbol> result;
+    for (const IndexedSymbol &symbol : it.value()) {
+      if (subsequence(query, qualifiedName(symbol))) result.push_back(symbol);
+    }
+    *complete = it.value().size() < SERVER_LIMIT;
+    return result;
+  }
+  return {};
+}
+
+void SymbolPalette::requestServer() {
+  QString query = input_->text().trimmed();
+  if (!server_ || query.isEmpty() || requested_.contains(query)) return;
+  requested_.insert(query);
+  server_->RequestWorkspaceSymbol(query.toStdString());
+}
+
+void SymbolPalette::serverAnswered(
+    const std::string &query,
+    const std::vector<lsp::SymbolInformation> &symbols) {
+  std::vector<IndexedSymbol> converted;
+  converted.reserve(symbols.size());
+  for (const lsp::SymbolInformation &info : symbols) {
+    IndexedSymbol symbol;
+    symbol.name = QString::fromStdString(info.name);
+    symbol.container = QString::fromStdString(info.containerName);
+    symbol.path =
+        QUrl(QString::fromStdString(info.location.uri)).toLocalFile();
+    symbol.line = static_cast<int>(info.location.range.start.line);
+    symbol.kind = info.kind;
+    converted.push_back(std::move(symbol));
+  }
+  QString key = QString::fromStdString(query);
+  server_cache_.insert(key, std::move(converted));
+
+  // an answer for a prefix of what is typed now is still worth showing
+  if (isVisible() && input_->text().trimmed().startsWith(key)) search();
+}
+
+void SymbolPalette::choose() {
+  QListWidgetItem *item = results_->currentItem();
+  if (item == nullptr) return;
+  hide();
+  emit symbolChosen(item->data(PATH_ROLE).toString(),
+                    item->data(LINE_ROLE).toInt());
+}
@@ -1,42 +1,335 @@
 #include "terminal.h"
 
-#include <QLineEdit>
+#include <QApplication>
+#include <QClipboard>
+#include <QElapsedTimer>
+#include <QKeyEvent>
+#include <QMenu>
+#include <QPainter>
+#include <QScrollBar>
+#include <utility>
 
-#include "ui_terminal.h"
+#include "startup_trace.h"
 
-Terminal::Terminal(QWidget *parent) : QWidget(parent), ui(new Ui::Terminal) {
-  ui->setupUi(this);
-  QPalette p = palette();
-  p.setColor(QPalette::Base, Qt::black);
-  p.setColor(QPalette::Text, Qt::green);
-  setPalette(p);
-  process = new QProcess;
-  process->start("bash", {}, QIODevice::ReadWrite);
-  process->waitForStarted();
-  connect(process, &QProcess::readyReadStandardOutput, this,
-          &Terminal::readStandardOutput);
-  connect(process, &QProcess::readyReadStandardError, this,
-          &Terminal::readStandardError);
-  connect(ui->lineEdit, &QLineEdit::returnPressed, this, &Terminal::command);
+namespace {
+
+const int SCROLLBACK_LINES = 10000;
+// output is parsed and painted at most once per frame
+const int FRAME_MS = 16;
+// part of a frame spent parsing, in chunks of PARSE_CHUNK_BYTES
+const int PARSE_BUDGET_MS = 8;
+const int PARSE_CHUNK_BYTES = 1 << 16;
+const int INITIAL_ROWS = 24;
+const int INITIAL_COLUMNS = 80;
+
+QColor paletteColor(quint16 index, bool foreground) {
+  if (index == TerminalScreen::DEFAULT_COLOR) {
+    return foreground ? Qt::green : Qt::black;
+  }
+  if (index < 16) {
+    static const QRgb BASIC_COLORS[16] = {
+        0x000000, 0xcd0000, 0x00cd00, 0xcdcd00, 0x0000ee, 0xcd00cd,
+        0x00cdcd, 0xe5e5e5, 0x7f7f7f, 0xff0000, 0x00ff00, 0xffff00,
+        0x5c5cff, 0xff00ff, 0x00ffff, 0xffffff};
+    return QColor(BASIC_COLORS[index]);
+  }
+  if (index < 232) {
+    int cube = index - 16;
+    auto level = [](int value) { return value == 0 ? 0 : 55 + 40 * value; };
+    return QColor(level(cube / 36), level(cube / 6 % 6), level(cube % 6));
+  }
+  int gray = 8 + (index - 232) * 10;
+  return QColor(gray, gray, gray);
+}
+
+bool sameStyle(const TerminalScreen::Cell &a, const TerminalScreen::Cell &b) {
+  return a.foreground == b.foreground && a.background == b.background &&
+         a.attributes == b.attributes;
+}
+
+// What xterm sends for the key
+QByteArray keyInput(const QKeyEvent *event, bool application_cursor_keys) {
+  QByteArray cursor_prefix = application_cursor_keys ? "\x1bO" : "\x1b[";
+  switch (event->key()) {
+    case Qt::Key_Return:
+    case Qt::Key_Enter:
+      return "\r";
+    case Qt::Key_Backspace:
+      return "\x7f";
+    case Qt::Key_Tab:
+      return "\t";
+    case Qt::Key_Backtab:
+      return "\x1b[Z";
+    case Qt::Key_Escape:
+      return "\x1b";
+    case Qt::Key_Up:
+      return cursor_prefix + 'A';
+    case Qt::Key_Down:
+      return cursor_prefix + 'B';
+    case Qt::Key_Right:
+      return cursor_prefix + 'C';
+    case Qt::Key_Left:
+      return cursor_prefix + 'D';
+    case Qt::Key_Home:
+      return cursor_prefix + 'H';
+    case Qt::Key_End:
+      return cursor_prefix + 'F';
+    case Qt::Key_Insert:
+      return "\x1b[2~";
+    case Qt::Key_Delete:
+      return "\x1b[3~";
+    case Qt::Key_PageUp:
+      return "\x1b[5~";
+    case Qt::Key_PageDown:
+      return "\x1b[6~";
+    default:
+      break;
+  }
+  if ((event->modifiers() & Qt::ControlModifier) &&
+      event->key() >= Qt::Key_A && event->key() <= Qt::Key_Z) {
+    return QByteArray(1, static_cast<char>(event->key() - Qt::Key_A + 1));
+  }
+  QByteArray text = event->text().toUtf8();
+  if ((event->modifiers() & Qt::AltModifier) && !text.isEmpty()) {
+    text.prepend('\x1b');
+  }
+  return text;
+}
+
+}  // namespace
+
+Terminal::Terminal(QWidget *parent)
+    : QAbstractScrollArea(parent),
+      process_(new PtyProcess(this)),
+      screen_(INITIAL_ROWS, INITIAL_COLUMNS, SCROLLBACK_LINES) {
+  QFont font("Monospace");
+  font.setStyleHint(QFont::TypeWriter);
+  font.setFixedPitch(true);
+  setFont(font);
+  bold_font_ = font;
+  bold_font_.setBold(true);
+  QFontMetrics metrics(font);
+  cell_width_ = qMax(1, metrics.horizontalAdvance('M'));
+  line_height_ = qMax(1, metrics.height());
+  ascent_ = metrics.ascent();
+
+  setFocusPolicy(Qt::StrongFocus);
+  setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+  setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
+  // every pixel is painted by paintEvent
+  viewport()->setAttribute(Qt::WA_OpaquePaintEvent);
+  viewport()->setCursor(Qt::IBeamCursor);
+
+  follow_tail_ = new QAction(tr("&Follow Tail"), this);
+  follow_tail_->setCheckable(true);
+  follow_tail_->setChecked(true);
+
+  frame_timer_.setSingleShot(true);
+  frame_timer_.setInterval(FRAME_MS);
+  connect(&frame_timer_, &QTimer::timeout, this, &Terminal::renderFrame);
+  connect(process_, &PtyProcess::readyRead, this, &Terminal::outputReady);
+  connect(process_, &PtyProcess::finished, this, &Terminal::shellFinished);
+}
+
+Terminal::~Terminal() {}
+
+void Terminal::start() {
+  if (process_->isRunning()) return;
+  startup_trace::Phase phase("terminal spawn");
+  if (!process_->start("bash", {}, screen_.rows(), screen_.columns())) {
+    screen_.feed(tr("Cannot start bash.\r\n").toUtf8());
+    renderFrame();
+  }
+}
+
+void Terminal::outputReady() {
+  if (!frame_timer_.isActive()) frame_timer_.start();
+}
+
+void Terminal::renderFrame() {
+  QElapsedTimer clock;
+  clock.start();
+  while (process_->bytesAvailable() > 0 && clock.elapsed() < PARSE_BUDGET_MS) {
+    screen_.feed(process_->read(PARSE_CHUNK_BYTES));
+  }
+  if (process_->bytesAvailable() > 0) {
+    frame_timer_.start();
+  } else if (!exit_message_.isEmpty()) {
+    screen_.feed(exit_message_);
+    exit_message_.clear();
+  }
+  QByteArray replies = screen_.takeReplies();
+  if (!replies.isEmpty()) process_->write(replies);
+
+  TerminalScreen::Damage damage = screen_.takeDamage();
+  QScrollBar *bar = verticalScrollBar();
+  int top = bar->value();
+  bool at_bottom = top == bar->maximum();
+  bool following = at_bottom || follow_tail_->isChecked();
+  {
+    // the view is moved below, without scrollContentsBy
+    QSignalBlocker blocker(bar);
+    bar->setRange(0, screen_.scrollbackCount());
+    bar->setPageStep(screen_.rows());
+    bar->setValue(following ? bar->maximum() : top - damage.dropped);
+  }
+
+  if (damage.all || (following && !at_bottom) ||
+      (following && damage.scrolled >= screen_.rows()) ||
+      (!following && top < damage.dropped)) {
+    viewport()->update();
+  } else {
+    // lines keep their index while they move into the scrollback, a view
+    // which does not follow only repaints the changed lines it shows
+    if (following && damage.scrolled > 0) {
+      viewport()->scroll(0, -damage.scrolled * line_height_);
+    }
+    for (int row : damage.rows) updateLine(screen_.scrollbackCount() + row);
+  }
+  updateLine(painted_cursor_ - damage.dropped);
+  updateLine(screen_.scrollbackCount() + screen_.cursorRow());
+}
+
+void Terminal::shellFinished(int exitCode) {
+  exit_message_ = tr("\r\n[Process exited with code %1, press a key to "
+                     "restart]\r\n")
+                      .arg(exitCode)
+                      .toUtf8();
+  outputReady();
+}
+
+void Terminal::updateLine(int index) {
+  int row = index - verticalScrollBar()->value();
+  if (index < 0 || row < 0 || row * line_height_ >= viewport()->height()) {
+    return;
+  }
+  viewport()->update(0, row * line_height_, viewport()->width(),
+                     line_height_);
+}
+
+void Terminal::paintEvent(QPaintEvent *event) {
+  QPainter painter(viewport());
+  QRect area = event->rect();
+  painter.fillRect(area, paletteColor(TerminalScreen::DEFAULT_COLOR, false));
+
+  int top = verticalScrollBar()->value();
+  int first = top + area.top() / line_height_;
+  int last = qMin(screen_.lineCount() - 1, top + area.bottom() / line_height_);
+  QString text;
+  for (int index = first; index <= last; ++index) {
+    const TerminalScreen::Line &line = screen_.line(index);
+    int y = (index - top) * line_height_;
+    int size = static_cast<int>(line.size());
+    // cells of the same style are drawn as one run
+    for (int column = 0; column < size;) {
+      const TerminalScreen::Cell &cell = line[column];
+      int end = column;
+      bool blank = true;
+      text.clear();
+      for (; end < size && sameStyle(line[end], cell); ++end) {
+        text += QChar(line[end].character);
+        blank = blank && line[end].character == ' ';
+      }
+      QColor foreground = paletteColor(cell.foreground, true);
+      QColor background = paletteColor(cell.background, false);
+      if (cell.attributes & TerminalScreen::INVERSE) {
+        std::swap(foreground, background);
+      }
+      QRect run(column * cell_width_, y, (end - column) * cell_width_,
+                line_height_);
+      if (cell.background != TerminalScreen::DEFAULT_COLOR ||
+          (cell.attributes & TerminalScreen::INVERSE)) {
+        painter.fillRect(run, background);
+      }
+      if (!blank) {
+        painter.setPen(foreground);
+        painter.setFont(cell.attributes & TerminalScreen::BOLD ? bold_font_
+                                                               : font());
+        painter.drawText(run.left(), y + ascent_, text);
+      }
+      if (cell.attributes & TerminalScreen::UNDERLINE) {
+        painter.setPen(foreground);
+        painter.drawLine(run.left(), y + ascent_ + 1, run.right(),
+                         y + ascent_ + 1);
+      }
+      column = end;
+    }
+  }
+
+  painted_cursor_ = screen_.scrollbackCount() + screen_.cursorRow();
+  if (screen_.cursorVisible() && painted_cursor_ >= first &&
+      painted_cursor_ <= last) {
+    QRect cursor(screen_.cursorColumn() * cell_width_,
+                 (painted_cursor_ - top) * line_height_, cell_width_,
+                 line_height_);
+    QColor color = paletteColor(TerminalScreen::DEFAULT_COLOR, true);
+    if (hasFocus()) {
+      painter.setCompositionMode(QPainter::RasterOp_SourceXorDestination);
+      painter.fillRect(cursor, color);
+    } else {
+      painter.setPen(color);
+      painter.drawRect(cursor.adjusted(0, 0, -1, -1));
+    }
+  }
 }
 
-Terminal::~Terminal() { delete ui; }
+void Terminal::resizeEvent(QResizeEvent *event) {
+  QAbstractScrollArea::resizeEvent(event);
+  resizeScreen();
+}
 
-void Terminal::readStandardOutput() {
-  ui->textBrowser->append(process->readAllStandardOutput());
-  ui->textBrowser->append(process->readAllStandardError());
+void Terminal::resizeScreen() {
+  int rows = qMax(1, viewport()->height() / line_height_);
+  int columns = qMax(1, viewport()->width() / cell_width_);
+  if (rows == screen_.rows() && columns == screen_.columns()) return;
+  screen_.resize(rows, columns);
+  process_->resize(rows, columns);
+  renderFrame();
 }
 
-void Terminal::readStandardError() {
-  QByteArray cmdout = process->readAllStandardError();
-  if (!cmdout.isEmpty()) {
-    ui->textBrowser->setTextColor(Qt::red);
-    ui->textBrowser->append(QString::fromLocal8Bit(cmdout));
-    ui->textBrowser->setTextColor(Qt::green);
+void Terminal::keyPressEvent(QKeyEvent *event) {
+  Qt::KeyboardModifiers modifiers = event->modifiers();
+  if (modifiers == Qt::ShiftModifier && (event->key() == Qt::Key_PageUp ||
+                                         event->key() == Qt::Key_PageDown)) {
+    verticalScrollBar()->triggerAction(event->key() == Qt::Key_PageUp
+                                           ? QScrollBar::SliderPageStepSub
+                                           : QScrollBar::SliderPageStepAdd);
+    return;
+  }
+  if (modifiers == (Qt::ControlModifier | Qt::ShiftModifier) &&
+      event->key() == Qt::Key_V) {
+    paste();
+    return;
+  }
+  QByteArray input = keyInput(event, screen_.applicationCursorKeys());
+  if (input.isEmpty()) {
+    QAbstractScrollArea::keyPressEvent(event);
+    return;
   }
+  // a key after the shell exited starts a new one
+  if (!process_->isRunning()) {
+    start();
+    return;
+  }
+  process_->write(input);
+  verticalScrollBar()->setValue(verticalScrollBar()->maximum());
+}
+
+void Terminal::contextMenuEvent(QContextMenuEvent *event) {
+  QMenu menu(this);
+  menu.addAction(tr("&Paste"), this, &Terminal::paste);
+  menu.addAction(follow_tail_);
+  menu.exec(event->globalPos());
 }
 
-void Terminal::command() {
-  process->write(ui->lineEdit->text().toLocal8Bit() + '\n');
-  ui->lineEdit->clear();
+void Terminal::paste() {
+  if (!process_->isRunning()) return;
+  process_->write(QApplication::clipboard()->text().toUtf8());
+  verticalScrollBar()->setValue(verticalScrollBar()->maximum());
 }
+
+void Terminal::scrollContentsBy(int, int dy) {
+  viewport()->scroll(0, dy * line_height_);
+}
+
+bool Terminal::focusNextPrevChild(bool) { return false; }
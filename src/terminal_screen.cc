@@ -0,0 +1,619 @@
+#include "terminal_screen.h"
+
+#include <QString>
+#include <QTextCodec>
+#include <QTextDecoder>
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+const int TAB_WIDTH = 8;
+// more than any sequence worth understanding has
+const std::size_t MAX_PARAMETERS = 32;
+const int MAX_PARAMETER = 65535;
+
+// Nearest color of the 6x6x6 cube of the palette
+quint16 cubeColor(int red, int green, int blue) {
+  auto level = [](int value) {
+    return value < 48 ? 0 : value < 115 ? 1 : qMin(5, (value - 35) / 40);
+  };
+  return static_cast<quint16>(16 + 36 * level(red) + 6 * level(green) +
+                              level(blue));
+}
+
+}  // namespace
+
+TerminalScreen::TerminalScreen(int rows, int columns, int scrollback_capacity)
+    : rows_(qMax(1, rows)),
+      columns_(qMax(1, columns)),
+      scrollback_capacity_(qMax(0, scrollback_capacity)),
+      bottom_(rows_ - 1),
+      decoder_(QTextCodec::codecForName("UTF-8")->makeDecoder()) {
+  main_.assign(rows_, blankLine());
+  alternate_.assign(rows_, blankLine());
+  dirty_.assign(rows_, 0);
+}
+
+TerminalScreen::~TerminalScreen() = default;
+
+void TerminalScreen::resize(int rows, int columns) {
+  rows = qMax(1, rows);
+  columns = qMax(1, columns);
+  if (rows == rows_ && columns == columns_) return;
+
+  if (rows < rows_) {
+    // the empty rows below the cursor go first, then the top rows move to
+    // the scrollback, so the cursor stays on its line
+    int excess = rows_ - rows;
+    int below = alternate_active_ ? excess : qMin(excess, rows_ - 1 - row_);
+    main_.resize(rows_ - below);
+    int above = excess - below;
+    for (int i = 0; i < above; ++i) pushScrollback(&main_[i]);
+    main_.erase(main_.begin(), main_.begin() + above);
+    if (!alternate_active_) row_ -= above;
+  } else {
+    main_.resize(rows, Line(columns, Cell()));
+  }
+  alternate_.resize(rows, Line(columns, Cell()));
+  for (Line &line : main_) line.resize(columns);
+  for (Line &line : alternate_) line.resize(columns);
+
+  rows_ = rows;
+  columns_ = columns;
+  top_ = 0;
+  bottom_ = rows_ - 1;
+  dirty_.assign(rows_, 0);
+  moveCursor(row_, column_);
+  touchAll();
+}
+
+void TerminalScreen::feed(const QByteArray &data) {
+  // a character split between two reads is completed by the decoder
+  QString text = decoder_->toUnicode(data);
+  for (QChar c : text) process(c.unicode());
+}
+
+QByteArray TerminalScreen::takeReplies() {
+  QByteArray replies;
+  replies.swap(replies_);
+  return replies;
+}
+
+TerminalScreen::Damage TerminalScreen::takeDamage() {
+  Damage damage;
+  damage.all = all_dirty_;
+  damage.scrolled = scrolled_;
+  damage.dropped = dropped_;
+  for (int row = 0; row < rows_; ++row) {
+    if (dirty_[row]) damage.rows.push_back(row);
+  }
+  std::fill(dirty_.begin(), dirty_.end(), 0);
+  all_dirty_ = false;
+  scrolled_ = 0;
+  dropped_ = 0;
+  return damage;
+}
+
+int TerminalScreen::lineCount() const { return scrollbackCount() + rows_; }
+
+int TerminalScreen::scrollbackCount() const {
+  return static_cast<int>(scrollback_.size());
+}
+
+const TerminalScreen::Line &TerminalScreen::line(int index) const {
+  int count = scrollbackCount();
+  if (index < count) {
+    return scrollback_[(scrollback_start_ + index) % scrollback_.size()];
+  }
+  return (alternate_active_ ? alternate_ : main_)[index - count];
+}
+
+std::vector<TerminalScreen::Line> &TerminalScreen::screen() {
+  return alternate_active_ ? alternate_ : main_;
+}
+
+TerminalScreen::Line TerminalScreen::blankLine() const {
+  Cell blank;
+  blank.background = pen_.background;
+  return Line(columns_, blank);
+}
+
+void TerminalScreen::clearCells(Line *line, int from, int to) {
+  // erased cells take the current background, as in xterm
+  Cell blank;
+  blank.background = pen_.background;
+  to = qMin(to, static_cast<int>(line->size()));
+  for (int i = qMax(0, from); i < to; ++i) (*line)[i] = blank;
+}
+
+void TerminalScreen::process(char16_t c) {
+  switch (state_) {
+    case State::Ground:
+      if (c >= 0x20 && c != 0x7f) {
+        // characters outside the basic plane are not drawn
+        if (c >= 0xDC00 && c <= 0xDFFF) return;
+        put(c >= 0xD800 && c < 0xDC00 ? 0xFFFD : c);
+        return;
+      }
+      switch (c) {
+        case '\r':
+          column_ = 0;
+          wrap_pending_ = false;
+          break;
+        case '\n':
+        case '\v':
+        case '\f':
+          lineFeed();
+          break;
+        case '\b':
+          if (column_ > 0) --column_;
+          wrap_pending_ = false;
+          break;
+        case '\t':
+          column_ = qMin(columns_ - 1, (column_ / TAB_WIDTH + 1) * TAB_WIDTH);
+          break;
+        case 0x1b:
+          state_ = State::Escape;
+          break;
+        default:
+          break;
+      }
+      return;
+    case State::Escape:
+      switch (c) {
+        case '[':
+          parameters_.clear();
+          marker_ = 0;
+          state_ = State::Csi;
+          return;
+        case ']':
+          state_ = State::Osc;
+          return;
+        case '(':
+        case ')':
+        case '*':
+        case '+':
+          state_ = State::Charset;
+          return;
+        default:
+          state_ = State::Ground;
+          executeEscape(c);
+          return;
+      }
+    case State::Charset:
+      state_ = State::Ground;
+      return;
+    case State::Csi:
+      if (c >= '0' && c <= '9') {
+        if (parameters_.empty()) parameters_.push_back(0);
+        int &value = parameters_.back();
+        value = qMin(MAX_PARAMETER, value * 10 + (c - '0'));
+      } else if (c == ';' || c == ':') {
+        if (parameters_.empty()) parameters_.push_back(0);
+        if (parameters_.size() < MAX_PARAMETERS) parameters_.push_back(0);
+      } else if (c >= 0x20 && c <= 0x3f) {
+        // private markers and intermediates, only ? is understood
+        marker_ = c;
+      } else if (c >= 0x40 && c <= 0x7e) {
+        state_ = State::Ground;
+        executeCsi(c);
+      } else if (c == 0x1b) {
+        state_ = State::Escape;
+      }
+      return;
+    case State::Osc:
+      // titles and the like are not shown
+      if (c == 0x07) {
+        state_ = State::Ground;
+      } else if (c == 0x1b) {
+        state_ = State::OscEscape;
+      }
+      return;
+    case State::OscEscape:
+      // ESC \ ends the string, another sequence aborts it
+      state_ = State::Ground;
+      if (c != '\\') {
+        state_ = State::Escape;
+        process(c);
+      }
+      return;
+  }
+}
+
+void TerminalScreen::put(char16_t c) {
+  if (wrap_pending_) {
+    wrap_pending_ = false;
+    if (autowrap_) {
+      column_ = 0;
+      lineFeed();
+    }
+  }
+  Cell &cell = screen()[row_][column_];
+  cell = pen_;
+  cell.character = c;
+  touch(row_);
+  if (column_ + 1 < columns_) {
+    ++column_;
+  } else {
+    wrap_pending_ = true;
+  }
+}
+
+void TerminalScreen::lineFeed() {
+  wrap_pending_ = false;
+  if (row_ == bottom_) {
+    scrollUp(top_, 1, true);
+  } else if (row_ + 1 < rows_) {
+    ++row_;
+  }
+}
+
+void TerminalScreen::reverseLineFeed() {
+  wrap_pending_ = false;
+  if (row_ == top_) {
+    scrollDown(top_, 1);
+  } else if (row_ > 0) {
+    --row_;
+  }
+}
+
+void TerminalScreen::scrollUp(int top, int count, bool save) {
+  count = qMin(count, bottom_ - top + 1);
+  if (count <= 0) return;
+  std::vector<Line> &lines = screen();
+  std::rotate(lines.begin() + top, lines.begin() + top + count,
+              lines.begin() + bottom_ + 1);
+  // only a scroll of the whole main screen feeds the scrollback, the
+  // scrollback then grows by as many lines as the screen moved
+  save = save && !alternate_active_ && top == 0 && bottom_ == rows_ - 1;
+  for (int i = bottom_ - count + 1; i <= bottom_; ++i) {
+    if (save) pushScrollback(&lines[i]);
+    lines[i].resize(columns_);
+    clearCells(&lines[i], 0, columns_);
+  }
+  if (save) {
+    scrolled_ += count;
+    std::rotate(dirty_.begin(), dirty_.begin() + count, dirty_.end());
+    std::fill(dirty_.end() - count, dirty_.end(), 1);
+  } else {
+    for (int i = top; i <= bottom_; ++i) touch(i);
+  }
+}
+
+void TerminalScreen::scrollDown(int top, int count) {
+  count = qMin(count, bottom_ - top + 1);
+  if (count <= 0) return;
+  std::vector<Line> &lines = screen();
+  std::rotate(lines.begin() + top, lines.begin() + bottom_ + 1 - count,
+              lines.begin() + bottom_ + 1);
+  for (int i = top; i < top + count; ++i) clearCells(&lines[i], 0, columns_);
+  for (int i = top; i <= bottom_; ++i) touch(i);
+}
+
+void TerminalScreen::pushScrollback(Line *line) {
+  if (scrollback_capacity_ == 0) {
+    ++dropped_;
+  } else if (scrollback_.size() < scrollback_capacity_) {
+    scrollback_.push_back(std::move(*line));
+    *line = Line();
+  } else {
+    // the oldest line leaves and its storage is reused by the caller
+    std::swap(scrollback_[scrollback_start_], *line);
+    scrollback_start_ = (scrollback_start_ + 1) % scrollback_capacity_;
+    ++dropped_;
+  }
+}
+
+void TerminalScreen::executeEscape(char16_t c) {
+  switch (c) {
+    case '7':
+      saved_row_ = row_;
+      saved_column_ = column_;
+      saved_pen_ = pen_;
+      break;
+    case '8':
+      moveCursor(saved_row_, saved_column_);
+      pen_ = saved_pen_;
+      break;
+    case 'D':
+      lineFeed();
+      break;
+    case 'E':
+      column_ = 0;
+      lineFeed();
+      break;
+    case 'M':
+      reverseLineFeed();
+      break;
+    case 'c':
+      reset();
+      break;
+    default:
+      break;
+  }
+}
+
+void TerminalScreen::executeCsi(char16_t final) {
+  if (marker_ == '?') {
+    if (final == 'h' || final == 'l') {
+      for (int mode : parameters_) setMode(mode, final == 'h');
+    }
+    return;
+  }
+  if (marker_ != 0) return;
+
+  int count = parameter(0, 1);
+  Line &line = screen()[row_];
+  Cell blank;
+  blank.background = pen_.background;
+  switch (final) {
+    case 'A':
+      moveCursor(row_ - count, column_);
+      break;
+    case 'B':
+    case 'e':
+      moveCursor(row_ + count, column_);
+      break;
+    case 'C':
+    case 'a':
+      moveCursor(row_, column_ + count);
+      break;
+    case 'D':
+      moveCursor(row_, qMin(column_, columns_ - 1) - count);
+      break;
+    case 'E':
+      moveCursor(row_ + count, 0);
+      break;
+    case 'F':
+      moveCursor(row_ - count, 0);
+      break;
+    case 'G':
+    case '`':
+      moveCursor(row_, count - 1);
+      break;
+    case 'H':
+    case 'f':
+      moveCursor(parameter(0, 1) - 1, parameter(1, 1) - 1);
+      break;
+    case 'd':
+      moveCursor(count - 1, column_);
+      break;
+    case 'J':
+      eraseDisplay(parameter(0, 0));
+      break;
+    case 'K':
+      eraseLine(parameter(0, 0));
+      break;
+    case 'L':
+      if (row_ >= top_ && row_ <= bottom_) {
+        scrollDown(row_, count);
+        moveCursor(row_, 0);
+      }
+      break;
+    case 'M':
+      if (row_ >= top_ && row_ <= bottom_) {
+        scrollUp(row_, count, false);
+        moveCursor(row_, 0);
+      }
+      break;
+    case 'P':
+      count = qMin(count, columns_ - column_);
+      line.erase(line.begin() + column_, line.begin() + column_ + count);
+      line.insert(line.end(), count, blank);
+      touch(row_);
+      break;
+    case '@':
+      count = qMin(count, columns_ - column_);
+      line.insert(line.begin() + column_, count, blank);
+      line.resize(columns_);
+      touch(row_);
+      break;
+    case 'X':
+      clearCells(&line, column_, column_ + count);
+      touch(row_);
+      break;
+    case 'S':
+      scrollUp(top_, count, false);
+      break;
+    case 'T':
+      scrollDown(top_, count);
+      break;
+    case 'm':
+      selectGraphicRendition();
+      break;
+    case 'r': {
+      int top = parameter(0, 1) - 1;
+      int bottom = parameter(1, rows_) - 1;
+      if (top < bottom && bottom < rows_) {
+        top_ = top;
+        bottom_ = bottom;
+      }
+      moveCursor(0, 0);
+      break;
+    }
+    case 's':
+      saved_row_ = row_;
+      saved_column_ = column_;
+      break;
+    case 'u':
+      moveCursor(saved_row_, saved_column_);
+      break;
+    case 'n':
+      if (parameter(0, 0) == 6) {
+        replies_ += QString("\x1b[%1;%2R")
+                        .arg(row_ + 1)
+                        .arg(cursorColumn() + 1)
+                        .toLatin1();
+      } else if (parameter(0, 0) == 5) {
+        replies_ += "\x1b[0n";
+      }
+      break;
+    case 'c':
+      replies_ += "\x1b[?1;2c";
+      break;
+    default:
+      break;
+  }
+}
+
+void TerminalScreen::setMode(int mode, bool enable) {
+  switch (mode) {
+    case 1:
+      application_cursor_keys_ = enable;
+      break;
+    case 7:
+      autowrap_ = enable;
+      break;
+    case 25:
+      cursor_visible_ = enable;
+      touch(row_);
+      break;
+    case 47:
+    case 1047:
+    case 1049:
+      if (enable == alternate_active_) break;
+      if (enable && mode == 1049) {
+        saved_row_ = row_;
+        saved_column_ = column_;
+        saved_pen_ = pen_;
+      }
+      alternate_active_ = enable;
+      if (enable) {
+        for (Line &line : alternate_) clearCells(&line, 0, columns_);
+      } else if (mode == 1049) {
+        moveCursor(saved_row_, saved_column_);
+        pen_ = saved_pen_;
+      }
+      touchAll();
+      break;
+    default:
+      break;
+  }
+}
+
+void TerminalScreen::selectGraphicRendition() {
+  if (parameters_.empty()) {
+    pen_ = Cell();
+    return;
+  }
+  for (std::size_t i = 0; i < parameters_.size(); ++i) {
+    int value = parameters_[i];
+    if (value == 0) {
+      pen_ = Cell();
+    } else if (value == 1) {
+      pen_.attributes |= BOLD;
+    } else if (value == 4) {
+      pen_.attributes |= UNDERLINE;
+    } else if (value == 7) {
+      pen_.attributes |= INVERSE;
+    } else if (value == 22) {
+      pen_.attributes &= ~BOLD;
+    } else if (value == 24) {
+      pen_.attributes &= ~UNDERLINE;
+    } else if (value == 27) {
+      pen_.attributes &= ~INVERSE;
+    } else if (value >= 30 && value <= 37) {
+      pen_.foreground = value - 30;
+    } else if (value == 39) {
+      pen_.foreground = DEFAULT_COLOR;
+    } else if (value >= 40 && value <= 47) {
+      pen_.background = value - 40;
+    } else if (value == 49) {
+      pen_.background = DEFAULT_COLOR;
+    } else if (value >= 90 && value <= 97) {
+      pen_.foreground = value - 90 + 8;
+    } else if (value >= 100 && value <= 107) {
+      pen_.background = value - 100 + 8;
+    } else if (value == 38 || value == 48) {
+      quint16 color;
+      if (i + 2 < parameters_.size() && parameters_[i + 1] == 5) {
+        color = static_cast<quint16>(qMin(parameters_[i + 2], 255));
+        i += 2;
+      } else if (i + 4 < parameters_.size() && parameters_[i + 1] == 2) {
+        color = cubeColor(parameters_[i + 2], parameters_[i + 3],
+                          parameters_[i + 4]);
+        i += 4;
+      } else {
+        return;
+      }
+      (value == 38 ? pen_.foreground : pen_.background) = color;
+    }
+  }
+}
+
+void TerminalScreen::eraseDisplay(int mode) {
+  std::vector<Line> &lines = screen();
+  switch (mode) {
+    case 0:
+      eraseLine(0);
+      for (int i = row_ + 1; i < rows_; ++i) {
+        clearCells(&lines[i], 0, columns_);
+        touch(i);
+      }
+      break;
+    case 1:
+      eraseLine(1);
+      for (int i = 0; i < row_; ++i) {
+        clearCells(&lines[i], 0, columns_);
+        touch(i);
+      }
+      break;
+    case 2:
+      for (int i = 0; i < rows_; ++i) {
+        clearCells(&lines[i], 0, columns_);
+        touch(i);
+      }
+      break;
+    case 3:
+      scrollback_.clear();
+      scrollback_start_ = 0;
+      touchAll();
+      break;
+    default:
+      break;
+  }
+}
+
+void TerminalScreen::eraseLine(int mode) {
+  Line &line = screen()[row_];
+  if (mode == 0) {
+    clearCells(&line, column_, columns_);
+  } else if (mode == 1) {
+    clearCells(&line, 0, column_ + 1);
+  } else if (mode == 2) {
+    clearCells(&line, 0, columns_);
+  }
+  touch(row_);
+}
+
+void TerminalScreen::moveCursor(int row, int column) {
+  row_ = qBound(0, row, rows_ - 1);
+  column_ = qBound(0, column, columns_ - 1);
+  wrap_pending_ = false;
+}
+
+int TerminalScreen::parameter(std::size_t index, int fallback) const {
+  if (index >= parameters_.size() || parameters_[index] == 0) return fallback;
+  return parameters_[index];
+}
+
+void TerminalScreen::touch(int row) { dirty_[row] = 1; }
+
+void TerminalScreen::touchAll() { all_dirty_ = true; }
+
+void TerminalScreen::reset() {
+  pen_ = Cell();
+  saved_pen_ = Cell();
+  saved_row_ = 0;
+  saved_column_ = 0;
+  top_ = 0;
+  bottom_ = rows_ - 1;
+  autowrap_ = true;
+  cursor_visible_ = true;
+  application_cursor_keys_ = false;
+  alternate_active_ = false;
+  for (Line &line : main_) clearCells(&line, 0, columns_);
+  moveCursor(0, 0);
+  touchAll();
+}
@@ -0,0 +1,165 @@
+#include "text_diff.h"
+
+#include <QCryptographicHash>
+#include <QHash>
+#include <QStringRef>
+#include <QVector>
+
+namespace text_diff {
+
+namespace {
+
+// Lines [old_begin, old_end) of the old text are replaced by lines
+// [new_begin, new_end) of the new one
+struct LineHunk {
+  int old_begin;
+  int old_end;
+  int new_begin;
+  int new_end;
+};
+
+std::vector<LineHunk> diffLines(const std::vector<int> &a,
+                                const std::vector<int> &b, int max_cost) {
+  const int n = static_cast<int>(a.size());
+  const int m = static_cast<int>(b.size());
+  // edits usually touch a small part of the file, the common ends cost
+  // nothing to skip
+  int prefix = 0;
+  while (prefix < n && prefix < m && a[prefix] == b[prefix]) ++prefix;
+  int suffix = 0;
+  while (suffix < n - prefix && suffix < m - prefix &&
+         a[n - 1 - suffix] == b[m - 1 - suffix]) {
+    ++suffix;
+  }
+  const int old_size = n - prefix - suffix;
+  const int new_size = m - prefix - suffix;
+  if (old_size == 0 && new_size == 0) return {};
+  const LineHunk whole = {prefix, n - suffix, prefix, m - suffix};
+  if (old_size == 0 || new_size == 0) return {whole};
+
+  // v[k] is the furthest old line reached on diagonal k, trace[d] keeps the
+  // diagonals -d..d after d edits for walking the path back
+  const int offset = old_size + new_size + 1;
+  std::vector<int> v(2 * offset + 1, 0);
+  std::vector<std::vector<int>> trace;
+  int cost = -1;
+  for (int d = 0; d <= max_cost && cost < 0; ++d) {
+    for (int k = -d; k <= d; k += 2) {
+      int x = (k == -d || (k != d && v[offset + k - 1] < v[offset + k + 1]))
+                  ? v[offset + k + 1]
+                  : v[offset + k - 1] + 1;
+      int y = x - k;
+      while (x < old_size && y < new_size &&
+             a[prefix + x] == b[prefix + y]) {
+        ++x;
+        ++y;
+      }
+      v[offset + k] = x;
+      if (x >= old_size && y >= new_size) {
+        cost = d;
+        break;
+      }
+    }
+    if (cost < 0) {
+      trace.emplace_back(v.begin() + offset - d, v.begin() + offset + d + 1);
+    }
+  }
+  if (cost < 0) return {whole};
+
+  // the path is walked from its end, every step is one inserted or deleted
+  // line starting at (x, y)
+  struct Step {
+    int x;
+    int y;
+    bool insertion;
+  };
+  std::vector<Step> steps;
+  int x = old_size;
+  int y = new_size;
+  for (int d = cost; d > 0; --d) {
+    const std::vector<int> &previous = trace[d - 1];
+    auto furthest = [&](int k) { return previous[k + d - 1]; };
+    int k = x - y;
+    bool insertion =
+        k == -d || (k != d && furthest(k - 1) < furthest(k + 1));
+    int previous_k = insertion ? k + 1 : k - 1;
+    x = furthest(previous_k);
+    y = x - previous_k;
+    steps.push_back({x, y, insertion});
+  }
+
+  std::vector<LineHunk> hunks;
+  for (auto it = steps.rbegin(); it != steps.rend(); ++it) {
+    int old_line = prefix + it->x;
+    int new_line = prefix + it->y;
+    if (hunks.empty() || hunks.back().old_end != old_line ||
+        hunks.back().new_end != new_line) {
+      hunks.push_back({old_line, old_line, new_line, new_line});
+    }
+    if (it->insertion) {
+      ++hunks.back().new_end;
+    } else {
+      ++hunks.back().old_end;
+    }
+  }
+  return hunks;
+}
+
+// Splits the text into lines numbered by content, starts gets the position
+// of every line and one past the end of the text
+void splitLines(const QString &text, QHash<QStringRef, int> *ids,
+                std::vector<int> *lines, std::vector<int> *starts) {
+  for (const QStringRef &line : text.splitRef('\n')) {
+    starts->push_back(line.position());
+    int id = ids->value(line, -1);
+    if (id < 0) {
+      id = ids->size();
+      ids->insert(line, id);
+    }
+    lines->push_back(id);
+  }
+  starts->push_back(text.size() + 1);
+}
+
+}  // namespace
+
+std::vector<Edit> Diff(const QString &before, const QString &after,
+                       int max_cost) {
+  QHash<QStringRef, int> ids;
+  std::vector<int> old_lines;
+  std::vector<int> new_lines;
+  std::vector<int> old_starts;
+  std::vector<int> new_starts;
+  splitLines(before, &ids, &old_lines, &old_starts);
+  splitLines(after, &ids, &new_lines, &new_starts);
+
+  std::vector<Edit> edits;
+  for (const LineHunk &hunk : diffLines(old_lines, new_lines, max_cost)) {
+    // a line range covers the line breaks after its lines, at the end of the
+    // text there is none, so the hunk takes the break before it instead
+    int old_begin = old_starts[hunk.old_begin];
+    int old_end = old_starts[hunk.old_end];
+    int new_begin = new_starts[hunk.new_begin];
+    int new_end = new_starts[hunk.new_end];
+    if (old_end == before.size() + 1) {
+      if (old_begin > 0) {
+        --old_begin;
+        --new_begin;
+      }
+      --old_end;
+      --new_end;
+    }
+    edits.push_back({old_begin, old_end - old_begin,
+                     after.mid(new_begin, new_end - new_begin)});
+  }
+  return edits;
+}
+
+QByteArray Digest(const QString &text) {
+  return QCryptographicHash::hash(
+      QByteArray::fromRawData(reinterpret_cast<const char *>(text.utf16()),
+                              text.size() * 2),
+      QCryptographicHash::Md5);
+}
+
+}  // namespace text_diff
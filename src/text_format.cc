@@ -0,0 +1,266 @@
+#include "text_format.h"
+
+#include <QtEndian>
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#include <immintrin.h>
+#define TEXT_FORMAT_SIMD 1
+#endif
+
+namespace text_format {
+
+namespace {
+
+const char UTF8_BOM[] = "\xEF\xBB\xBF";
+const int UTF8_BOM_SIZE = 3;
+const int UTF16_BOM_SIZE = 2;
+
+// Length of the valid UTF-8 sequence at it, 0 when it is not one
+int sequenceLength(const unsigned char *it, const unsigned char *end) {
+  const unsigned char lead = *it;
+  int length;
+  if (lead < 0x80) {
+    return 1;
+  } else if (lead >= 0xC2 && lead <= 0xDF) {
+    length = 2;
+  } else if (lead >= 0xE0 && lead <= 0xEF) {
+    length = 3;
+  } else if (lead >= 0xF0 && lead <= 0xF4) {
+    length = 4;
+  } else {
+    return 0;
+  }
+  if (end - it < length) return 0;
+  for (int i = 1; i < length; ++i) {
+    if ((it[i] & 0xC0) != 0x80) return 0;
+  }
+  // overlong forms, surrogates and code points past U+10FFFF
+  if ((lead == 0xE0 && it[1] < 0xA0) || (lead == 0xED && it[1] > 0x9F) ||
+      (lead == 0xF0 && it[1] < 0x90) || (lead == 0xF4 && it[1] > 0x8F)) {
+    return 0;
+  }
+  return length;
+}
+
+struct Scan {
+  bool utf8 = true;
+  qint64 line_feeds = 0;
+  // line feeds preceded by a carriage return
+  qint64 crlf = 0;
+};
+
+// One pass over the bytes: UTF-8 validity and line endings. Runs of ASCII,
+// which is most of a source file, are taken 16 bytes at a time.
+Scan scanBytes(const unsigned char *begin, const unsigned char *end) {
+  Scan scan;
+  const unsigned char *it = begin;
+  while (it < end) {
+#ifdef TEXT_FORMAT_SIMD
+    if (it > begin) {
+      const __m128i line_feed = _mm_set1_epi8('\n');
+      const __m128i carriage_return = _mm_set1_epi8('\r');
+      while (end - it >= 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(it));
+        if (_mm_movemask_epi8(block) != 0) break;
+        __m128i previous =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(it - 1));
+        __m128i feeds = _mm_cmpeq_epi8(block, line_feed);
+        __m128i pairs =
+            _mm_and_si128(feeds, _mm_cmpeq_epi8(previous, carriage_return));
+        scan.line_feeds += __builtin_popcount(_mm_movemask_epi8(feeds));
+        scan.crlf += __builtin_popcount(_mm_movemask_epi8(pairs));
+        it += 16;
+      }
+      if (it == end) break;
+    }
+#endif
+    if (*it == '\n') {
+      ++scan.line_feeds;
+      if (it > begin && it[-1] == '\r') ++scan.crlf;
+    }
+    int length = sequenceLength(it, end);
+    if (length == 0) {
+      scan.utf8 = false;
+      length = 1;
+    }
+    it += length;
+  }
+  return scan;
+}
+
+bool hasUtf16Bom(const QByteArray &data, Encoding encoding) {
+  if (data.size() < UTF16_BOM_SIZE) return false;
+  const unsigned char first = static_cast<unsigned char>(data[0]);
+  const unsigned char second = static_cast<unsigned char>(data[1]);
+  return encoding == Encoding::Utf16LE ? first == 0xFF && second == 0xFE
+                                       : first == 0xFE && second == 0xFF;
+}
+
+QString decodeUtf16(const QByteArray &data, Encoding encoding) {
+  const int skip = hasUtf16Bom(data, encoding) ? UTF16_BOM_SIZE : 0;
+  const int units = (data.size() - skip) / 2;
+  // a truncated last unit is shown, and saved, as a replacement character
+  const bool odd = (data.size() - skip) % 2 != 0;
+  const unsigned char *source =
+      reinterpret_cast<const unsigned char *>(data.constData()) + skip;
+  QString text(units + (odd ? 1 : 0), Qt::Uninitialized);
+  QChar *target = text.data();
+  for (int i = 0; i < units; ++i) {
+    target[i] = QChar(encoding == Encoding::Utf16LE
+                          ? qFromLittleEndian<quint16>(source + 2 * i)
+                          : qFromBigEndian<quint16>(source + 2 * i));
+  }
+  if (odd) target[units] = QChar::ReplacementCharacter;
+  return text;
+}
+
+QByteArray encodeUtf16(const QString &text, Encoding encoding) {
+  QByteArray data(UTF16_BOM_SIZE + 2 * text.size(), Qt::Uninitialized);
+  unsigned char *target = reinterpret_cast<unsigned char *>(data.data());
+  auto put = [encoding](quint16 unit, unsigned char *at) {
+    if (encoding == Encoding::Utf16LE) {
+      qToLittleEndian<quint16>(unit, at);
+    } else {
+      qToBigEndian<quint16>(unit, at);
+    }
+  };
+  put(0xFEFF, target);
+  const ushort *source = text.utf16();
+  for (int i = 0; i < text.size(); ++i) {
+    put(source[i], target + UTF16_BOM_SIZE + 2 * i);
+  }
+  return data;
+}
+
+// QTextDocument breaks lines at a '\r' too, a carriage return that is not
+// part of a CRLF pair is kept as it is
+void removeCarriageReturns(QString *text) {
+  int from = text->indexOf(QLatin1String("\r\n"));
+  if (from < 0) return;
+  const int size = text->size();
+  QChar *data = text->data();
+  int out = from;
+  for (int i = from; i < size; ++i) {
+    if (data[i] == '\r' && i + 1 < size && data[i + 1] == '\n') continue;
+    data[out++] = data[i];
+  }
+  text->truncate(out);
+}
+
+bool isLatin1(const QString &text) {
+  for (QChar ch : text) {
+    if (ch.unicode() > 0xFF) return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+Format Detect(const QByteArray &data) {
+  Format format;
+  if (data.startsWith(UTF8_BOM)) {
+    format.encoding = Encoding::Utf8WithBom;
+  } else if (hasUtf16Bom(data, Encoding::Utf16LE)) {
+    format.encoding = Encoding::Utf16LE;
+  } else if (hasUtf16Bom(data, Encoding::Utf16BE)) {
+    format.encoding = Encoding::Utf16BE;
+  }
+
+  qint64 line_feeds = 0;
+  qint64 crlf = 0;
+  if (format.encoding == Encoding::Utf16LE ||
+      format.encoding == Encoding::Utf16BE) {
+    QString text = decodeUtf16(data, format.encoding);
+    for (int i = 0; i < text.size(); ++i) {
+      if (text[i] != '\n') continue;
+      ++line_feeds;
+      if (i > 0 && text[i - 1] == '\r') ++crlf;
+    }
+  } else {
+    const unsigned char *begin =
+        reinterpret_cast<const unsigned char *>(data.constData());
+    Scan scan = scanBytes(begin, begin + data.size());
+    if (!scan.utf8) format.encoding = Encoding::Latin1;
+    line_feeds = scan.line_feeds;
+    crlf = scan.crlf;
+  }
+  format.crlf = crlf > line_feeds - crlf;
+  return format;
+}
+
+QString Decode(const QByteArray &data, const Format &format) {
+  QString text;
+  switch (format.encoding) {
+    case Encoding::Utf8:
+      text = QString::fromUtf8(data);
+      break;
+    case Encoding::Utf8WithBom:
+      if (data.startsWith(UTF8_BOM)) {
+        text = QString::fromUtf8(data.constData() + UTF8_BOM_SIZE,
+                                 data.size() - UTF8_BOM_SIZE);
+      } else {
+        text = QString::fromUtf8(data);
+      }
+      break;
+    case Encoding::Utf16LE:
+    case Encoding::Utf16BE:
+      text = decodeUtf16(data, format.encoding);
+      break;
+    case Encoding::Latin1:
+      text = QString::fromLatin1(data);
+      break;
+  }
+  removeCarriageReturns(&text);
+  return text;
+}
+
+Format EncodedAs(const QString &text, const Format &format) {
+  Format result = format;
+  // characters typed into a Latin-1 file that it cannot hold would be lost,
+  // the file becomes UTF-8 then
+  if (format.encoding == Encoding::Latin1 && !isLatin1(text)) {
+    result.encoding = Encoding::Utf8;
+  }
+  return result;
+}
+
+QByteArray Encode(const QString &text, const Format &format) {
+  QString source = text;
+  if (format.crlf) source.replace('\n', QLatin1String("\r\n"));
+  switch (EncodedAs(text, format).encoding) {
+    case Encoding::Utf8:
+      return source.toUtf8();
+    case Encoding::Utf8WithBom:
+      return UTF8_BOM + source.toUtf8();
+    case Encoding::Utf16LE:
+    case Encoding::Utf16BE:
+      return encodeUtf16(source, format.encoding);
+    case Encoding::Latin1:
+      return source.toLatin1();
+  }
+  return source.toUtf8();
+}
+
+QString Describe(const Format &format) {
+  QString name;
+  switch (format.encoding) {
+    case Encoding::Utf8:
+      name = "UTF-8";
+      break;
+    case Encoding::Utf8WithBom:
+      name = "UTF-8 BOM";
+      break;
+    case Encoding::Utf16LE:
+      name = "UTF-16 LE";
+      break;
+    case Encoding::Utf16BE:
+      name = "UTF-16 BE";
+      break;
+    case Encoding::Latin1:
+      name = "ISO-8859-1";
+      break;
+  }
+  return name + (format.crlf ? " CRLF" : " LF");
+}
+
+}  // namespace text_format
@@ -0,0 +1,273 @@
+#include "text_search.h"
+
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#include <immintrin.h>
+#define TEXT_SEARCH_SIMD 1
+#endif
+
+namespace {
+
+// Only ASCII letters are folded: a byte of a multi-byte UTF-8 sequence or a
+// non-ASCII UTF-16 unit never compares equal to a different one
+template <typename Char>
+Char foldCase(Char ch) {
+  return ch >= 'A' && ch <= 'Z' ? static_cast<Char>(ch + ('a' - 'A')) : ch;
+}
+
+template <typename Char>
+Char otherCase(Char ch) {
+  if (ch >= 'A' && ch <= 'Z') return static_cast<Char>(ch + ('a' - 'A'));
+  if (ch >= 'a' && ch <= 'z') return static_cast<Char>(ch - ('a' - 'A'));
+  return ch;
+}
+
+template <typename Char>
+bool equalAt(const Char *text, const Char *needle, std::size_t size,
+             bool case_sensitive) {
+  if (case_sensitive) {
+    return std::memcmp(text, needle, size * sizeof(Char)) == 0;
+  }
+  for (std::size_t i = 0; i < size; ++i) {
+    if (foldCase(text[i]) != foldCase(needle[i])) return false;
+  }
+  return true;
+}
+
+// Scalar fallback and the tail of the vectorized loops
+template <typename Char>
+const Char *findScalar(const Char *begin, const Char *end, const Char *needle,
+                       std::size_t size, bool case_sensitive) {
+  const Char first = needle[0];
+  const Char first_alt = case_sensitive ? first : otherCase(first);
+  for (const Char *it = begin; it + size <= end; ++it) {
+    if ((*it == first || *it == first_alt) &&
+        equalAt(it, needle, size, case_sensitive)) {
+      return it;
+    }
+  }
+  return nullptr;
+}
+
+#ifdef TEXT_SEARCH_SIMD
+
+// Both vectorized versions compare a block of candidate positions against
+// the first and the last character of the needle at once, only positions
+// where both agree are compared in full. Every lane of a Char sets
+// sizeof(Char) bits of the mask.
+template <typename Char>
+const Char *findSse2(const Char *begin, const Char *end, const Char *needle,
+                     std::size_t size, bool case_sensitive) {
+  constexpr std::size_t LANES = sizeof(__m128i) / sizeof(Char);
+  constexpr unsigned LANE_BITS = (1u << sizeof(Char)) - 1;
+  const Char first = needle[0];
+  const Char last = needle[size - 1];
+  const Char first_alt = case_sensitive ? first : otherCase(first);
+  const Char last_alt = case_sensitive ? last : otherCase(last);
+
+  __m128i f, fa, l, la;
+  if constexpr (sizeof(Char) == 1) {
+    f = _mm_set1_epi8(static_cast<char>(first));
+    fa = _mm_set1_epi8(static_cast<char>(first_alt));
+    l = _mm_set1_epi8(static_cast<char>(last));
+    la = _mm_set1_epi8(static_cast<char>(last_alt));
+  } else {
+    f = _mm_set1_epi16(static_cast<short>(first));
+    fa = _mm_set1_epi16(static_cast<short>(first_alt));
+    l = _mm_set1_epi16(static_cast<short>(last));
+    la = _mm_set1_epi16(static_cast<short>(last_alt));
+  }
+
+  const Char *it = begin;
+  for (; it + LANES + size - 1 <= end; it += LANES) {
+    __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i *>(it));
+    __m128i tail =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(it + size - 1));
+    __m128i hits;
+    if constexpr (sizeof(Char) == 1) {
+      hits = _mm_and_si128(
+          _mm_or_si128(_mm_cmpeq_epi8(head, f), _mm_cmpeq_epi8(head, fa)),
+          _mm_or_si128(_mm_cmpeq_epi8(tail, l), _mm_cmpeq_epi8(tail, la)));
+    } else {
+      hits = _mm_and_si128(
+          _mm_or_si128(_mm_cmpeq_epi16(head, f), _mm_cmpeq_epi16(head, fa)),
+          _mm_or_si128(_mm_cmpeq_epi16(tail, l), _mm_cmpeq_epi16(tail, la)));
+    }
+    unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hits));
+    while (mask != 0) {
+      int bit = __builtin_ctz(mask);
+      const Char *candidate = it + bit / sizeof(Char);
+      if (equalAt(candidate, needle, size, case_sensitive)) return candidate;
+      mask &= ~(LANE_BITS << bit);
+    }
+  }
+  return findScalar(it, end, needle, size, case_sensitive);
+}
+
+template <typename Char>
+__attribute__((target("avx2"))) const Char *findAvx2(
+    const Char *begin, const Char *end, const Char *needle, std::size_t size,
+    bool case_sensitive) {
+  constexpr std::size_t LANES = sizeof(__m256i) / sizeof(Char);
+  constexpr unsigned LANE_BITS = (1u << sizeof(Char)) - 1;
+  const Char first = needle[0];
+  const Char last = needle[size - 1];
+  const Char first_alt = case_sensitive ? first : otherCase(first);
+  const Char last_alt = case_sensitive ? last : otherCase(last);
+
+  __m256i f, fa, l, la;
+  if constexpr (sizeof(Char) == 1) {
+    f = _mm256_set1_epi8(static_cast<char>(first));
+    fa = _mm256_set1_epi8(static_cast<char>(first_alt));
+    l = _mm256_set1_epi8(static_cast<char>(last));
+    la = _mm256_set1_epi8(static_cast<char>(last_alt));
+  } else {
+    f = _mm256_set1_epi16(static_cast<short>(first));
+    fa = _mm256_set1_epi16(static_cast<short>(first_alt));
+    l = _mm256_set1_epi16(static_cast<short>(last));
+    la = _mm256_set1_epi16(static_cast<short>(last_alt));
+  }
+
+  const Char *it = begin;
+  for (; it + LANES + size - 1 <= end; it += LANES) {
+    __m256i head = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(it));
+    __m256i tail =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(it + size - 1));
+    __m256i hits;
+    if constexpr (sizeof(Char) == 1) {
+      hits = _mm256_and_si256(
+          _mm256_or_si256(_mm256_cmpeq_epi8(head, f),
+                          _mm256_cmpeq_epi8(head, fa)),
+          _mm256_or_si256(_mm256_cmpeq_epi8(tail, l),
+                          _mm256_cmpeq_epi8(tail, la)));
+    } else {
+      hits = _mm256_and_si256(
+          _mm256_or_si256(_mm256_cmpeq_epi16(head, f),
+                          _mm256_cmpeq_epi16(head, fa)),
+          _mm256_or_si256(_mm256_cmpeq_epi16(tail, l),
+                          _mm256_cmpeq_epi16(tail, la)));
+    }
+    unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hits));
+    while (mask != 0) {
+      int bit = __builtin_ctz(mask);
+      const Char *candidate = it + bit / sizeof(Char);
+      if (equalAt(candidate, needle, size, case_sensitive)) return candidate;
+      mask &= ~(LANE_BITS << bit);
+    }
+  }
+  return findScalar(it, end, needle, size, case_sensitive);
+}
+
+bool hasAvx2() {
+  static const bool result = __builtin_cpu_supports("avx2");
+  return result;
+}
+
+#endif  // TEXT_SEARCH_SIMD
+
+template <typename Char>
+const Char *find(const Char *begin, const Char *end, const Char *needle,
+                 std::size_t size, bool case_sensitive) {
+  if (size == 0) return begin;
+  if (end - begin < static_cast<std::ptrdiff_t>(size)) return nullptr;
+#ifdef TEXT_SEARCH_SIMD
+  if (hasAvx2()) return findAvx2(begin, end, needle, size, case_sensitive);
+  return findSse2(begin, end, needle, size, case_sensitive);
+#else
+  return findScalar(begin, end, needle, size, case_sensitive);
+#endif
+}
+
+}  // namespace
+
+namespace text_search {
+
+const char *FindLiteral(const char *begin, const char *end,
+                        const std::string &needle, bool case_sensitive) {
+  return find(begin, end, needle.data(), needle.size(), case_sensitive);
+}
+
+const ushort *FindText(const ushort *begin, const ushort *end,
+                       const ushort *needle, int size, bool case_sensitive) {
+  return find(begin, end, needle, static_cast<std::size_t>(size),
+              case_sensitive);
+}
+
+QString RequiredLiteral(const QString &pattern) {
+  QString best;
+  QString current;
+  auto flush = [&]() {
+    if (current.size() > best.size()) best = current;
+    current.clear();
+  };
+  // the previous atom turned out to be optional
+  auto drop_last = [&]() {
+    if (!current.isEmpty()) current.chop(1);
+    flush();
+  };
+
+  // literals inside groups are not collected: the group may be optional
+  // or repeated as a whole
+  int depth = 0;
+  for (int i = 0; i < pattern.size(); ++i) {
+    QChar ch = pattern[i];
+    switch (ch.unicode()) {
+      case '|':  // any alternative may match, nothing is required
+        return {};
+      case '\\': {
+        if (i + 1 == pattern.size()) return {};
+        QChar escaped = pattern[++i];
+        if (escaped.isLetterOrNumber() || depth > 0) {
+          flush();  // a class like \w or a back reference
+        } else {
+          current += escaped;
+        }
+        break;
+      }
+      case '[':
+        flush();
+        // ']' right after '[' or '[^' belongs to the set
+        if (i + 1 < pattern.size() && pattern[i + 1] == '^') ++i;
+        if (i + 1 < pattern.size() && pattern[i + 1] == ']') ++i;
+        while (++i < pattern.size() && pattern[i] != ']') {
+          if (pattern[i] == '\\') ++i;
+        }
+        break;
+      case '(':
+        if (i + 1 < pattern.size() && pattern[i + 1] == '?') {
+          return {};  // inline options or lookarounds
+        }
+        flush();
+        ++depth;
+        break;
+      case '*':
+      case '?':
+        drop_last();
+        break;
+      case '{':
+        drop_last();
+        while (i < pattern.size() && pattern[i] != '}') ++i;
+        break;
+      case '+':
+        flush();
+        break;
+      case ')':
+        flush();
+        --depth;
+        break;
+      case '.':
+      case '^':
+      case '$':
+        flush();
+        break;
+      default:
+        if (depth > 0) break;
+        current += ch;
+    }
+  }
+  flush();
+  return best;
+}
+
+}  // namespace text_search
@@ -0,0 +1,204 @@
+#include "workspace_files.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QTextStream>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct IgnorePattern {
+  QRegularExpression regex;
+  bool negated = false;
+  bool directory_only = false;
+  bool anchored = false;  // matched against the path, not the file name
+};
+
+// Patterns of one .gitignore, the parent holds the ones of the directories
+// above. Supported: comments, negation, trailing slash for directories,
+// anchoring by a slash and the wildcards understood by
+// QRegularExpression::wildcardToRegularExpression.
+struct IgnoreRules {
+  QString base;
+  std::vector<IgnorePattern> patterns;
+  std::shared_ptr<const IgnoreRules> parent;
+};
+
+std::shared_ptr<const IgnoreRules> loadRules(
+    const QDir &dir, std::shared_ptr<const IgnoreRules> parent) {
+  QFile file(dir.filePath(".gitignore"));
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return parent;
+
+  auto rules = std::make_shared<IgnoreRules>();
+  rules->base = dir.path();
+  rules->parent = std::move(parent);
+  QTextStream in(&file);
+  while (!in.atEnd()) {
+    QString line = in.readLine().trimmed();
+    if (line.isEmpty() || line.startsWith('#')) continue;
+
+    IgnorePattern pattern;
+    if (line.startsWith('!')) {
+      pattern.negated = true;
+      line.remove(0, 1);
+    }
+    if (line.endsWith('/')) {
+      pattern.directory_only = true;
+      line.chop(1);
+    }
+    pattern.anchored = line.contains('/');
+    if (line.startsWith('/')) line.remove(0, 1);
+    if (line.isEmpty()) continue;
+    pattern.regex.setPattern(
+        QRegularExpression::wildcardToRegularExpression(line));
+    if (pattern.regex.isValid()) rules->patterns.push_back(pattern);
+  }
+  return rules;
+}
+
+// The deepest .gitignore decides, inside one file the last matching line
+bool isIgnored(const IgnoreRules *rules, const QFileInfo &entry) {
+  for (; rules != nullptr; rules = rules->parent.get()) {
+    QString relative = QDir(rules->base).relativeFilePath(entry.filePath());
+    for (auto it = rules->patterns.rbegin(); it != rules->patterns.rend();
+         ++it) {
+      if (it->directory_only && !entry.isDir()) continue;
+      const QString &subject = it->anchored ? relative : entry.fileName();
+      if (it->regex.match(subject).hasMatch()) return !it->negated;
+    }
+  }
+  return false;
+}
+
+using Pending =
+    std::vector<std::pair<QString, std::shared_ptr<const IgnoreRules>>>;
+
+// Depth first walk of the directories on the stack, each with the rules of
+// the directories above it
+void walk(Pending stack, QStringList *files, QStringList *directories,
+          const std::atomic<bool> *cancelled) {
+  while (!stack.empty()) {
+    if (cancelled != nullptr && cancelled->load()) break;
+
+    QDir dir(stack.back().first);
+    auto rules = loadRules(dir, std::move(stack.back().second));
+    stack.pop_back();
+    if (directories != nullptr) directories->append(dir.path());
+
+    const QFileInfoList entries = dir.entryInfoList(
+        QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot | QDir::NoSymLinks);
+    for (const QFileInfo &entry : entries) {
+      if (isIgnored(rules.get(), entry)) continue;
+      if (entry.isDir()) {
+        if (!workspace::IsIgnoredDirectory(entry.fileName())) {
+          stack.emplace_back(entry.filePath(), rules);
+        }
+      } else if (entry.isFile()) {
+        files->append(entry.filePath());
+      }
+    }
+  }
+}
+
+}  // namespace
+
+namespace workspace {
+
+bool IsIgnoredDirectory(const QString &name) {
+  static const QStringList ignored = {"build", "node_modules"};
+  return name.startsWith('.') || name.startsWith("cmake-build-") ||
+         ignored.contains(name);
+}
+
+bool IsSourceFile(const QString &file_name) {
+  static const QStringList suffixes = {"h",  "c",   "cpp", "hpp", "cc",
+                                       "hh", "cxx", "hxx", "inl"};
+  return suffixes.contains(QFileInfo(file_name).suffix());
+}
+
+QStringList ListFiles(const QString &root, QStringList *directories,
+                      const std::atomic<bool> *cancelled) {
+  QStringList files;
+  walk({{QDir::cleanPath(root), nullptr}}, &files, directories, cancelled);
+  return files;
+}
+
+QStringList ListDirectory(const QString &root, const QString &directory,
+                          const QSet<QString> &known_dirs,
+                          QStringList *directories,
+                          const std::atomic<bool> *cancelled) {
+  QDir dir(QDir::cleanPath(directory));
+  QString relative = QDir(QDir::cleanPath(root)).relativeFilePath(dir.path());
+  if (relative.startsWith("..")) return {};
+
+  // the rules are gathered on the way down, an ignored directory on it
+  // hides everything below
+  std::shared_ptr<const IgnoreRules> rules;
+  QDir current(QDir::cleanPath(root));
+  if (relative != ".") {
+    for (const QString &part : relative.split('/')) {
+      rules = loadRules(current, std::move(rules));
+      QFileInfo entry(current.filePath(part));
+      if (IsIgnoredDirectory(part) || isIgnored(rules.get(), entry)) {
+        return {};
+      }
+      current.setPath(entry.filePath());
+    }
+  }
+  rules = loadRules(dir, std::move(rules));
+
+  QStringList files;
+  Pending stack;
+  const QFileInfoList entries = dir.entryInfoList(
+      QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot | QDir::NoSymLinks);
+  for (const QFileInfo &entry : entries) {
+    if (isIgnored(rules.get(), entry)) continue;
+    if (entry.isDir()) {
+      if (!IsIgnoredDirectory(entry.fileName()) &&
+          !known_dirs.contains(entry.filePath())) {
+        stack.emplace_back(entry.filePath(), rules);
+      }
+    } else if (entry.isFile()) {
+      files.append(entry.filePath());
+    }
+  }
+  walk(std::move(stack), &files, directories, cancelled);
+  return files;
+}
+
+Watcher::Watcher(QObject *parent) : QObject(parent) {
+  connect(&watcher_, &QFileSystemWatcher::directoryChanged, this,
+          [this](const QString &path) {
+            if (!QFileInfo(path).isDir()) watched_.remove(path);
+            emit directoryChanged(path);
+          });
+}
+
+void Watcher::setRoot(const QString &root) {
+  QString cleaned = QDir::cleanPath(root);
+  if (cleaned == root_) return;
+  if (!watched_.isEmpty()) {
+    watcher_.removePaths(QStringList(watched_.begin(), watched_.end()));
+    watched_.clear();
+  }
+  root_ = cleaned;
+}
+
+void Watcher::watch(const QStringList &directories) {
+  const int MAX_WATCHED_DIRECTORIES = 16384;
+  QStringList added;
+  for (const QString &dir : directories) {
+    if (watched_.size() >= MAX_WATCHED_DIRECTORIES) break;
+    if (!watched_.contains(dir)) {
+      watched_.insert(dir);
+      added.append(dir);
+    }
+  }
+  if (!added.isEmpty()) watcher_.addPaths(added);
+}
+
+}  // namespace workspace